@@ -0,0 +1,196 @@
+/****************************************************************************
+** Copyright (c) 2019 Evgeny Teterin (nayk) <sutcedortal@gmail.com>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef NAYK_CRC_H
+#define NAYK_CRC_H
+
+#include <QByteArray>
+#include <QVector>
+#include <QtEndian>
+#include <type_traits>
+
+namespace nayk {
+//=========================================================================================================
+/*
+  Обобщенный CRC по модели Rocksoft (Width, Poly, Init, RefIn, RefOut, XorOut),
+  параметры и контрольные значения - по каталогу reveng.sourceforge.net/crc-catalogue.
+  Таблицы строятся на этапе компиляции, вычисление - slicing-by-8 (8 байт за итерацию).
+  Ширина 1..64 бит; регистр хранится в наименьшем подходящем беззнаковом типе:
+  при RefIn - в младших разрядах (отраженный), иначе - выровненным по старшему разряду.
+*/
+//=========================================================================================================
+// таблицы для slicing-by-8: t[0] - обычная байтовая таблица, t[k][i] - CRC байта i, за которым следуют k нулевых байт
+template<typename T>
+struct CrcTables
+{
+    T t[8][256];
+};
+
+// отраженный алгоритм, poly - отраженный полином
+template<typename T>
+constexpr CrcTables<T> crcTablesReflected(T poly)
+{
+    CrcTables<T> res {};
+    for (int i = 0; i < 256; ++i) {
+        T crc = static_cast<T>(i);
+        for (int bit = 0; bit < 8; ++bit) crc = static_cast<T>((crc & 1) ? (crc >> 1) ^ poly : crc >> 1);
+        res.t[0][i] = crc;
+    }
+    for (int k = 1; k < 8; ++k) {
+        for (int i = 0; i < 256; ++i) {
+            res.t[k][i] = static_cast<T>((res.t[k - 1][i] >> 8) ^ res.t[0][res.t[k - 1][i] & 0xFF]);
+        }
+    }
+    return res;
+}
+
+// прямой алгоритм, poly выровнен по старшему разряду T
+template<typename T>
+constexpr CrcTables<T> crcTablesNormal(T poly)
+{
+    const int shift = 8 * static_cast<int>(sizeof(T)) - 8;
+    CrcTables<T> res {};
+    for (int i = 0; i < 256; ++i) {
+        T crc = static_cast<T>(static_cast<T>(i) << shift);
+        for (int bit = 0; bit < 8; ++bit) crc = static_cast<T>((crc >> (shift + 7)) ? (crc << 1) ^ poly : crc << 1);
+        res.t[0][i] = crc;
+    }
+    for (int k = 1; k < 8; ++k) {
+        for (int i = 0; i < 256; ++i) {
+            res.t[k][i] = static_cast<T>(static_cast<T>(res.t[k - 1][i] << 8) ^ res.t[0][(res.t[k - 1][i] >> shift) & 0xFF]);
+        }
+    }
+    return res;
+}
+
+// slicing-by-8: 8 байт за итерацию, регистр CRC накладывается на первые байты слова
+template<typename T>
+inline T crcUpdateReflected(const CrcTables<T> &tab, T crc, const quint8 *data, qint64 size)
+{
+    for (; size >= 8; size -= 8, data += 8) {
+        const quint64 x = qFromLittleEndian<quint64>(data) ^ crc;
+        crc = tab.t[7][ x        & 0xFF] ^ tab.t[6][(x >>  8) & 0xFF]
+            ^ tab.t[5][(x >> 16) & 0xFF] ^ tab.t[4][(x >> 24) & 0xFF]
+            ^ tab.t[3][(x >> 32) & 0xFF] ^ tab.t[2][(x >> 40) & 0xFF]
+            ^ tab.t[1][(x >> 48) & 0xFF] ^ tab.t[0][ x >> 56        ];
+    }
+    while (size--) crc = static_cast<T>((crc >> 8) ^ tab.t[0][(crc ^ *data++) & 0xFF]);
+    return crc;
+}
+
+template<typename T>
+inline T crcUpdateNormal(const CrcTables<T> &tab, T crc, const quint8 *data, qint64 size)
+{
+    const int shift = 8 * static_cast<int>(sizeof(T)) - 8;
+    for (; size >= 8; size -= 8, data += 8) {
+        const quint64 x = qFromBigEndian<quint64>(data) ^ (static_cast<quint64>(crc) << (56 - shift));
+        crc = tab.t[7][ x >> 56        ] ^ tab.t[6][(x >> 48) & 0xFF]
+            ^ tab.t[5][(x >> 40) & 0xFF] ^ tab.t[4][(x >> 32) & 0xFF]
+            ^ tab.t[3][(x >> 24) & 0xFF] ^ tab.t[2][(x >> 16) & 0xFF]
+            ^ tab.t[1][(x >>  8) & 0xFF] ^ tab.t[0][ x        & 0xFF];
+    }
+    while (size--) crc = static_cast<T>(static_cast<T>(crc << 8) ^ tab.t[0][((crc >> shift) ^ *data++) & 0xFF]);
+    return crc;
+}
+
+// зеркальное отражение младших width бит
+constexpr quint64 crcReflect(quint64 value, int width)
+{
+    quint64 res = 0;
+    for (int i = 0; i < width; ++i) {
+        res = (res << 1) | (value & 1);
+        value >>= 1;
+    }
+    return res;
+}
+
+template<int Width>
+struct CrcRegister
+{
+    static_assert((Width >= 1) && (Width <= 64), "CRC width must be 1..64");
+    typedef typename std::conditional<(Width <= 8), quint8,
+            typename std::conditional<(Width <= 16), quint16,
+            typename std::conditional<(Width <= 32), quint32, quint64>::type>::type>::type Type;
+};
+//=========================================================================================================
+template<int Width, quint64 Poly, quint64 Init, bool RefIn, bool RefOut, quint64 XorOut>
+class CrcModel
+{
+public:
+    typedef typename CrcRegister<Width>::Type Type;
+
+    // накопительный подсчет: reg = init(); reg = update(reg, ...); ... crc = finalize(reg)
+    static constexpr Type init() { return initRegister; }
+    static Type update(Type reg, const quint8 *data, qint64 size)
+    {
+        return RefIn ? crcUpdateReflected<Type>( tables, reg, data, size )
+                     : crcUpdateNormal<Type>( tables, reg, data, size );
+    }
+    static constexpr Type finalize(Type reg)
+    {
+        return static_cast<Type>( (RefIn == RefOut ? regValue(reg) : crcReflect(regValue(reg), Width)) ^ XorOut );
+    }
+    //
+    static Type calc(const quint8 *data, qint64 size) { return finalize( update(init(), data, size) ); }
+    static Type calc(const QByteArray &data)
+    {
+        return calc( reinterpret_cast<const quint8*>(data.constData()), data.size() );
+    }
+    static Type calc(const QVector<quint8> &data) { return calc( data.constData(), data.size() ); }
+
+    static constexpr int width = Width;
+    static constexpr CrcTables<Type> tables = RefIn
+            ? crcTablesReflected<Type>( static_cast<Type>(crcReflect(Poly, Width)) )
+            : crcTablesNormal<Type>( static_cast<Type>(Poly << (8 * sizeof(Type) - Width)) );
+
+private:
+    // сдвиг прямого регистра до старшего разряда типа
+    static constexpr int shift = 8 * static_cast<int>(sizeof(Type)) - Width;
+    static constexpr Type initRegister = static_cast<Type>( RefIn ? crcReflect(Init, Width) : Init << shift );
+    static constexpr quint64 regValue(Type reg) { return RefIn ? reg : static_cast<quint64>(reg) >> shift; }
+};
+
+template<int Width, quint64 Poly, quint64 Init, bool RefIn, bool RefOut, quint64 XorOut>
+constexpr CrcTables<typename CrcModel<Width, Poly, Init, RefIn, RefOut, XorOut>::Type>
+    CrcModel<Width, Poly, Init, RefIn, RefOut, XorOut>::tables;
+//=========================================================================================================
+//                                  Width  Poly        Init        RefIn  RefOut XorOut         Check
+typedef CrcModel< 8, 0x31,       0x00,       true,  true,  0x00      > Crc8_Maxim;      // 0xA1 Crypto::crc8_Dallas
+typedef CrcModel< 8, 0x31,       0xFF,       false, false, 0x00      > Crc8_Nrsc5;      // 0xF7 Crypto::crc8
+typedef CrcModel< 8, 0x07,       0x00,       false, false, 0x00      > Crc8_Smbus;      // 0xF4
+typedef CrcModel<16, 0x1021,     0xFFFF,     false, false, 0x0000    > Crc16_Ibm3740;   // 0x29B1 Crypto::crc16_Ccitt
+typedef CrcModel<16, 0x1021,     0x0000,     false, false, 0x0000    > Crc16_Xmodem;    // 0x31C3
+typedef CrcModel<16, 0x1021,     0x0000,     true,  true,  0x0000    > Crc16_Kermit;    // 0x2189
+typedef CrcModel<16, 0x1021,     0xFFFF,     true,  true,  0xFFFF    > Crc16_IbmSdlc;   // 0x906E (X-25)
+typedef CrcModel<16, 0x8005,     0x0000,     true,  true,  0x0000    > Crc16_Arc;       // 0xBB3D Crypto::crc16
+typedef CrcModel<16, 0x8005,     0xFFFF,     true,  true,  0x0000    > Crc16_Modbus;    // 0x4B37 Crypto::crc16_Arc, crc16_Modbus
+typedef CrcModel<16, 0x3D65,     0x0000,     false, false, 0xFFFF    > Crc16_En13757;   // 0xC2B7 Crypto::crc16_Wmbus
+typedef CrcModel<16, 0x3D65,     0x0000,     true,  true,  0xFFFF    > Crc16_Dnp;       // 0xEA82
+typedef CrcModel<32, 0x04C11DB7, 0xFFFFFFFF, true,  true,  0xFFFFFFFF> Crc32_IsoHdlc;   // 0xCBF43926 Crypto::crc32
+typedef CrcModel<32, 0x04C11DB7, 0xFFFFFFFF, false, false, 0x00000000> Crc32_Mpeg2;     // 0x0376E6E7
+typedef CrcModel<32, 0x1EDC6F41, 0xFFFFFFFF, true,  true,  0xFFFFFFFF> Crc32C;          // 0xE3069283 Crypto::crc32C
+//=========================================================================================================
+} // namespace nayk
+
+#endif // NAYK_CRC_H
@@ -26,26 +26,75 @@
 #define NAYK_CRYPTO_H
 
 #include <QByteArray>
+#include <QIODevice>
+#include <QList>
 #include <QVector>
 #include <QString>
+#include <QStringList>
+#include <QSharedPointer>
+#include "crc.h"
 
 namespace nayk {
 //=========================================================================================================
-enum CryptoAlg { CryptoAlg_TexasAES128 };
+struct CryptoKeyData;
+enum CryptoAlg {
+    CryptoAlg_TexasAES128,          // AES-128 ECB, табличная реализация с расписанием ключей на вызов
+    CryptoAlg_TexasAES128_Compact,  // тот же шифр, исходный вариант TI (минимум памяти, медленный)
+    CryptoAlg_AES128_CTR,           // AES-128 CTR: [IV 16 байт][шифротекст], без дополнения, произвольный доступ
+    CryptoAlg_AES128_CTR_HMAC       // CTR + HMAC-SHA256 (encrypt-then-MAC): [IV][шифротекст][тег 32 байта]
+};
 //=========================================================================================================
 class Crypto
 {
 public:
     explicit Crypto(CryptoAlg algorythm = CryptoAlg_TexasAES128);
     virtual ~Crypto();
+    CryptoAlg algorythm() const { return _algorythm; }
     virtual bool encryptData(const QString &inData, const QString &key, QString &outData);
     virtual bool decryptData(const QString &inData, const QString &key, QString &outData);
     virtual bool encryptData(const QByteArray &inData, const QString &key, QByteArray &outData);
     virtual bool decryptData(const QByteArray &inData, const QString &key, QByteArray &outData);
+    // без промежуточных буферов: outData вмещает encryptedSize(size, algorythm()) байт, допускается outData == inData;
+    // при расшифровке результат занимает decryptedSize(size, algorythm()) байт
+    bool encryptRaw(const quint8 *inData, qint64 size, const QString &key, quint8 *outData);
+    bool decryptRaw(const quint8 *inData, qint64 size, const QString &key, quint8 *outData);
+    bool encryptInPlace(QByteArray &data, const QString &key);
+    bool decryptInPlace(QByteArray &data, const QString &key);
+    static qint64 encryptedSize(qint64 size);
+    static qint64 encryptedSize(qint64 size, CryptoAlg algorythm);
+    static qint64 decryptedSize(qint64 size, CryptoAlg algorythm);
+    // привязка ключа: MD5 и раундовые ключи вычисляются один раз, далее шифрование без ключа
+    bool bindKey(const QString &key);
+    void unbindKey();
+    bool isKeyBound() const { return !_boundKey.isNull(); }
+    bool encryptBound(const QByteArray &inData, QByteArray &outData);
+    bool decryptBound(const QByteArray &inData, QByteArray &outData);
+    bool encryptBound(const quint8 *inData, qint64 size, quint8 *outData);
+    bool decryptBound(const quint8 *inData, qint64 size, quint8 *outData);
+    // потоковое шифрование: чтение и запись порциями chunkSize, память не зависит от объема данных
+    bool encryptDevice(QIODevice *inDevice, QIODevice *outDevice, const QString &key, qint64 chunkSize = 1024 * 1024);
+    bool decryptDevice(QIODevice *inDevice, QIODevice *outDevice, const QString &key, qint64 chunkSize = 1024 * 1024);
+    bool encryptDevice(QIODevice *inDevice, QIODevice *outDevice, qint64 chunkSize = 1024 * 1024);
+    bool decryptDevice(QIODevice *inDevice, QIODevice *outDevice, qint64 chunkSize = 1024 * 1024);
+    // только CTR: расшифровка диапазона [offset, offset + length) открытого текста без обработки остальных данных
+    // (при CTR_HMAC тег предварительно проверяется по всему сообщению)
+    bool decryptRange(const QByteArray &inData, qint64 offset, qint64 length, const QString &key, QByteArray &outData);
+    bool decryptRange(const QByteArray &inData, qint64 offset, qint64 length, QByteArray &outData);
+    // параллельное шифрование больших буферов (блоки ECB независимы), по умолчанию выключено
+    void setParallelMode(bool enabled) { _parallelMode = enabled; }
+    bool parallelMode() const { return _parallelMode; }
+    void setParallelThreshold(qint64 bytes) { _parallelThreshold = bytes; }
+    qint64 parallelThreshold() const { return _parallelThreshold; }
+    void setParallelThreadCount(int count) { _parallelThreadCount = count; } // 0 - по числу потоков пула
+    int parallelThreadCount() const { return _parallelThreadCount; }
     //
     QString lastError() const { return _lastError; }
     static QString md5(const QString &data);
     static QByteArray md5Bytes(const QString &data);
+    // пакетный MD5: дайджесты подряд в outData (по 16 байт или по 32 символа hex на каждый вход);
+    // threadCount != 1 (0 - по числу потоков пула) - параллельный подсчет для пакетов от 1024 входов
+    static void md5Batch(const QList<QByteArray> &inData, QByteArray &outData, bool hex = false, int threadCount = 1);
+    static void md5Batch(const QStringList &inData, QByteArray &outData, bool hex = false, int threadCount = 1);
     //
     static quint8 crc8_Dallas(const QVector<quint8> &data);
     static quint8 crc8_Dallas(const QByteArray &data);
@@ -75,17 +124,79 @@ public:
     static quint32 crc32(const QVector<quint8> &data);
     static quint32 crc32(const QByteArray &data);
     static quint32 crc32(const quint8 *data, qint32 size);
+    //
+    static quint16 crc16_Modbus(const QVector<quint8> &data);
+    static quint16 crc16_Modbus(const QByteArray &data);
+    static quint16 crc16_Modbus(const quint8 *data, qint32 size);
+    //
+    static quint32 crc32C(const QVector<quint8> &data);
+    static quint32 crc32C(const QByteArray &data);
+    static quint32 crc32C(const quint8 *data, qint32 size);
 
 protected:
     QString _lastError {""};
 
 private:
     CryptoAlg _algorythm;
-    // шифрование aes128 (Texas Instruments alg.)
-    QByteArray encryptAES128_Block(const QByteArray &dataBuf, const QByteArray &md5Key);
-    QByteArray decryptAES128_Block(const QByteArray &dataBuf, const QByteArray &md5Key);
-    QByteArray encryptAES128(const QByteArray &data, const QByteArray &md5Key);
-    QByteArray decryptAES128(const QByteArray &data, const QByteArray &md5Key);
+    bool _parallelMode {false};
+    qint64 _parallelThreshold {1024 * 1024};
+    int _parallelThreadCount {0};
+    QSharedPointer<const CryptoKeyData> _boundKey;
+    QString _boundKeyString;
+    int parallelChunks(qint64 size) const;
+    bool isCtr() const;
+    bool checkEncryptedSize(qint64 size) const;
+    QSharedPointer<const CryptoKeyData> keyData(const QString &key) const;
+    void encryptArray(const QByteArray &inData, const CryptoKeyData &key, QByteArray &outData);
+    bool decryptArray(const QByteArray &inData, const CryptoKeyData &key, QByteArray &outData);
+    void encryptRaw(const quint8 *inData, qint64 size, const CryptoKeyData &key, quint8 *outData);
+    bool decryptRaw(const quint8 *inData, qint64 size, const CryptoKeyData &key, quint8 *outData);
+    bool decryptRange(const QByteArray &inData, qint64 offset, qint64 length, const CryptoKeyData &key,
+                      QByteArray &outData);
+    bool processDevice(QIODevice *inDevice, QIODevice *outDevice, const CryptoKeyData &key,
+                       qint64 chunkSize, bool encrypt);
+    bool processDeviceCtr(QIODevice *inDevice, QIODevice *outDevice, const CryptoKeyData &key,
+                          qint64 chunkSize, bool encrypt);
+    // CTR: out = in xor keystream, position - смещение в открытом тексте, допускается out == in
+    void ctrBuffer(const quint8 *iv, qint64 position, const quint8 *in, quint8 *out, qint64 size,
+                   const CryptoKeyData &key);
+    void ctrEncrypt(const quint8 *inData, qint64 size, const CryptoKeyData &key, quint8 *outData);
+    bool ctrVerify(const quint8 *inData, qint64 size, const CryptoKeyData &key);
+    void ctrDecrypt(const quint8 *inData, qint64 size, const CryptoKeyData &key, quint8 *outData);
+    // шифрование aes128 на месте, size кратен 16
+    void encryptBuffer(quint8 *buf, qint64 size, const CryptoKeyData &key);
+    void decryptBuffer(quint8 *buf, qint64 size, const CryptoKeyData &key);
+};
+//=========================================================================================================
+enum CrcAlg {
+    CrcAlg_8_Dallas,    // Crypto::crc8_Dallas
+    CrcAlg_8,           // Crypto::crc8
+    CrcAlg_16_Ccitt,    // Crypto::crc16_Ccitt
+    CrcAlg_16,          // Crypto::crc16 (QVector/QByteArray, начальное значение 0x0000)
+    CrcAlg_16_Arc,      // Crypto::crc16_Arc
+    CrcAlg_16_Wmbus,    // Crypto::crc16_Wmbus
+    CrcAlg_32,          // Crypto::crc32
+    CrcAlg_32C          // Crypto::crc32C
+};
+//=========================================================================================================
+// Накопительный подсчет CRC: данные подаются частями по мере поступления
+// (для произвольной модели - CrcModel<...>::init/update/finalize из crc.h)
+class Crc
+{
+public:
+    explicit Crc(CrcAlg algorythm = CrcAlg_32);
+    CrcAlg algorythm() const { return _algorythm; }
+    void reset();
+    void update(const quint8 *data, qint64 size);
+    void update(const QByteArray &data);
+    void update(const QVector<quint8> &data);
+    quint32 value() const;
+    // CRC32 склеенных данных A+B по CRC32 частей и длине B
+    static quint32 combine(quint32 crcA, quint32 crcB, qint64 lenB);
+
+private:
+    CrcAlg _algorythm;
+    quint32 _crc;
 };
 //=========================================================================================================
 } // namespace nayk
@@ -0,0 +1,94 @@
+/****************************************************************************
+** Copyright (c) 2019 Evgeny Teterin (nayk) <sutcedortal@gmail.com>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef NAYK_FASTCGI_SERVER_H
+#define NAYK_FASTCGI_SERVER_H
+
+#include <QObject>
+#include <QString>
+#include <QHostAddress>
+
+#include "http_server.h"
+
+class QLocalServer;
+class QTcpServer;
+
+namespace nayk {
+//======================================================================================================
+/*
+  FastCGI-сервер (роль Responder): один долгоживущий процесс обслуживает запросы веб-сервера
+  через Unix-сокет или TCP. Для каждого запроса создается HttpServer с уже принятыми
+  заголовками и содержимым и передается в сигнал newRequest, дальше обработка как в CGI:
+
+      connect(&fcgi, &FastCgiServer::newRequest, [](HttpServer *http) {
+          bool ok;
+          http->readRequest(&ok);
+          ...
+          http->writeResponse(&ok);
+      });
+      fcgi.listen("/run/app/fcgi.sock");
+
+  Объект HttpServer принадлежит соединению и удаляется после отправки ответа
+  или разрыва соединения. Требуется модуль network.
+*/
+//======================================================================================================
+class FastCgiServer : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit FastCgiServer(QObject *parent = nullptr);
+    virtual ~FastCgiServer();
+    //
+    QString lastError() const { return _lastError; }
+    bool listen(const QString &socketName);
+    bool listen(const QHostAddress &address, quint16 port);
+    void close();
+    bool isListening() const;
+    quint16 serverPort() const;
+    // больше - "413 Payload Too Large" без вызова обработчика
+    void setMaxContentLength(qint64 size);
+    qint64 maxContentLength() const { return _maxContentLength; }
+    void setDbgLogging(bool on = true) { _dbg = on; }
+
+signals:
+    void toLog(LogType, QString);
+    void newRequest(nayk::HttpServer *server);
+
+private:
+    bool _dbg {false};
+    qint64 _maxContentLength {64 * 1024 * 1024};
+    QLocalServer *_localServer {nullptr};
+    QTcpServer *_tcpServer {nullptr};
+    //
+    void acceptLocalConnections();
+    void acceptTcpConnections();
+
+protected:
+    QString _lastError {""};
+
+};
+//======================================================================================================
+} // namespace nayk
+#endif // NAYK_FASTCGI_SERVER_H
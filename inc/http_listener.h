@@ -0,0 +1,100 @@
+/****************************************************************************
+** Copyright (c) 2019 Evgeny Teterin (nayk) <sutcedortal@gmail.com>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef NAYK_HTTP_LISTENER_H
+#define NAYK_HTTP_LISTENER_H
+
+#include <QObject>
+#include <QString>
+#include <QHostAddress>
+
+#include "http_server.h"
+
+class QTcpServer;
+
+namespace nayk {
+//======================================================================================================
+/*
+  Встроенный HTTP/1.1-сервер без веб-сервера перед приложением: keep-alive, конвейерная
+  обработка (запросы одного соединения принимаются подряд, ответы уходят в порядке запросов),
+  тело по Content-Length или chunked, Expect: 100-continue.
+  Запрос переводится в CGI-переменные (REQUEST_METHOD, QUERY_STRING, HTTP_*, ...) и отдается
+  в HttpServer, дальше обработка та же, что для CGI и FastCGI:
+
+      connect(&listener, &HttpListener::newRequest, [](HttpServer *http) {
+          bool ok;
+          http->readRequest(&ok);
+          ...
+          http->writeResponse(&ok);
+      });
+      listener.listen(QHostAddress::Any, 8080);
+
+  Код ответа задается заголовком "Status" (как в CGI), по умолчанию "200 OK".
+  Объект HttpServer принадлежит соединению и удаляется после отправки ответа
+  или разрыва соединения. Требуется модуль network.
+*/
+//======================================================================================================
+class HttpListener : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit HttpListener(QObject *parent = nullptr);
+    virtual ~HttpListener();
+    //
+    QString lastError() const { return _lastError; }
+    bool listen(const QHostAddress &address, quint16 port);
+    void close();
+    bool isListening() const;
+    quint16 serverPort() const;
+    void setKeepAliveTimeout(int msec) { _keepAliveTimeout = msec; }
+    int keepAliveTimeout() const { return _keepAliveTimeout; }
+    // срок на прием заголовка запроса с его первого байта, иначе "408 Request Timeout"
+    void setHeaderTimeout(int msec) { _headerTimeout = msec; }
+    int headerTimeout() const { return _headerTimeout; }
+    // не больше предела QByteArray за вычетом заголовка
+    void setMaxContentLength(qint64 size);
+    qint64 maxContentLength() const { return _maxContentLength; }
+    void setDbgLogging(bool on = true) { _dbg = on; }
+
+signals:
+    void toLog(LogType, QString);
+    void newRequest(nayk::HttpServer *server);
+
+private:
+    bool _dbg {false};
+    int _keepAliveTimeout {30000};
+    int _headerTimeout {10000};
+    qint64 _maxContentLength {64 * 1024 * 1024};
+    QTcpServer *_tcpServer {nullptr};
+    //
+    void acceptConnections();
+
+protected:
+    QString _lastError {""};
+
+};
+//======================================================================================================
+} // namespace nayk
+#endif // NAYK_HTTP_LISTENER_H
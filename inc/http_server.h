@@ -37,9 +37,11 @@
 #include "http.h"
 #include "log.h"
 
+class QTemporaryFile;
+
 namespace nayk {
 //======================================================================================================
-
+class MultipartStream;
 
 //======================================================================================================
 class HttpServer : public QObject
@@ -69,6 +71,13 @@ public:
     QString requestHeader(const QString &name) const;
     QString requestCookie(const QString &name) const;
     QByteArray requestBinParameter(const QString &name) const;
+    // то же без копирования: значение ссылается на requestContent() и действительно,
+    // пока жив объект и до следующего readRequest(); сохранять копию нельзя
+    QByteArray requestBinParameterView(const QString &name) const { return mRequestBinParameters.value(name); }
+    // части, записанные во временные файлы (см. setUploadFileThreshold): путь к файлу.
+    // Файлы удаляются вместе с объектом и при следующем readRequest(); чтобы сохранить - QFile::rename()
+    QString requestFileParameter(const QString &name) const;
+    QMap<QString, QString> requestFileParameters() const;
     QJsonValue requestJsonParameter(const QString &name) const;
     QByteArray requestContent() { return _requestContent; }
     QString responseHeader(const QString &name) const;
@@ -78,13 +87,24 @@ public:
     QMap<QString, QString> requestGetParameters() const { return mRequestGetParameters; }
     QMap<QString, QString> requestPostParameters() const { return mRequestPostParameters; }
     QMap<QString, QString> requestHeaders() const { return mRequestHeaders; }
-    QMap<QString, QByteArray> requestBinParameters() const { return mRequestBinParameters; }
+    QMap<QString, QByteArray> requestBinParameters() const;
     void setDbgLogging(bool on = true) { _dbg = on; }
+    // файловые и двоичные части multipart/form-data больше порога (байт) пишутся во временные
+    // файлы по мере чтения, содержимое запроса целиком в памяти не держится; -1 - выключено
+    void setUploadFileThreshold(qint64 size) { _uploadFileThreshold = size; }
+    qint64 uploadFileThreshold() const { return _uploadFileThreshold; }
+    void setUploadDir(const QString &dir) { _uploadDir = dir; }
+    QString uploadDir() const { return _uploadDir; }
+    // запрос, принятый не через CGI (FastCGI, встроенный HTTP-сервер): заголовки в виде
+    // CGI-переменных и содержимое запроса. Ответ отдается сигналом responseReady
+    void setRequest(const QMap<QString, QString> &headers, const QByteArray &content);
+    bool isExternalRequest() const { return _external; }
 
 signals:
     void toLog(LogType, QString);
     void readRequestFinished(bool);
     void writeResponseFinished(bool);
+    void responseReady(QByteArray headers, QByteArray content);
 
 public slots:
     void readRequest(bool *ok = nullptr);
@@ -102,12 +122,18 @@ private:
     QMap<QString, QString> mRequestHeaders;
     QMap<QString, QByteArray> mRequestBinParameters;
     QMap<QString, QJsonValue> mRequestJsonParameters;
+    QMap<QString, QTemporaryFile*> mRequestFiles;
+    qint64 _uploadFileThreshold {-1};
+    QString _uploadDir;
     QByteArray _requestContent;
     QMap<QString, QString> mResponseHeaders;
     QMap<QString, QString> mResponseCookies;
     QByteArray _responseContent;
+    bool _external {false};
+    QMap<QString, QString> _externalHeaders;
+    QByteArray _externalContent;
     //
-    bool readRequestContent(QByteArray &buf);
+    bool readRequestContent(QByteArray &buf, MultipartStream *stream = nullptr);
     QMap<QString, QString> decodeQuery(const QString &strQuery, const QString &strPairSeparator = "&");
     QString encodeQuery(QMap<QString, QString> qmQuery, const QString &strPairSeparator = "&");
     QString encodeQuery(QVariantMap qvmQuery, const QString &strPairSeparator = "&");
@@ -115,9 +141,12 @@ private:
     void processHeaders();
     void processGet();
     bool processPost();
+    bool parseMultipart(const QByteArray &boundary);
+    bool readMultipartToFiles(const QByteArray &boundary);
     bool processReadRequest();
     bool processWriteResponse();
     bool writeResponseContent();
+    bool writeStandardOutput(QByteArray headers);
 
 private slots:
     void startReadRequest();
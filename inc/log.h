@@ -25,15 +25,22 @@
 #ifndef NAYK_LOGSAVER_H
 #define NAYK_LOGSAVER_H
 
+#include <QAtomicInt>
 #include <QObject>
 #include <QFile>
 #include <QTextStream>
 #include <QDateTime>
+#include <QMutex>
+#include <QStringList>
+#include <QVector>
+
+class QThreadPool;
 //======================================================================================================
 namespace nayk {
 //======================================================================================================
 enum LogType { LogInfo, LogWarning, LogError, LogIn, LogOut, LogText, LogDbg, LogOther };
-enum LogFormat { PlainLog, RichLog, HtmlLog };
+enum LogFormat { PlainLog, RichLog, HtmlLog, BinaryLog };
+class LogWriter;
 
 //======================================================================================================
 class Log : public QObject
@@ -47,27 +54,76 @@ public:
     void setDbgSave(bool on = true) { _dbg = on; }
     bool dbgSave() { return _dbg; }
     bool write(LogType logType, const QString &text);
-    QString logFileName() const { return logPath + logFile; }
-    QString lastError() const { return _lastError; }
+    // асинхронная запись: write() только ставит строку в очередь, отдельный поток пишет пачками
+    // и сбрасывает на диск по объему (flushBytes) или времени (flushMsec)
+    void setAsync(bool on);
+    bool isAsync() const { return _writer != nullptr; }
+    void setFlushThreshold(int flushBytes, int flushMsec);
+    bool flush();
+    // ротация: новый файл при достижении maxFileSize (0 - без ограничения) и/или при смене суток;
+    // закрытый файл в фоне сжимается в .log.gz, общий объем логов ограничивается maxTotalSize (0 - без ограничения).
+    // Настраивается до startLog() или setAsync()
+    void setRotation(qint64 maxFileSize, bool daily = true);
+    void setRetention(qint64 maxTotalSize) { _maxTotalSize = (maxTotalSize > 0) ? maxTotalSize : 0; }
+    void setCompressRotated(bool on = true) { _compress = on; }
+    bool waitForArchive(int msecs = -1);
+    // формат файла: PlainLog (текст) или BinaryLog (записи LogBinaryReader, файл *.blog); до startLog()
+    void setFileFormat(LogFormat fileFormat) { _binary = (fileFormat == BinaryLog); }
+    LogFormat fileFormat() const { return _binary ? BinaryLog : PlainLog; }
+    QString logFileName() const;
+    QString lastError() const;
     static QString highlightLog(LogFormat logFormat, const QString &logText, bool darkBackground = false);
     static QString highlightLogString(LogFormat logFormat, LogType logType, const QString &text, bool darkBackground = false);
     static QString highlightLogString(LogFormat logFormat, QDateTime dateTime, LogType logType, const QString &text, bool darkBackground = false);
     static QString readLog(LogFormat logFormat, const QString &fileName, bool darkBackground = false);
     static QStringList logFiles(const QString &logDir);
     static QStringList logFiles(const QString &rootLogDir, QDate date);
+    static QString getLogPrefix(LogType logType, const QDateTime &date = QDateTime::currentDateTime());
+    static QByteArray compressLog(const QByteArray &data);
+    static QByteArray uncompressLog(const QByteArray &data);
 
 private:
     QDateTime startingTime;
     QString logFile {""};
     QString logPath {""};
+    QString logRoot {""};
+    QString _startFile {""};        // имя файла из startLog(fileName): setRetention удаляет только свои файлы
+    mutable QMutex _nameMutex;      // имя файла и последняя ошибка: меняются и в потоке писателя
     QFile file;
     QTextStream stream;
+    QAtomicInt _opened {0};         // лог открыт: меняется только в потоке владельца, в отличие от file (ротация в писателе)
     QString _lastError {""};
     bool _dbg {true};
+    bool _localTime {true};
+    LogWriter *_writer {nullptr};
+    int _flushBytes {64 * 1024};
+    int _flushMsec {1000};
+    QDate _fileDate;
+    qint64 _fileSize {0};
+    qint64 _maxFileSize {0};
+    qint64 _maxTotalSize {0};
+    bool _daily {false};
+    bool _compress {true};
+    QThreadPool *_archivePool {nullptr};
+    bool _binary {false};
+    qint64 _binaryTime {0};
 
     bool writeFirstLine();
     bool writeLastLine();
-    static QString getLogPrefix(LogType logType, const QDateTime &date = QDateTime::currentDateTime());
+    bool writeError();
+    void stopWriter();
+    bool isOpened() const { return _opened.loadAcquire() != 0; }
+    void setLastError(const QString &text);
+    void emitFileSignal(const char *signal, const QString &fileName);
+    QDateTime currentTime() const;
+    bool openLogFile(const QString &path, const QString &name);
+    bool rotate(const QDateTime &date);
+    qint64 writeEntry(LogType logType, const QDateTime &date, const QString &text);
+    qint64 writeRecord(LogType logType, const QDateTime &date, const QString &text);
+    static qint64 writeLines(QTextStream &stream, LogType logType, const QDateTime &date, const QString &text);
+
+    friend class LogWriter;
+    friend class LogBinaryReader;
 
 signals:
     void openFile(QString);
@@ -77,5 +133,112 @@ public slots:
     void onLog(LogType logType, QString text);
 };
 //======================================================================================================
+// постраничное чтение больших лог-файлов: файл отображается в память, индекс хранит смещение
+// каждой LogReader::IndexStep-й строки, поэтому переход к строке N не зависит от размера файла,
+// а память под индекс - 8 байт на IndexStep строк
+class LogReader
+{
+public:
+    static const int IndexStep = 64;
+
+    explicit LogReader(const QString &fileName = QString());
+    ~LogReader();
+    bool open(const QString &fileName);
+    void close();
+    bool isOpen() const { return _open; }
+    bool refresh();
+    qint64 lineCount() const { return _lineCount + ((_lastStart < _size) ? 1 : 0); }
+    qint64 size() const { return _size; }
+    QString line(qint64 index) const;
+    QStringList lines(qint64 first, qint64 count) const;
+    QString text(qint64 first, qint64 count) const;
+    QString readLog(LogFormat logFormat, qint64 first, qint64 count, bool darkBackground = false) const;
+    QString lastError() const { return _lastError; }
+
+private:
+    QFile _file;
+    QByteArray _buffer;
+    uchar *_map {nullptr};
+    const char *_data {nullptr};
+    bool _open {false};
+    qint64 _size {0};
+    qint64 _lineCount {0};
+    qint64 _lastStart {0};
+    QVector<qint64> _index;
+    QString _lastError {""};
+
+    bool mapFile();
+    void buildIndex(qint64 from);
+    qint64 lineStart(qint64 index) const;
+    qint64 lineEnd(qint64 start) const;
+};
+//======================================================================================================
+// строка лога, найденная LogIndex
+struct LogRecord
+{
+    QDateTime date;
+    LogType logType;
+    QString text;
+    QString fileName;
+    qint64 line;
+};
+//======================================================================================================
+// поиск по дереву логов yyyy/MM/dd по времени и типу строк. Рядом с каждым файлом хранится индекс
+// <файл>.idx: смещение и сводка (диапазон времени, маска типов) для каждых LogIndex::BlockLines строк.
+// Индекс дописывается по мере роста файла; поиск читает с диска только подходящие блоки
+class LogIndex
+{
+public:
+    static const int BlockLines = 256;
+    static const int AllTypes = 0xFF;   // маска типов: 1 << LogType
+
+    static bool update(const QString &fileName);
+    static QVector<LogRecord> searchFile(const QString &fileName, const QDateTime &from, const QDateTime &to,
+                                         int typeMask = AllTypes);
+    static QVector<LogRecord> search(const QString &rootLogDir, const QDateTime &from, const QDateTime &to,
+                                     int typeMask = AllTypes, int threadCount = 0);
+    static QString indexFileName(const QString &fileName) { return fileName + ".idx"; }
+    //
+    LogIndex() = delete;
+};
+//======================================================================================================
+// чтение двоичного лога (Log::setFileFormat(BinaryLog)). Файл: "NLOG", версия, флаги (бит 0 - местное
+// время), затем записи: varint (zigzag) приращения времени в мсек, байт LogType, varint длины и текст UTF-8.
+// next() с маской типов пропускает чужие записи, не декодируя текст
+class LogBinaryReader
+{
+public:
+    explicit LogBinaryReader(const QByteArray &data = QByteArray());
+    ~LogBinaryReader();
+    bool open(const QString &fileName);
+    void setData(const QByteArray &data);
+    void close();
+    bool isValid() const { return _valid; }
+    bool next(int typeMask = LogIndex::AllTypes);
+    QDateTime date() const;
+    LogType logType() const { return _logType; }
+    QByteArray payload() const;
+    QString text() const;
+    static bool isBinaryLog(const char *data, qint64 size);
+    static QByteArray toText(const QByteArray &data);
+    static bool convertToText(const QString &fileName, const QString &textFileName);
+
+private:
+    QFile _file;
+    QByteArray _buffer;
+    uchar *_map {nullptr};
+    const char *_data {nullptr};
+    qint64 _size {0};
+    qint64 _pos {0};
+    bool _valid {false};
+    bool _localTime {true};
+    qint64 _time {0};
+    LogType _logType {LogOther};
+    qint64 _payloadPos {0};
+    int _payloadSize {0};
+
+    void reset();
+};
+//======================================================================================================
 } // namespace nayk
 #endif // NAYK_LOGSAVER_H
@@ -0,0 +1,96 @@
+/****************************************************************************
+** Copyright (c) 2019 Evgeny Teterin (nayk) <sutcedortal@gmail.com>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#ifndef NAYK_PARALLEL_H
+#define NAYK_PARALLEL_H
+
+#include <QRunnable>
+#include <QSemaphore>
+#include <QThread>
+#include <QThreadPool>
+#include <functional>
+
+namespace nayk {
+//=========================================================================================================
+/*
+  Параллельное выполнение func(0) .. func(count - 1): часть 0 - в текущем потоке,
+  остальные - в собственном пуле библиотеки (глобальный пул приложения не занимается).
+  Если свободного потока нет (например, вызов из задачи того же пула), часть выполняется
+  в текущем потоке, поэтому ожидание завершения не может заблокироваться.
+*/
+//=========================================================================================================
+class ParallelTask : public QRunnable
+{
+public:
+    ParallelTask(const std::function<void(int)> &func, int index, QSemaphore *done)
+        : _func(func), _index(index), _done(done) {}
+    void run() override
+    {
+        _func(_index);
+        _done->release();
+    }
+
+private:
+    const std::function<void(int)> &_func;
+    int _index;
+    QSemaphore *_done;
+};
+
+inline QThreadPool *parallelPool()
+{
+    static QThreadPool pool;
+    return &pool;
+}
+
+inline void parallelFor(int count, const std::function<void(int)> &func)
+{
+    if (count < 2) {
+        if (count == 1) func(0);
+        return;
+    }
+
+    QSemaphore done;
+    int started = 0;
+    for (int i = 1; i < count; ++i) {
+        ParallelTask *task = new ParallelTask(func, i, &done);
+        if (parallelPool()->tryStart(task)) {
+            ++started;
+        }
+        else {
+            delete task;
+            func(i);
+        }
+    }
+    func(0);
+    done.acquire(started);
+}
+
+inline int parallelThreadCount()
+{
+    return qMax(parallelPool()->maxThreadCount(), 1);
+}
+//=========================================================================================================
+} // namespace nayk
+
+#endif // NAYK_PARALLEL_H
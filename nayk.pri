@@ -4,12 +4,17 @@
 #
 #-------------------------------------------------
 
+# constexpr-таблицы CRC:
+CONFIG *= c++14
+
 # каталоги для поиска подключаемых файлов:
 INCLUDEPATH *= $${PWD}/inc
 INCLUDEPATH *= $${PWD}/src
 
 # заголовочные:
 HEADERS *= \
+    $${PWD}/inc/crc.h \
+    $${PWD}/inc/parallel.h \
     $${PWD}/inc/crypto.h \
     $${PWD}/inc/log.h \
     $${PWD}/inc/system_utils.h \
@@ -33,8 +38,15 @@ SOURCES *= \
 
 # если подключен драйвер сети:
 contains( QT, network ) {
-    HEADERS *= $${PWD}/inc/http_client.h
-    SOURCES *= $${PWD}/src/http_client.cpp
+    HEADERS *= \
+        $${PWD}/inc/http_client.h \
+        $${PWD}/inc/fastcgi_server.h \
+        $${PWD}/inc/http_listener.h
+
+    SOURCES *= \
+        $${PWD}/src/http_client.cpp \
+        $${PWD}/src/fastcgi_server.cpp \
+        $${PWD}/src/http_listener.cpp
 }
 
 # если подключены виджеты:
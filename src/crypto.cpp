@@ -23,9 +23,37 @@
 **
 ****************************************************************************/
 #include <QCryptographicHash>
+#include <QIODevice>
+#include <QMessageAuthenticationCode>
 #include <QObject>
+#include <QSharedPointer>
+#include <QtEndian>
+#include <QtGlobal>
+#include <cstring>
+#include <functional>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+#   include <QRandomGenerator>
+#else
+#   include <random>
+#endif
 
 #include "crypto.h"
+#include "parallel.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#   define NAYK_CRYPTO_X86
+#   include <wmmintrin.h>
+#   include <smmintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#       define NAYK_TARGET_AES
+#       define NAYK_TARGET_PCLMUL
+#   else
+#       include <cpuid.h>
+#       define NAYK_TARGET_AES __attribute__((target("aes,sse2")))
+#       define NAYK_TARGET_PCLMUL __attribute__((target("pclmul,sse4.1")))
+#   endif
+#endif
 
 //==========================================================================================================
 namespace nayk {
@@ -223,6 +251,352 @@ void aes_enc_dec(unsigned char *state, unsigned char *key, unsigned char dir)
 
 /* AES-128 End Section ===================================================================================*/
 
+/*  AES-128 Table Implementation ======================================================================== */
+
+// Тот же AES-128, что и aes_enc_dec (шифротекст побайтно совпадает), но:
+// - расписание ключей вычисляется один раз на ключ, а не на каждый блок
+// - раунд выполняется 32-битными T-таблицами (SubBytes + ShiftRows + MixColumns)
+// - для расшифровки используется эквивалентный обратный шифр (без прогона 10 прямых раундов)
+
+#define AES_GETU32(p) ( (static_cast<quint32>((p)[0]) << 24) ^ (static_cast<quint32>((p)[1]) << 16) \
+                      ^ (static_cast<quint32>((p)[2]) <<  8) ^  static_cast<quint32>((p)[3]) )
+#define AES_PUTU32(p, v) { (p)[0] = static_cast<quint8>((v) >> 24); (p)[1] = static_cast<quint8>((v) >> 16); \
+                           (p)[2] = static_cast<quint8>((v) >>  8); (p)[3] = static_cast<quint8>(v); }
+
+struct AES128_KeySchedule
+{
+    quint32 enc[44]; // раундовые ключи шифрования
+    quint32 dec[44]; // раундовые ключи эквивалентного обратного шифра
+    quint8 encBytes[176]; // те же ключи побайтно (для AES-NI)
+    quint8 decBytes[176];
+};
+
+struct AES128_Tables
+{
+    quint32 te[4][256];
+    quint32 td[4][256];
+    AES128_Tables();
+};
+
+quint8 galois_mul(quint8 a, quint8 b)
+{
+    quint8 res = 0;
+    while (b) {
+        if (b & 1) res ^= a;
+        a = galois_mul2(a);
+        b >>= 1;
+    }
+    return res;
+}
+
+AES128_Tables::AES128_Tables()
+{
+    for (int x = 0; x < 256; ++x) {
+        const quint8 s = sbox[x];
+        const quint8 s2 = galois_mul2(s);
+        const quint32 e = (static_cast<quint32>(s2) << 24) | (static_cast<quint32>(s) << 16)
+                | (static_cast<quint32>(s) << 8) | static_cast<quint32>(s2 ^ s);
+
+        const quint8 r = rsbox[x];
+        const quint32 d = (static_cast<quint32>(galois_mul(r, 0x0e)) << 24)
+                | (static_cast<quint32>(galois_mul(r, 0x09)) << 16)
+                | (static_cast<quint32>(galois_mul(r, 0x0d)) << 8)
+                | static_cast<quint32>(galois_mul(r, 0x0b));
+
+        for (int t = 0; t < 4; ++t) {
+            te[t][x] = t ? (e >> (8 * t)) | (e << (32 - 8 * t)) : e;
+            td[t][x] = t ? (d >> (8 * t)) | (d << (32 - 8 * t)) : d;
+        }
+    }
+}
+
+const AES128_Tables &aes128_Tables()
+{
+    static const AES128_Tables tables;
+    return tables;
+}
+
+void aes128_ExpandKey(const quint8 *key, AES128_KeySchedule &ks)
+{
+    const AES128_Tables &T = aes128_Tables();
+    quint32 *rk = ks.enc;
+
+    for (int i = 0; i < 4; ++i) rk[i] = AES_GETU32(key + 4 * i);
+
+    for (int round = 0; round < 10; ++round, rk += 4) {
+        const quint32 temp = rk[3];
+        rk[4] = rk[0]
+                ^ (static_cast<quint32>(sbox[(temp >> 16) & 0xff]) << 24)
+                ^ (static_cast<quint32>(sbox[(temp >>  8) & 0xff]) << 16)
+                ^ (static_cast<quint32>(sbox[ temp        & 0xff]) <<  8)
+                ^  static_cast<quint32>(sbox[ temp >> 24        ])
+                ^ (static_cast<quint32>(Rcon[round]) << 24);
+        rk[5] = rk[1] ^ rk[4];
+        rk[6] = rk[2] ^ rk[5];
+        rk[7] = rk[3] ^ rk[6];
+    }
+
+    // ключи расшифровки: обратный порядок раундов + InvMixColumns для раундов 1..9
+    for (int round = 0; round <= 10; ++round) {
+        for (int i = 0; i < 4; ++i) {
+            const quint32 w = ks.enc[4 * (10 - round) + i];
+            ks.dec[4 * round + i] = (round == 0 || round == 10) ? w
+                    : T.td[0][sbox[ w >> 24        ]] ^ T.td[1][sbox[(w >> 16) & 0xff]]
+                    ^ T.td[2][sbox[(w >>  8) & 0xff]] ^ T.td[3][sbox[ w        & 0xff]];
+        }
+    }
+
+    for (int i = 0; i < 44; ++i) {
+        AES_PUTU32(ks.encBytes + 4 * i, ks.enc[i]);
+        AES_PUTU32(ks.decBytes + 4 * i, ks.dec[i]);
+    }
+}
+
+void aes128_EncryptBlock(const AES128_KeySchedule &ks, const quint8 *in, quint8 *out)
+{
+    const AES128_Tables &T = aes128_Tables();
+    const quint32 *rk = ks.enc;
+
+    quint32 s0 = AES_GETU32(in     ) ^ rk[0];
+    quint32 s1 = AES_GETU32(in +  4) ^ rk[1];
+    quint32 s2 = AES_GETU32(in +  8) ^ rk[2];
+    quint32 s3 = AES_GETU32(in + 12) ^ rk[3];
+    quint32 t0, t1, t2, t3;
+
+    for (int round = 1; round < 10; ++round) {
+        rk += 4;
+        t0 = T.te[0][s0 >> 24] ^ T.te[1][(s1 >> 16) & 0xff] ^ T.te[2][(s2 >> 8) & 0xff] ^ T.te[3][s3 & 0xff] ^ rk[0];
+        t1 = T.te[0][s1 >> 24] ^ T.te[1][(s2 >> 16) & 0xff] ^ T.te[2][(s3 >> 8) & 0xff] ^ T.te[3][s0 & 0xff] ^ rk[1];
+        t2 = T.te[0][s2 >> 24] ^ T.te[1][(s3 >> 16) & 0xff] ^ T.te[2][(s0 >> 8) & 0xff] ^ T.te[3][s1 & 0xff] ^ rk[2];
+        t3 = T.te[0][s3 >> 24] ^ T.te[1][(s0 >> 16) & 0xff] ^ T.te[2][(s1 >> 8) & 0xff] ^ T.te[3][s2 & 0xff] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    // последний раунд без MixColumns
+    rk += 4;
+    t0 = (static_cast<quint32>(sbox[s0 >> 24]) << 24) ^ (static_cast<quint32>(sbox[(s1 >> 16) & 0xff]) << 16)
+       ^ (static_cast<quint32>(sbox[(s2 >> 8) & 0xff]) << 8) ^ static_cast<quint32>(sbox[s3 & 0xff]) ^ rk[0];
+    t1 = (static_cast<quint32>(sbox[s1 >> 24]) << 24) ^ (static_cast<quint32>(sbox[(s2 >> 16) & 0xff]) << 16)
+       ^ (static_cast<quint32>(sbox[(s3 >> 8) & 0xff]) << 8) ^ static_cast<quint32>(sbox[s0 & 0xff]) ^ rk[1];
+    t2 = (static_cast<quint32>(sbox[s2 >> 24]) << 24) ^ (static_cast<quint32>(sbox[(s3 >> 16) & 0xff]) << 16)
+       ^ (static_cast<quint32>(sbox[(s0 >> 8) & 0xff]) << 8) ^ static_cast<quint32>(sbox[s1 & 0xff]) ^ rk[2];
+    t3 = (static_cast<quint32>(sbox[s3 >> 24]) << 24) ^ (static_cast<quint32>(sbox[(s0 >> 16) & 0xff]) << 16)
+       ^ (static_cast<quint32>(sbox[(s1 >> 8) & 0xff]) << 8) ^ static_cast<quint32>(sbox[s2 & 0xff]) ^ rk[3];
+
+    AES_PUTU32(out     , t0);
+    AES_PUTU32(out +  4, t1);
+    AES_PUTU32(out +  8, t2);
+    AES_PUTU32(out + 12, t3);
+}
+
+void aes128_DecryptBlock(const AES128_KeySchedule &ks, const quint8 *in, quint8 *out)
+{
+    const AES128_Tables &T = aes128_Tables();
+    const quint32 *rk = ks.dec;
+
+    quint32 s0 = AES_GETU32(in     ) ^ rk[0];
+    quint32 s1 = AES_GETU32(in +  4) ^ rk[1];
+    quint32 s2 = AES_GETU32(in +  8) ^ rk[2];
+    quint32 s3 = AES_GETU32(in + 12) ^ rk[3];
+    quint32 t0, t1, t2, t3;
+
+    for (int round = 1; round < 10; ++round) {
+        rk += 4;
+        t0 = T.td[0][s0 >> 24] ^ T.td[1][(s3 >> 16) & 0xff] ^ T.td[2][(s2 >> 8) & 0xff] ^ T.td[3][s1 & 0xff] ^ rk[0];
+        t1 = T.td[0][s1 >> 24] ^ T.td[1][(s0 >> 16) & 0xff] ^ T.td[2][(s3 >> 8) & 0xff] ^ T.td[3][s2 & 0xff] ^ rk[1];
+        t2 = T.td[0][s2 >> 24] ^ T.td[1][(s1 >> 16) & 0xff] ^ T.td[2][(s0 >> 8) & 0xff] ^ T.td[3][s3 & 0xff] ^ rk[2];
+        t3 = T.td[0][s3 >> 24] ^ T.td[1][(s2 >> 16) & 0xff] ^ T.td[2][(s1 >> 8) & 0xff] ^ T.td[3][s0 & 0xff] ^ rk[3];
+        s0 = t0; s1 = t1; s2 = t2; s3 = t3;
+    }
+
+    // последний раунд без InvMixColumns
+    rk += 4;
+    t0 = (static_cast<quint32>(rsbox[s0 >> 24]) << 24) ^ (static_cast<quint32>(rsbox[(s3 >> 16) & 0xff]) << 16)
+       ^ (static_cast<quint32>(rsbox[(s2 >> 8) & 0xff]) << 8) ^ static_cast<quint32>(rsbox[s1 & 0xff]) ^ rk[0];
+    t1 = (static_cast<quint32>(rsbox[s1 >> 24]) << 24) ^ (static_cast<quint32>(rsbox[(s0 >> 16) & 0xff]) << 16)
+       ^ (static_cast<quint32>(rsbox[(s3 >> 8) & 0xff]) << 8) ^ static_cast<quint32>(rsbox[s2 & 0xff]) ^ rk[1];
+    t2 = (static_cast<quint32>(rsbox[s2 >> 24]) << 24) ^ (static_cast<quint32>(rsbox[(s1 >> 16) & 0xff]) << 16)
+       ^ (static_cast<quint32>(rsbox[(s0 >> 8) & 0xff]) << 8) ^ static_cast<quint32>(rsbox[s3 & 0xff]) ^ rk[2];
+    t3 = (static_cast<quint32>(rsbox[s3 >> 24]) << 24) ^ (static_cast<quint32>(rsbox[(s2 >> 16) & 0xff]) << 16)
+       ^ (static_cast<quint32>(rsbox[(s1 >> 8) & 0xff]) << 8) ^ static_cast<quint32>(rsbox[s0 & 0xff]) ^ rk[3];
+
+    AES_PUTU32(out     , t0);
+    AES_PUTU32(out +  4, t1);
+    AES_PUTU32(out +  8, t2);
+    AES_PUTU32(out + 12, t3);
+}
+
+/* AES-128 Table End Section =============================================================================*/
+
+/*  CPU Features ======================================================================================== */
+
+#ifdef NAYK_CRYPTO_X86
+
+// CPUID.01H:ECX, определяется один раз
+unsigned int cpuFeaturesEcx()
+{
+    static const unsigned int features = [] {
+        unsigned int ecx = 0;
+#if defined(_MSC_VER)
+        int info[4] = {0, 0, 0, 0};
+        __cpuid(info, 1);
+        ecx = static_cast<unsigned int>(info[2]);
+#else
+        unsigned int eax = 0, ebx = 0, edx = 0;
+        if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return 0u;
+#endif
+        return ecx;
+    }();
+    return features;
+}
+
+bool cpuHasAESNI()
+{
+    return (cpuFeaturesEcx() & (1u << 25)) != 0; // AES
+}
+
+bool cpuHasPCLMUL()
+{
+    const unsigned int mask = (1u << 1) | (1u << 19); // PCLMULQDQ + SSE4.1
+    return (cpuFeaturesEcx() & mask) == mask;
+}
+
+#endif // NAYK_CRYPTO_X86
+
+/*  AES-128 AES-NI Implementation ======================================================================= */
+
+#ifdef NAYK_CRYPTO_X86
+
+// блоки ECB независимы, поэтому обрабатываем по 4 блока за раз, чтобы загрузить конвейер aesenc
+NAYK_TARGET_AES
+void aes128_EncryptBlocksNI(const AES128_KeySchedule &ks, const quint8 *in, quint8 *out, qint64 blocks)
+{
+    __m128i rk[11];
+    for (int i = 0; i < 11; ++i) rk[i] = _mm_loadu_si128( reinterpret_cast<const __m128i*>(ks.encBytes + 16 * i) );
+
+    const __m128i *src = reinterpret_cast<const __m128i*>(in);
+    __m128i *dst = reinterpret_cast<__m128i*>(out);
+
+    for (; blocks >= 4; blocks -= 4, src += 4, dst += 4) {
+        __m128i b0 = _mm_xor_si128( _mm_loadu_si128(src    ), rk[0] );
+        __m128i b1 = _mm_xor_si128( _mm_loadu_si128(src + 1), rk[0] );
+        __m128i b2 = _mm_xor_si128( _mm_loadu_si128(src + 2), rk[0] );
+        __m128i b3 = _mm_xor_si128( _mm_loadu_si128(src + 3), rk[0] );
+        for (int r = 1; r < 10; ++r) {
+            b0 = _mm_aesenc_si128(b0, rk[r]);
+            b1 = _mm_aesenc_si128(b1, rk[r]);
+            b2 = _mm_aesenc_si128(b2, rk[r]);
+            b3 = _mm_aesenc_si128(b3, rk[r]);
+        }
+        _mm_storeu_si128( dst    , _mm_aesenclast_si128(b0, rk[10]) );
+        _mm_storeu_si128( dst + 1, _mm_aesenclast_si128(b1, rk[10]) );
+        _mm_storeu_si128( dst + 2, _mm_aesenclast_si128(b2, rk[10]) );
+        _mm_storeu_si128( dst + 3, _mm_aesenclast_si128(b3, rk[10]) );
+    }
+
+    for (; blocks > 0; --blocks, ++src, ++dst) {
+        __m128i b = _mm_xor_si128( _mm_loadu_si128(src), rk[0] );
+        for (int r = 1; r < 10; ++r) b = _mm_aesenc_si128(b, rk[r]);
+        _mm_storeu_si128( dst, _mm_aesenclast_si128(b, rk[10]) );
+    }
+}
+
+// ключи эквивалентного обратного шифра совпадают с ключами для aesdec (aesimc в обратном порядке)
+NAYK_TARGET_AES
+void aes128_DecryptBlocksNI(const AES128_KeySchedule &ks, const quint8 *in, quint8 *out, qint64 blocks)
+{
+    __m128i rk[11];
+    for (int i = 0; i < 11; ++i) rk[i] = _mm_loadu_si128( reinterpret_cast<const __m128i*>(ks.decBytes + 16 * i) );
+
+    const __m128i *src = reinterpret_cast<const __m128i*>(in);
+    __m128i *dst = reinterpret_cast<__m128i*>(out);
+
+    for (; blocks >= 4; blocks -= 4, src += 4, dst += 4) {
+        __m128i b0 = _mm_xor_si128( _mm_loadu_si128(src    ), rk[0] );
+        __m128i b1 = _mm_xor_si128( _mm_loadu_si128(src + 1), rk[0] );
+        __m128i b2 = _mm_xor_si128( _mm_loadu_si128(src + 2), rk[0] );
+        __m128i b3 = _mm_xor_si128( _mm_loadu_si128(src + 3), rk[0] );
+        for (int r = 1; r < 10; ++r) {
+            b0 = _mm_aesdec_si128(b0, rk[r]);
+            b1 = _mm_aesdec_si128(b1, rk[r]);
+            b2 = _mm_aesdec_si128(b2, rk[r]);
+            b3 = _mm_aesdec_si128(b3, rk[r]);
+        }
+        _mm_storeu_si128( dst    , _mm_aesdeclast_si128(b0, rk[10]) );
+        _mm_storeu_si128( dst + 1, _mm_aesdeclast_si128(b1, rk[10]) );
+        _mm_storeu_si128( dst + 2, _mm_aesdeclast_si128(b2, rk[10]) );
+        _mm_storeu_si128( dst + 3, _mm_aesdeclast_si128(b3, rk[10]) );
+    }
+
+    for (; blocks > 0; --blocks, ++src, ++dst) {
+        __m128i b = _mm_xor_si128( _mm_loadu_si128(src), rk[0] );
+        for (int r = 1; r < 10; ++r) b = _mm_aesdec_si128(b, rk[r]);
+        _mm_storeu_si128( dst, _mm_aesdeclast_si128(b, rk[10]) );
+    }
+}
+
+#endif // NAYK_CRYPTO_X86
+
+/* AES-128 AES-NI End Section ============================================================================*/
+
+// выбор реализации: AES-NI, если процессор поддерживает, иначе T-таблицы
+void aes128_EncryptBlocks(const AES128_KeySchedule &ks, const quint8 *in, quint8 *out, qint64 blocks)
+{
+#ifdef NAYK_CRYPTO_X86
+    if (cpuHasAESNI()) {
+        aes128_EncryptBlocksNI(ks, in, out, blocks);
+        return;
+    }
+#endif
+    for (qint64 i = 0; i < blocks; ++i) aes128_EncryptBlock(ks, in + 16 * i, out + 16 * i);
+}
+//==========================================================================================================
+void aes128_DecryptBlocks(const AES128_KeySchedule &ks, const quint8 *in, quint8 *out, qint64 blocks)
+{
+#ifdef NAYK_CRYPTO_X86
+    if (cpuHasAESNI()) {
+        aes128_DecryptBlocksNI(ks, in, out, blocks);
+        return;
+    }
+#endif
+    for (qint64 i = 0; i < blocks; ++i) aes128_DecryptBlock(ks, in + 16 * i, out + 16 * i);
+}
+//==========================================================================================================
+// CTR: блок счетчика n = IV + n (128 бит, big-endian), out = in xor AES(счетчик);
+// position - смещение в байтах от начала потока, поэтому любой диапазон обрабатывается независимо
+void aes128_CtrXor(const AES128_KeySchedule &ks, const quint8 *iv, qint64 position,
+                   const quint8 *in, quint8 *out, qint64 size)
+{
+    const int batchBlocks = 32; // счетчики шифруются пачкой (конвейер AES-NI)
+    quint8 counters[16 * batchBlocks];
+    quint8 stream[16 * batchBlocks];
+    const quint64 ivHi = qFromBigEndian<quint64>(iv);
+    const quint64 ivLo = qFromBigEndian<quint64>(iv + 8);
+    quint64 block = static_cast<quint64>(position / 16);
+    qint64 skip = position % 16;
+
+    while (size > 0) {
+        const qint64 blocks = qMin( static_cast<qint64>(batchBlocks), (skip + size + 15) / 16 );
+        for (qint64 i = 0; i < blocks; ++i) {
+            const quint64 lo = ivLo + block + static_cast<quint64>(i);
+            const quint64 hi = (lo < ivLo) ? ivHi + 1 : ivHi;
+            qToBigEndian<quint64>( hi, counters + 16 * i );
+            qToBigEndian<quint64>( lo, counters + 16 * i + 8 );
+        }
+        aes128_EncryptBlocks( ks, counters, stream, blocks );
+
+        const qint64 n = qMin( size, blocks * 16 - skip );
+        const quint8 *key = stream + skip;
+        for (qint64 i = 0; i < n; ++i) out[i] = in[i] ^ key[i];
+
+        in += n;
+        out += n;
+        size -= n;
+        block += static_cast<quint64>(blocks);
+        skip = 0;
+    }
+}
+
 quint8 reverse8(quint8 value)
 {
     value = static_cast<quint8>((value & 0xF0) >> 4 | (value & 0x0F) << 4);
@@ -230,10 +604,242 @@ quint8 reverse8(quint8 value)
     value = static_cast<quint8>((value & 0xAA) >> 1 | (value & 0x55) << 1);
     return value;
 }
+//==========================================================================================================
+// обработка буфера частями в пуле потоков библиотеки: func(offset, length), части кратны 16 байтам
+typedef std::function<void(qint64, qint64)> BlockFunc;
+
+void processBlocks(qint64 size, int chunks, const BlockFunc &func)
+{
+    const qint64 blocks = size / 16;
+    if ((chunks < 2) || (blocks < chunks)) {
+        func(0, size);
+        return;
+    }
+
+    const qint64 chunkSize = ((blocks + chunks - 1) / chunks) * 16;
+    parallelFor( static_cast<int>((size + chunkSize - 1) / chunkSize), [&func, size, chunkSize](int index) {
+        const qint64 offset = index * chunkSize;
+        func(offset, qMin(chunkSize, size - offset));
+    });
+}
+//==========================================================================================================
+/*  MD5 (RFC 1321) ===================================================================================== */
+
+// собственная реализация: дайджест пишется сразу в буфер вызывающего, без выделений памяти
+const quint32 md5_K[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+inline quint32 md5_Rotl(quint32 x, int c)
+{
+    return (x << c) | (x >> (32 - c));
+}
+
+#define MD5_STEP(f, a, b, c, d, k, s, i) \
+    a = b + md5_Rotl( a + f(b, c, d) + m[k] + md5_K[i], s )
+#define MD5_F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5_G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
+#define MD5_H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5_I(x, y, z) ((y) ^ ((x) | ~(z)))
+
+void md5_Transform(quint32 *state, const quint8 *block)
+{
+    quint32 m[16];
+    for (int i = 0; i < 16; ++i) m[i] = qFromLittleEndian<quint32>(block + 4 * i);
+
+    quint32 a = state[0], b = state[1], c = state[2], d = state[3];
+
+    for (int i = 0; i < 16; i += 4) {
+        MD5_STEP(MD5_F, a, b, c, d, i,     7, i);
+        MD5_STEP(MD5_F, d, a, b, c, i + 1, 12, i + 1);
+        MD5_STEP(MD5_F, c, d, a, b, i + 2, 17, i + 2);
+        MD5_STEP(MD5_F, b, c, d, a, i + 3, 22, i + 3);
+    }
+    for (int i = 16; i < 32; i += 4) {
+        MD5_STEP(MD5_G, a, b, c, d, (5 * i + 1) & 15,  5, i);
+        MD5_STEP(MD5_G, d, a, b, c, (5 * i + 6) & 15,  9, i + 1);
+        MD5_STEP(MD5_G, c, d, a, b, (5 * i + 11) & 15, 14, i + 2);
+        MD5_STEP(MD5_G, b, c, d, a, (5 * i + 16) & 15, 20, i + 3);
+    }
+    for (int i = 32; i < 48; i += 4) {
+        MD5_STEP(MD5_H, a, b, c, d, (3 * i + 5) & 15,  4, i);
+        MD5_STEP(MD5_H, d, a, b, c, (3 * i + 8) & 15,  11, i + 1);
+        MD5_STEP(MD5_H, c, d, a, b, (3 * i + 11) & 15, 16, i + 2);
+        MD5_STEP(MD5_H, b, c, d, a, (3 * i + 14) & 15, 23, i + 3);
+    }
+    for (int i = 48; i < 64; i += 4) {
+        MD5_STEP(MD5_I, a, b, c, d, (7 * i) & 15,      6, i);
+        MD5_STEP(MD5_I, d, a, b, c, (7 * i + 7) & 15,  10, i + 1);
+        MD5_STEP(MD5_I, c, d, a, b, (7 * i + 14) & 15, 15, i + 2);
+        MD5_STEP(MD5_I, b, c, d, a, (7 * i + 21) & 15, 21, i + 3);
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+#undef MD5_STEP
+#undef MD5_F
+#undef MD5_G
+#undef MD5_H
+#undef MD5_I
+
+void md5_Digest(const quint8 *data, qint64 size, quint8 *digest)
+{
+    quint32 state[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+    const quint64 bits = static_cast<quint64>(size) * 8;
+
+    for (; size >= 64; size -= 64, data += 64) md5_Transform( state, data );
+
+    // хвост: 0x80, нули, длина в битах (little-endian) - один или два блока
+    quint8 tail[128];
+    memcpy( tail, data, static_cast<size_t>(size) );
+    tail[size] = 0x80;
+    const qint64 tailSize = (size < 56) ? 64 : 128;
+    memset( tail + size + 1, 0, static_cast<size_t>(tailSize - size - 9) );
+    qToLittleEndian<quint64>( bits, tail + tailSize - 8 );
+    md5_Transform( state, tail );
+    if (tailSize == 128) md5_Transform( state, tail + 64 );
+
+    for (int i = 0; i < 4; ++i) qToLittleEndian<quint32>( state[i], digest + 4 * i );
+}
+
+void md5_Hex(const quint8 *digest, char *hex)
+{
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < 16; ++i) {
+        hex[2 * i]     = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 0x0F];
+    }
+}
+
+// пакетный MD5: digestItem(i, digest) считает дайджест i-го входа, результаты подряд в out
+typedef std::function<void(qint64, quint8*)> DigestFunc;
+const int Md5BatchParallelMin = 1024; // меньшие пакеты не делятся между потоками
+
+void md5_Batch(int count, char *out, bool hex, int threadCount, const DigestFunc &digestItem)
+{
+    int chunks = 1;
+    if ((threadCount != 1) && (count >= Md5BatchParallelMin)) {
+        chunks = (threadCount > 1) ? threadCount : parallelThreadCount();
+    }
+    // processBlocks делит буфер блоками по 16 байт: один блок - один вход
+    processBlocks( static_cast<qint64>(count) * 16, chunks, [out, hex, &digestItem](qint64 offset, qint64 length) {
+        quint8 digest[16];
+        for (qint64 i = offset / 16; i < (offset + length) / 16; ++i) {
+            if (hex) {
+                digestItem( i, digest );
+                md5_Hex( digest, out + 32 * i );
+            }
+            else {
+                digestItem( i, reinterpret_cast<quint8*>(out + 16 * i) );
+            }
+        }
+    });
+}
+
+/* MD5 End Section ======================================================================================*/
+
 //==========================================================================================================
 const QString Err_Empty_InData          = QObject::tr("Нет входящих данных.");
 const QString Err_Length_InData         = QObject::tr("Неверная длина входящих данных.");
 const QString Err_Empty_Key             = QObject::tr("Не указан ключ шифрования.");
+const QString Err_Key_NotBound          = QObject::tr("Ключ шифрования не привязан.");
+const QString Err_Device_Read           = QObject::tr("Ошибка чтения входящих данных.");
+const QString Err_Device_Write          = QObject::tr("Ошибка записи результата.");
+const QString Err_Auth_Failed           = QObject::tr("Данные повреждены или ключ неверен (не совпал код аутентификации).");
+const QString Err_Range                 = QObject::tr("Неверный диапазон данных.");
+const QString Err_Alg_Mode              = QObject::tr("Операция недоступна для выбранного алгоритма.");
+const int DeviceReadTimeout             = 30000;
+const int CtrIvSize                     = 16;
+const int CtrTagSize                    = 32; // HMAC-SHA256
+
+//==========================================================================================================
+// чтение до size байт, для последовательных устройств - с ожиданием данных;
+// -1 - ошибка, результат меньше size - конец данных
+qint64 readDevice(QIODevice *device, char *data, qint64 size)
+{
+    qint64 filled = 0;
+    while (filled < size) {
+        const qint64 n = device->read( data + filled, size - filled );
+        if (n < 0) return -1;
+        if (n == 0) {
+            if (device->isSequential() && !device->atEnd()
+                    && device->waitForReadyRead(DeviceReadTimeout)) continue;
+            break;
+        }
+        filled += n;
+    }
+    return filled;
+}
+//==========================================================================================================
+// случайный IV для режима CTR
+void fillRandom(quint8 *data, int size)
+{
+    quint32 value[CtrIvSize / 4];
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+    QRandomGenerator::system()->fillRange( value, CtrIvSize / 4 );
+#else
+    std::random_device rd;
+    for (quint32 &v: value) v = rd();
+#endif
+    memcpy( data, value, static_cast<size_t>(qMin(size, CtrIvSize)) );
+}
+//==========================================================================================================
+// сравнение за постоянное время (не зависит от позиции первого отличия)
+bool equalTags(const quint8 *a, const quint8 *b, int size)
+{
+    quint8 diff = 0;
+    for (int i = 0; i < size; ++i) diff |= a[i] ^ b[i];
+    return diff == 0;
+}
+
+//==========================================================================================================
+// ключ, подготовленный для шифрования: MD5 от пароля и расписание раундовых ключей,
+// для CTR_HMAC - отдельный ключ HMAC (SHA-256 от пароля)
+struct CryptoKeyData
+{
+    quint8 md5Key[16];
+    quint8 macKey[32];
+    AES128_KeySchedule schedule;
+};
+
+QSharedPointer<const CryptoKeyData> makeKeyData(const QString &key, bool withMac)
+{
+    QSharedPointer<CryptoKeyData> res(new CryptoKeyData);
+    const QByteArray keyUtf8 = key.toUtf8();
+    md5_Digest( reinterpret_cast<const quint8*>(keyUtf8.constData()), keyUtf8.size(), res->md5Key );
+    aes128_ExpandKey( res->md5Key, res->schedule );
+    if (withMac) {
+        const QByteArray macKey = QCryptographicHash::hash( keyUtf8, QCryptographicHash::Sha256 );
+        memcpy( res->macKey, macKey.constData(), 32 );
+    }
+    else {
+        memset( res->macKey, 0, 32 );
+    }
+    return res;
+}
+//==========================================================================================================
+// HMAC-SHA256 от IV и шифротекста
+QByteArray ctrMac(const CryptoKeyData &key, const quint8 *data, qint64 size)
+{
+    QMessageAuthenticationCode mac( QCryptographicHash::Sha256,
+                                    QByteArray::fromRawData(reinterpret_cast<const char*>(key.macKey), 32) );
+    const qint64 portion = 1 << 30;
+    for (; size > 0; size -= portion, data += portion) {
+        mac.addData( reinterpret_cast<const char*>(data), static_cast<int>(qMin(size, portion)) );
+    }
+    return mac.result();
+}
 
 //==========================================================================================================
 Crypto::Crypto(CryptoAlg algorythm)
@@ -260,7 +866,8 @@ bool Crypto::decryptData(const QString &inData, const QString &key, QString &out
     QByteArray inDataBuf = QByteArray::fromHex( inData.toUtf8() );
     QByteArray outDataBuf;
     if (!decryptData(inDataBuf, key, outDataBuf)) return false;
-    outData = QString::fromUtf8( outDataBuf ).trimmed();
+    // в ECB дополнение нулями убирается trimmed(), в CTR дополнения нет
+    outData = isCtr() ? QString::fromUtf8( outDataBuf ) : QString::fromUtf8( outDataBuf ).trimmed();
     return true;
 }
 //==========================================================================================================
@@ -276,24 +883,14 @@ bool Crypto::encryptData(const QByteArray &inData, const QString &key, QByteArra
         return false;
     }
 
-    QByteArray md5Key = QCryptographicHash::hash( key.toUtf8(), QCryptographicHash::Md5 );
-    outData.clear();
-
-    switch (_algorythm) {
-    case CryptoAlg_TexasAES128:
-        outData = encryptAES128(inData, md5Key);
-        break;
-    //default:
-    //    break;
-    }
-
+    encryptArray( inData, *keyData(key), outData );
     return true;
 }
 //==========================================================================================================
 bool Crypto::decryptData(const QByteArray &inData, const QString &key, QByteArray &outData)
 {
     _lastError = "";
-    if (inData.isNull() || inData.isEmpty() || ((inData.size() % 16) != 0)) {
+    if (inData.isNull() || !checkEncryptedSize(inData.size())) {
         _lastError = Err_Length_InData;
         return false;
     }
@@ -302,207 +899,811 @@ bool Crypto::decryptData(const QByteArray &inData, const QString &key, QByteArra
         return false;
     }
 
-    QByteArray md5Key = QCryptographicHash::hash( key.toUtf8(), QCryptographicHash::Md5 );
-    outData.clear();
-
-    switch (_algorythm) {
-    case CryptoAlg_TexasAES128:
-        outData = decryptAES128(inData, md5Key);
-        break;
-    //default:
-    //    break;
+    return decryptArray( inData, *keyData(key), outData );
+}
+//==========================================================================================================
+bool Crypto::encryptRaw(const quint8 *inData, qint64 size, const QString &key, quint8 *outData)
+{
+    _lastError = "";
+    if (!inData || !outData || (size <= 0)) {
+        _lastError = Err_Empty_InData;
+        return false;
+    }
+    if (key.isNull() || key.isEmpty()) {
+        _lastError = Err_Empty_Key;
+        return false;
     }
 
+    encryptRaw( inData, size, *keyData(key), outData );
     return true;
 }
 //==========================================================================================================
-QByteArray Crypto::encryptAES128(const QByteArray &data, const QByteArray &md5Key)
+bool Crypto::decryptRaw(const quint8 *inData, qint64 size, const QString &key, quint8 *outData)
 {
-    if (data.isEmpty()) return QByteArray();
-    QByteArray dataBuf(data);
-    QByteArray resBuf;
-    while (dataBuf.size() % 16 != 0) dataBuf.append( static_cast<char>(0) );
-    for(int i=0; i<dataBuf.size(); i+=16) {
-        resBuf.append( encryptAES128_Block( dataBuf.mid(i, 16), md5Key ) );
+    _lastError = "";
+    if (!inData || !outData || !checkEncryptedSize(size)) {
+        _lastError = Err_Length_InData;
+        return false;
     }
-    return resBuf;
+    if (key.isNull() || key.isEmpty()) {
+        _lastError = Err_Empty_Key;
+        return false;
+    }
+
+    return decryptRaw( inData, size, *keyData(key), outData );
 }
 //==========================================================================================================
-QByteArray Crypto::decryptAES128(const QByteArray &data, const QByteArray &md5Key)
+bool Crypto::encryptInPlace(QByteArray &data, const QString &key)
 {
-    if (data.isEmpty() || ((data.size() % 16) != 0)) return QByteArray();
-    QByteArray resBuf;
-
-    for(int i=0; i<data.size(); i+=16) {
-        resBuf.append( decryptAES128_Block( data.mid(i, 16), md5Key ) );
-    }
-    return resBuf;
+    return encryptData(data, key, data);
 }
 //==========================================================================================================
-QByteArray Crypto::encryptAES128_Block(const QByteArray &dataBuf, const QByteArray &md5Key)
+bool Crypto::decryptInPlace(QByteArray &data, const QString &key)
 {
-    unsigned char *ucBuf;
-    unsigned char *ucKey;
-    int keySize;
-    int bufSize;
-
-    keySize = md5Key.size(); // 16 байт = 128 бит
-    ucKey = new unsigned char [ static_cast<unsigned long>(keySize) ];
-    for(auto i=0; i<keySize; i++) {
-        ucKey[i] = static_cast<unsigned char>( md5Key.at(i) & 0xFF );
-    }
-
-    bufSize = dataBuf.size();
-    while (bufSize%16 != 0) bufSize++; // размер должен быть кратным 128 бит
-    ucBuf = new unsigned char [ static_cast<unsigned long>(bufSize) ];
-    for(int i=0; i<bufSize; i++) {
-        ucBuf[i] = (i<dataBuf.size()) ? static_cast<unsigned char>( dataBuf.at(i) & 0xFF ) : 0;
-    }
-
-    // шифрование:
-    aes_enc_dec( ucBuf, ucKey, 0 );
-
-    QByteArray res;
-    for(auto i=0; i<bufSize; i++) res.append( static_cast<char>( ucBuf[i] ) );
-
-    delete [] ucBuf;
-    delete [] ucKey;
-
-    return res;
+    return decryptData(data, key, data);
 }
 //==========================================================================================================
-QByteArray Crypto::decryptAES128_Block(const QByteArray &dataBuf, const QByteArray &md5Key)
+bool Crypto::bindKey(const QString &key)
 {
-    unsigned char *ucBuf;
-    unsigned char *ucKey;
-    int keySize;
-    int bufSize;
-
-    keySize = md5Key.size(); // 16 байт = 128 бит
-    ucKey = new unsigned char [ static_cast<unsigned long>(keySize) ];
-    for(auto i=0; i<keySize; i++) {
-        ucKey[i] = static_cast<unsigned char>( md5Key.at(i) & 0xFF );
-    }
-
-    bufSize = dataBuf.size();
-    while (bufSize%16 != 0) bufSize++; // размер должен быть кратным 128 бит
-    ucBuf = new unsigned char [static_cast<unsigned long>(bufSize)];
-    for(int i=0; i<bufSize; i++) {
-        ucBuf[i] = static_cast<unsigned char>( dataBuf.at(i) & 0xFF );
+    _lastError = "";
+    if (key.isNull() || key.isEmpty()) {
+        _lastError = Err_Empty_Key;
+        return false;
     }
+    if (_boundKey && (key == _boundKeyString)) return true;
 
-    // дешифрование:
-    aes_enc_dec( ucBuf, ucKey, 1 );
-
-    QByteArray res;
-    for(auto i=0; i<bufSize; i++) res.append( static_cast<char>(ucBuf[i]) );
-
-    delete [] ucBuf;
-    delete [] ucKey;
-
-    return res;
+    _boundKey = makeKeyData(key, _algorythm == CryptoAlg_AES128_CTR_HMAC);
+    _boundKeyString = key;
+    return true;
 }
 //==========================================================================================================
-QString Crypto::md5(const QString &data)
-{
-    return QString::fromUtf8(
-                QCryptographicHash::hash( data.toUtf8(), QCryptographicHash::Md5 ).toHex()
-           ).toLower();
-}
-//====================================================================================================
-QByteArray Crypto::md5Bytes(const QString &data)
+void Crypto::unbindKey()
 {
-    return QCryptographicHash::hash( data.toUtf8(), QCryptographicHash::Md5 );
+    _boundKey.reset();
+    _boundKeyString.clear();
 }
-//====================================================================================================
-/*
-Name :   CRC-8 Dallas
-Width :  8
-Poly :   0x31 = x^8 + x^5 + x^4 + x^0
-Init :   0x00
-RefIn :  True
-RefOut : True
-XorOut : 0x00
-Check :  0xA1 = "123456789"
-*/
-quint8 Crypto::crc8_Dallas(const QByteArray &data)
+//==========================================================================================================
+bool Crypto::encryptBound(const QByteArray &inData, QByteArray &outData)
 {
-    quint8 crc = 0;
-    for(auto n=0; n<data.size(); ++n) {
-        quint8 inbyte = static_cast<quint8>( data.at(n) & 0xFF );
-        for (quint8 i = 8; i; i--) {
-            quint8 mix = (crc ^ inbyte) & 0x01;
-            crc >>= 1;
-            if (mix) crc ^= 0x8C;
-            inbyte >>= 1;
-        }
+    _lastError = "";
+    if (inData.isNull() || inData.isEmpty()) {
+        _lastError = Err_Empty_InData;
+        return false;
     }
-    return crc;
-}
-//====================================================================================================
-quint8 Crypto::crc8_Dallas(const QVector<quint8> &data)
-{
-    quint8 crc = 0;
-    for(int n=0; n<data.size(); ++n) {
-        quint8 inbyte = data.at(n);
-        for (quint8 i = 8; i; i--) {
-            quint8 mix = (crc ^ inbyte) & 0x01;
-            crc >>= 1;
-            if (mix) crc ^= 0x8C;
-            inbyte >>= 1;
-        }
+    if (!_boundKey) {
+        _lastError = Err_Key_NotBound;
+        return false;
     }
-    return crc;
+
+    encryptArray( inData, *_boundKey, outData );
+    return true;
 }
 //==========================================================================================================
-quint8 Crypto::crc8_Dallas(const quint8 * data, qint32 size)
+bool Crypto::decryptBound(const QByteArray &inData, QByteArray &outData)
 {
-    quint8 crc = 0;
-    while (size--) {
-        quint8 inbyte = *data++;
-        for (quint8 i = 8; i; i--) {
-            quint8 mix = (crc ^ inbyte) & 0x01;
-            crc >>= 1;
-            if (mix) crc ^= 0x8C;
-            inbyte >>= 1;
-        }
+    _lastError = "";
+    if (inData.isNull() || !checkEncryptedSize(inData.size())) {
+        _lastError = Err_Length_InData;
+        return false;
     }
-    return crc;
-}
-//==================================================================================================
-const quint8 crc8_Table[256] = {
-    0x00, 0x31, 0x62, 0x53, 0xC4, 0xF5, 0xA6, 0x97,
-    0xB9, 0x88, 0xDB, 0xEA, 0x7D, 0x4C, 0x1F, 0x2E,
-    0x43, 0x72, 0x21, 0x10, 0x87, 0xB6, 0xE5, 0xD4,
-    0xFA, 0xCB, 0x98, 0xA9, 0x3E, 0x0F, 0x5C, 0x6D,
-    0x86, 0xB7, 0xE4, 0xD5, 0x42, 0x73, 0x20, 0x11,
-    0x3F, 0x0E, 0x5D, 0x6C, 0xFB, 0xCA, 0x99, 0xA8,
-    0xC5, 0xF4, 0xA7, 0x96, 0x01, 0x30, 0x63, 0x52,
-    0x7C, 0x4D, 0x1E, 0x2F, 0xB8, 0x89, 0xDA, 0xEB,
-    0x3D, 0x0C, 0x5F, 0x6E, 0xF9, 0xC8, 0x9B, 0xAA,
-    0x84, 0xB5, 0xE6, 0xD7, 0x40, 0x71, 0x22, 0x13,
-    0x7E, 0x4F, 0x1C, 0x2D, 0xBA, 0x8B, 0xD8, 0xE9,
-    0xC7, 0xF6, 0xA5, 0x94, 0x03, 0x32, 0x61, 0x50,
-    0xBB, 0x8A, 0xD9, 0xE8, 0x7F, 0x4E, 0x1D, 0x2C,
-    0x02, 0x33, 0x60, 0x51, 0xC6, 0xF7, 0xA4, 0x95,
-    0xF8, 0xC9, 0x9A, 0xAB, 0x3C, 0x0D, 0x5E, 0x6F,
-    0x41, 0x70, 0x23, 0x12, 0x85, 0xB4, 0xE7, 0xD6,
-    0x7A, 0x4B, 0x18, 0x29, 0xBE, 0x8F, 0xDC, 0xED,
-    0xC3, 0xF2, 0xA1, 0x90, 0x07, 0x36, 0x65, 0x54,
-    0x39, 0x08, 0x5B, 0x6A, 0xFD, 0xCC, 0x9F, 0xAE,
-    0x80, 0xB1, 0xE2, 0xD3, 0x44, 0x75, 0x26, 0x17,
-    0xFC, 0xCD, 0x9E, 0xAF, 0x38, 0x09, 0x5A, 0x6B,
-    0x45, 0x74, 0x27, 0x16, 0x81, 0xB0, 0xE3, 0xD2,
-    0xBF, 0x8E, 0xDD, 0xEC, 0x7B, 0x4A, 0x19, 0x28,
-    0x06, 0x37, 0x64, 0x55, 0xC2, 0xF3, 0xA0, 0x91,
-    0x47, 0x76, 0x25, 0x14, 0x83, 0xB2, 0xE1, 0xD0,
-    0xFE, 0xCF, 0x9C, 0xAD, 0x3A, 0x0B, 0x58, 0x69,
-    0x04, 0x35, 0x66, 0x57, 0xC0, 0xF1, 0xA2, 0x93,
-    0xBD, 0x8C, 0xDF, 0xEE, 0x79, 0x48, 0x1B, 0x2A,
-    0xC1, 0xF0, 0xA3, 0x92, 0x05, 0x34, 0x67, 0x56,
-    0x78, 0x49, 0x1A, 0x2B, 0xBC, 0x8D, 0xDE, 0xEF,
-    0x82, 0xB3, 0xE0, 0xD1, 0x46, 0x77, 0x24, 0x15,
-    0x3B, 0x0A, 0x59, 0x68, 0xFF, 0xCE, 0x9D, 0xAC  };
+    if (!_boundKey) {
+        _lastError = Err_Key_NotBound;
+        return false;
+    }
+
+    return decryptArray( inData, *_boundKey, outData );
+}
+//==========================================================================================================
+bool Crypto::encryptBound(const quint8 *inData, qint64 size, quint8 *outData)
+{
+    _lastError = "";
+    if (!inData || !outData || (size <= 0)) {
+        _lastError = Err_Empty_InData;
+        return false;
+    }
+    if (!_boundKey) {
+        _lastError = Err_Key_NotBound;
+        return false;
+    }
+
+    encryptRaw( inData, size, *_boundKey, outData );
+    return true;
+}
+//==========================================================================================================
+bool Crypto::decryptBound(const quint8 *inData, qint64 size, quint8 *outData)
+{
+    _lastError = "";
+    if (!inData || !outData || !checkEncryptedSize(size)) {
+        _lastError = Err_Length_InData;
+        return false;
+    }
+    if (!_boundKey) {
+        _lastError = Err_Key_NotBound;
+        return false;
+    }
+
+    return decryptRaw( inData, size, *_boundKey, outData );
+}
+//==========================================================================================================
+bool Crypto::encryptDevice(QIODevice *inDevice, QIODevice *outDevice, const QString &key, qint64 chunkSize)
+{
+    _lastError = "";
+    if (key.isNull() || key.isEmpty()) {
+        _lastError = Err_Empty_Key;
+        return false;
+    }
+    return processDevice( inDevice, outDevice, *keyData(key), chunkSize, true );
+}
+//==========================================================================================================
+bool Crypto::decryptDevice(QIODevice *inDevice, QIODevice *outDevice, const QString &key, qint64 chunkSize)
+{
+    _lastError = "";
+    if (key.isNull() || key.isEmpty()) {
+        _lastError = Err_Empty_Key;
+        return false;
+    }
+    return processDevice( inDevice, outDevice, *keyData(key), chunkSize, false );
+}
+//==========================================================================================================
+bool Crypto::encryptDevice(QIODevice *inDevice, QIODevice *outDevice, qint64 chunkSize)
+{
+    _lastError = "";
+    if (!_boundKey) {
+        _lastError = Err_Key_NotBound;
+        return false;
+    }
+    return processDevice( inDevice, outDevice, *_boundKey, chunkSize, true );
+}
+//==========================================================================================================
+bool Crypto::decryptDevice(QIODevice *inDevice, QIODevice *outDevice, qint64 chunkSize)
+{
+    _lastError = "";
+    if (!_boundKey) {
+        _lastError = Err_Key_NotBound;
+        return false;
+    }
+    return processDevice( inDevice, outDevice, *_boundKey, chunkSize, false );
+}
+//==========================================================================================================
+bool Crypto::processDevice(QIODevice *inDevice, QIODevice *outDevice, const CryptoKeyData &key,
+                           qint64 chunkSize, bool encrypt)
+{
+    if (!inDevice || !inDevice->isReadable()) {
+        _lastError = Err_Device_Read;
+        return false;
+    }
+    if (!outDevice || !outDevice->isWritable()) {
+        _lastError = Err_Device_Write;
+        return false;
+    }
+
+    if (isCtr()) return processDeviceCtr( inDevice, outDevice, key, chunkSize, encrypt );
+
+    // буфер постоянного размера (кратен 16), независимо от объема данных
+    chunkSize = qMax( encryptedSize(chunkSize), static_cast<qint64>(16) );
+    QByteArray buffer( static_cast<int>(chunkSize), 0 );
+    quint8 *buf = reinterpret_cast<quint8*>( buffer.data() );
+    qint64 total = 0;
+    bool eof = false;
+
+    while (!eof) {
+        qint64 filled = readDevice( inDevice, buffer.data(), chunkSize );
+        if (filled < 0) {
+            _lastError = Err_Device_Read;
+            return false;
+        }
+        eof = (filled < chunkSize);
+        total += filled;
+        if (filled == 0) break;
+
+        if (encrypt) {
+            const qint64 bufSize = encryptedSize(filled);
+            memset( buf + filled, 0, static_cast<size_t>(bufSize - filled) );
+            filled = bufSize;
+            encryptBuffer( buf, filled, key );
+        }
+        else {
+            if ((filled % 16) != 0) {
+                _lastError = Err_Length_InData;
+                return false;
+            }
+            decryptBuffer( buf, filled, key );
+        }
+
+        if (outDevice->write( buffer.constData(), filled ) != filled) {
+            _lastError = Err_Device_Write;
+            return false;
+        }
+    }
+
+    if (total == 0) {
+        _lastError = encrypt ? Err_Empty_InData : Err_Length_InData;
+        return false;
+    }
+    return true;
+}
+//==========================================================================================================
+bool Crypto::processDeviceCtr(QIODevice *inDevice, QIODevice *outDevice, const CryptoKeyData &key,
+                              qint64 chunkSize, bool encrypt)
+{
+    const bool withMac = (_algorythm == CryptoAlg_AES128_CTR_HMAC);
+    const qint64 tagSize = withMac ? CtrTagSize : 0;
+    const QByteArray macKey = QByteArray::fromRawData( reinterpret_cast<const char*>(key.macKey), 32 );
+    QMessageAuthenticationCode mac( QCryptographicHash::Sha256, macKey );
+
+    // буфер постоянного размера + место под тег, который при расшифровке придерживается до конца потока
+    chunkSize = qMax( encryptedSize(chunkSize), static_cast<qint64>(16) );
+    QByteArray buffer( static_cast<int>(chunkSize + tagSize), 0 );
+    quint8 *buf = reinterpret_cast<quint8*>( buffer.data() );
+    quint8 iv[CtrIvSize];
+    qint64 position = 0;
+
+    if (encrypt) {
+        for (;;) {
+            const qint64 filled = readDevice( inDevice, buffer.data(), chunkSize );
+            if (filled < 0) {
+                _lastError = Err_Device_Read;
+                return false;
+            }
+            if (filled == 0) break;
+
+            if (position == 0) {
+                fillRandom( iv, CtrIvSize );
+                if (outDevice->write( reinterpret_cast<const char*>(iv), CtrIvSize ) != CtrIvSize) {
+                    _lastError = Err_Device_Write;
+                    return false;
+                }
+                if (withMac) mac.addData( reinterpret_cast<const char*>(iv), CtrIvSize );
+            }
+
+            ctrBuffer( iv, position, buf, buf, filled, key );
+            if (withMac) mac.addData( buffer.constData(), static_cast<int>(filled) );
+            if (outDevice->write( buffer.constData(), filled ) != filled) {
+                _lastError = Err_Device_Write;
+                return false;
+            }
+            position += filled;
+            if (filled < chunkSize) break;
+        }
+
+        if (position == 0) {
+            _lastError = Err_Empty_InData;
+            return false;
+        }
+        if (withMac && (outDevice->write( mac.result() ) != tagSize)) {
+            _lastError = Err_Device_Write;
+            return false;
+        }
+        return true;
+    }
+
+    if (readDevice( inDevice, reinterpret_cast<char*>(iv), CtrIvSize ) != CtrIvSize) {
+        _lastError = Err_Length_InData;
+        return false;
+    }
+
+    if (withMac) {
+        mac.addData( reinterpret_cast<const char*>(iv), CtrIvSize );
+
+        // при произвольном доступе тег проверяется до расшифровки: поврежденные данные не попадают в outDevice
+        if (!inDevice->isSequential()) {
+            const qint64 start = inDevice->pos();
+            qint64 rest = inDevice->size() - start - tagSize;
+            if (rest <= 0) {
+                _lastError = Err_Length_InData;
+                return false;
+            }
+            QMessageAuthenticationCode check( QCryptographicHash::Sha256, macKey );
+            check.addData( reinterpret_cast<const char*>(iv), CtrIvSize );
+            while (rest > 0) {
+                const qint64 n = readDevice( inDevice, buffer.data(), qMin(chunkSize, rest) );
+                if (n <= 0) {
+                    _lastError = Err_Device_Read;
+                    return false;
+                }
+                check.addData( buffer.constData(), static_cast<int>(n) );
+                rest -= n;
+            }
+            if ((readDevice( inDevice, buffer.data(), tagSize ) != tagSize)
+                    || !equalTags( reinterpret_cast<const quint8*>(check.result().constData()), buf, CtrTagSize )) {
+                _lastError = Err_Auth_Failed;
+                return false;
+            }
+            if (!inDevice->seek(start)) {
+                _lastError = Err_Device_Read;
+                return false;
+            }
+        }
+    }
+
+    // последние tagSize байт каждой порции могут оказаться тегом, поэтому переносятся в следующую
+    qint64 held = 0;
+    for (;;) {
+        const qint64 n = readDevice( inDevice, buffer.data() + held, chunkSize + tagSize - held );
+        if (n < 0) {
+            _lastError = Err_Device_Read;
+            return false;
+        }
+        const qint64 filled = held + n;
+        const qint64 size = filled - tagSize;
+        if (size < 0) {
+            _lastError = Err_Length_InData;
+            return false;
+        }
+        if (size > 0) {
+            if (withMac) mac.addData( buffer.constData(), static_cast<int>(size) );
+            ctrBuffer( iv, position, buf, buf, size, key );
+            if (outDevice->write( buffer.constData(), size ) != size) {
+                _lastError = Err_Device_Write;
+                return false;
+            }
+            position += size;
+        }
+        memmove( buf, buf + size, static_cast<size_t>(tagSize) );
+        held = tagSize;
+        if (filled < chunkSize + tagSize) break;
+    }
+
+    if (position == 0) {
+        _lastError = Err_Length_InData;
+        return false;
+    }
+    // для последовательного устройства тег проверяется в конце: при ошибке результат нужно отбросить
+    if (withMac && !equalTags( reinterpret_cast<const quint8*>(mac.result().constData()), buf, CtrTagSize )) {
+        _lastError = Err_Auth_Failed;
+        return false;
+    }
+    return true;
+}
+//==========================================================================================================
+bool Crypto::decryptRange(const QByteArray &inData, qint64 offset, qint64 length, const QString &key,
+                          QByteArray &outData)
+{
+    _lastError = "";
+    if (key.isNull() || key.isEmpty()) {
+        _lastError = Err_Empty_Key;
+        return false;
+    }
+    return decryptRange( inData, offset, length, *keyData(key), outData );
+}
+//==========================================================================================================
+bool Crypto::decryptRange(const QByteArray &inData, qint64 offset, qint64 length, QByteArray &outData)
+{
+    _lastError = "";
+    if (!_boundKey) {
+        _lastError = Err_Key_NotBound;
+        return false;
+    }
+    return decryptRange( inData, offset, length, *_boundKey, outData );
+}
+//==========================================================================================================
+bool Crypto::decryptRange(const QByteArray &inData, qint64 offset, qint64 length, const CryptoKeyData &key,
+                          QByteArray &outData)
+{
+    if (!isCtr()) {
+        _lastError = Err_Alg_Mode;
+        return false;
+    }
+    if (inData.isNull() || !checkEncryptedSize(inData.size())) {
+        _lastError = Err_Length_InData;
+        return false;
+    }
+    if ((offset < 0) || (length < 0) || (offset + length > decryptedSize(inData.size(), _algorythm))) {
+        _lastError = Err_Range;
+        return false;
+    }
+
+    const quint8 *data = reinterpret_cast<const quint8*>( inData.constData() );
+    if (!ctrVerify( data, inData.size(), key )) return false;
+
+    outData.resize( static_cast<int>(length) );
+    ctrBuffer( data, offset, data + CtrIvSize + offset, reinterpret_cast<quint8*>( outData.data() ), length, key );
+    return true;
+}
+//==========================================================================================================
+QSharedPointer<const CryptoKeyData> Crypto::keyData(const QString &key) const
+{
+    if (_boundKey && (key == _boundKeyString)) return _boundKey;
+    return makeKeyData(key, _algorythm == CryptoAlg_AES128_CTR_HMAC);
+}
+//==========================================================================================================
+void Crypto::encryptArray(const QByteArray &inData, const CryptoKeyData &key, QByteArray &outData)
+{
+    const int size = inData.size();
+
+    if (isCtr()) {
+        outData.resize( static_cast<int>( encryptedSize(size, _algorythm) ) );
+        quint8 *out = reinterpret_cast<quint8*>( outData.data() );
+        ctrEncrypt( (&outData == &inData) ? out : reinterpret_cast<const quint8*>( inData.constData() ),
+                    size, key, out );
+        return;
+    }
+
+    // единственное выделение памяти - под результат (если у outData не хватает емкости)
+    if (&outData == &inData) {
+        outData.resize( static_cast<int>( encryptedSize(size) ) );
+    }
+    else {
+        outData.resize( static_cast<int>( encryptedSize(size) ) );
+        memcpy( outData.data(), inData.constData(), static_cast<size_t>(size) );
+    }
+    memset( outData.data() + size, 0, static_cast<size_t>(outData.size() - size) );
+
+    encryptBuffer( reinterpret_cast<quint8*>( outData.data() ), outData.size(), key );
+}
+//==========================================================================================================
+bool Crypto::decryptArray(const QByteArray &inData, const CryptoKeyData &key, QByteArray &outData)
+{
+    if (isCtr()) {
+        const quint8 *in = reinterpret_cast<const quint8*>( inData.constData() );
+        if (!ctrVerify( in, inData.size(), key )) return false;
+
+        const int size = static_cast<int>( decryptedSize(inData.size(), _algorythm) );
+        if (&outData == &inData) {
+            quint8 *out = reinterpret_cast<quint8*>( outData.data() );
+            ctrDecrypt( out, outData.size(), key, out );
+        }
+        else {
+            outData.resize( size );
+            ctrDecrypt( in, inData.size(), key, reinterpret_cast<quint8*>( outData.data() ) );
+        }
+        outData.resize( size );
+        return true;
+    }
+
+    if (&outData != &inData) {
+        outData.resize( inData.size() );
+        memcpy( outData.data(), inData.constData(), static_cast<size_t>(inData.size()) );
+    }
+
+    decryptBuffer( reinterpret_cast<quint8*>( outData.data() ), outData.size(), key );
+    return true;
+}
+//==========================================================================================================
+void Crypto::encryptRaw(const quint8 *inData, qint64 size, const CryptoKeyData &key, quint8 *outData)
+{
+    if (isCtr()) {
+        ctrEncrypt( inData, size, key, outData );
+        return;
+    }
+
+    const qint64 bufSize = encryptedSize(size);
+
+    if (outData != inData) memmove( outData, inData, static_cast<size_t>(size) );
+    memset( outData + size, 0, static_cast<size_t>(bufSize - size) );
+
+    encryptBuffer( outData, bufSize, key );
+}
+//==========================================================================================================
+bool Crypto::decryptRaw(const quint8 *inData, qint64 size, const CryptoKeyData &key, quint8 *outData)
+{
+    if (isCtr()) {
+        if (!ctrVerify( inData, size, key )) return false;
+        ctrDecrypt( inData, size, key, outData );
+        return true;
+    }
+
+    if (outData != inData) memmove( outData, inData, static_cast<size_t>(size) );
+
+    decryptBuffer( outData, size, key );
+    return true;
+}
+//==========================================================================================================
+qint64 Crypto::encryptedSize(qint64 size)
+{
+    return (size + 15) & ~Q_INT64_C(15); // размер должен быть кратным 128 бит
+}
+//==========================================================================================================
+qint64 Crypto::encryptedSize(qint64 size, CryptoAlg algorythm)
+{
+    switch (algorythm) {
+    case CryptoAlg_AES128_CTR:
+        return CtrIvSize + size;
+    case CryptoAlg_AES128_CTR_HMAC:
+        return CtrIvSize + size + CtrTagSize;
+    default:
+        return encryptedSize(size);
+    }
+}
+//==========================================================================================================
+qint64 Crypto::decryptedSize(qint64 size, CryptoAlg algorythm)
+{
+    return qMax( size - encryptedSize(0, algorythm), static_cast<qint64>(0) );
+}
+//==========================================================================================================
+bool Crypto::isCtr() const
+{
+    return (_algorythm == CryptoAlg_AES128_CTR) || (_algorythm == CryptoAlg_AES128_CTR_HMAC);
+}
+//==========================================================================================================
+bool Crypto::checkEncryptedSize(qint64 size) const
+{
+    if (isCtr()) return size > encryptedSize(0, _algorythm);
+    return (size > 0) && ((size % 16) == 0);
+}
+//==========================================================================================================
+int Crypto::parallelChunks(qint64 size) const
+{
+    if (!_parallelMode || (size < _parallelThreshold)) return 1;
+    return (_parallelThreadCount > 0) ? _parallelThreadCount
+                                      : parallelThreadCount();
+}
+//==========================================================================================================
+void Crypto::encryptBuffer(quint8 *buf, qint64 size, const CryptoKeyData &key)
+{
+    switch (_algorythm) {
+    case CryptoAlg_TexasAES128: {
+        const AES128_KeySchedule &ks = key.schedule;
+        processBlocks( size, parallelChunks(size), [&ks, buf](qint64 offset, qint64 length) {
+            aes128_EncryptBlocks( ks, buf + offset, buf + offset, length / 16 );
+        });
+        break;
+    }
+    case CryptoAlg_TexasAES128_Compact:
+        processBlocks( size, parallelChunks(size), [&key, buf](qint64 offset, qint64 length) {
+            for(qint64 i=offset; i<offset+length; i+=16) {
+                unsigned char ucKey[16]; // aes_enc_dec портит ключ
+                memcpy( ucKey, key.md5Key, 16 );
+                aes_enc_dec( buf + i, ucKey, 0 );
+            }
+        });
+        break;
+    case CryptoAlg_AES128_CTR:
+    case CryptoAlg_AES128_CTR_HMAC:
+        break; // см. ctrBuffer
+    //default:
+    //    break;
+    }
+}
+//==========================================================================================================
+void Crypto::decryptBuffer(quint8 *buf, qint64 size, const CryptoKeyData &key)
+{
+    switch (_algorythm) {
+    case CryptoAlg_TexasAES128: {
+        const AES128_KeySchedule &ks = key.schedule;
+        processBlocks( size, parallelChunks(size), [&ks, buf](qint64 offset, qint64 length) {
+            aes128_DecryptBlocks( ks, buf + offset, buf + offset, length / 16 );
+        });
+        break;
+    }
+    case CryptoAlg_TexasAES128_Compact:
+        processBlocks( size, parallelChunks(size), [&key, buf](qint64 offset, qint64 length) {
+            for(qint64 i=offset; i<offset+length; i+=16) {
+                unsigned char ucKey[16];
+                memcpy( ucKey, key.md5Key, 16 );
+                aes_enc_dec( buf + i, ucKey, 1 );
+            }
+        });
+        break;
+    case CryptoAlg_AES128_CTR:
+    case CryptoAlg_AES128_CTR_HMAC:
+        break; // см. ctrBuffer
+    //default:
+    //    break;
+    }
+}
+//==========================================================================================================
+void Crypto::ctrBuffer(const quint8 *iv, qint64 position, const quint8 *in, quint8 *out, qint64 size,
+                       const CryptoKeyData &key)
+{
+    // блоки счетчика независимы: части буфера обрабатываются параллельно
+    const AES128_KeySchedule &ks = key.schedule;
+    processBlocks( size, parallelChunks(size), [&ks, iv, position, in, out](qint64 offset, qint64 length) {
+        aes128_CtrXor( ks, iv, position + offset, in + offset, out + offset, length );
+    });
+}
+//==========================================================================================================
+void Crypto::ctrEncrypt(const quint8 *inData, qint64 size, const CryptoKeyData &key, quint8 *outData)
+{
+    // при перекрытии буферов открытый текст сначала сдвигается на место шифротекста
+    const qint64 outSize = encryptedSize(size, _algorythm);
+    const bool overlap = (outData < inData + size) && (inData < outData + outSize);
+    if (overlap) {
+        memmove( outData + CtrIvSize, inData, static_cast<size_t>(size) );
+        inData = outData + CtrIvSize;
+    }
+
+    fillRandom( outData, CtrIvSize );
+    ctrBuffer( outData, 0, inData, outData + CtrIvSize, size, key );
+
+    if (_algorythm == CryptoAlg_AES128_CTR_HMAC) {
+        const QByteArray tag = ctrMac( key, outData, CtrIvSize + size );
+        memcpy( outData + CtrIvSize + size, tag.constData(), CtrTagSize );
+    }
+}
+//==========================================================================================================
+bool Crypto::ctrVerify(const quint8 *inData, qint64 size, const CryptoKeyData &key)
+{
+    if (_algorythm != CryptoAlg_AES128_CTR_HMAC) return true;
+
+    const qint64 macSize = size - CtrTagSize;
+    const QByteArray tag = ctrMac( key, inData, macSize );
+    if (!equalTags( reinterpret_cast<const quint8*>(tag.constData()), inData + macSize, CtrTagSize )) {
+        _lastError = Err_Auth_Failed;
+        return false;
+    }
+    return true;
+}
+//==========================================================================================================
+void Crypto::ctrDecrypt(const quint8 *inData, qint64 size, const CryptoKeyData &key, quint8 *outData)
+{
+    quint8 iv[CtrIvSize];
+    memcpy( iv, inData, CtrIvSize );
+
+    const qint64 outSize = decryptedSize(size, _algorythm);
+    const quint8 *in = inData + CtrIvSize;
+    const bool overlap = (outData < in + outSize) && (in < outData + outSize);
+    if (overlap && (outData != in)) {
+        memmove( outData, in, static_cast<size_t>(outSize) );
+        in = outData;
+    }
+    ctrBuffer( iv, 0, in, outData, outSize, key );
+}
+//==========================================================================================================
+QString Crypto::md5(const QString &data)
+{
+    const QByteArray utf8 = data.toUtf8();
+    quint8 digest[16];
+    char hex[32];
+    md5_Digest( reinterpret_cast<const quint8*>(utf8.constData()), utf8.size(), digest );
+    md5_Hex( digest, hex );
+    return QString::fromLatin1( hex, 32 );
+}
+//====================================================================================================
+QByteArray Crypto::md5Bytes(const QString &data)
+{
+    const QByteArray utf8 = data.toUtf8();
+    quint8 digest[16];
+    md5_Digest( reinterpret_cast<const quint8*>(utf8.constData()), utf8.size(), digest );
+    return QByteArray( reinterpret_cast<const char*>(digest), 16 );
+}
+//====================================================================================================
+void Crypto::md5Batch(const QList<QByteArray> &inData, QByteArray &outData, bool hex, int threadCount)
+{
+    outData.resize( inData.size() * (hex ? 32 : 16) );
+    md5_Batch( inData.size(), outData.data(), hex, threadCount, [&inData](qint64 i, quint8 *digest) {
+        const QByteArray &item = inData.at( static_cast<int>(i) );
+        md5_Digest( reinterpret_cast<const quint8*>(item.constData()), item.size(), digest );
+    });
+}
+//====================================================================================================
+void Crypto::md5Batch(const QStringList &inData, QByteArray &outData, bool hex, int threadCount)
+{
+    outData.resize( inData.size() * (hex ? 32 : 16) );
+    md5_Batch( inData.size(), outData.data(), hex, threadCount, [&inData](qint64 i, quint8 *digest) {
+        const QByteArray item = inData.at( static_cast<int>(i) ).toUtf8();
+        md5_Digest( reinterpret_cast<const quint8*>(item.constData()), item.size(), digest );
+    });
+}
+//====================================================================================================
+/*  CRC-32 PCLMULQDQ Implementation ===================================================================== */
+
+#ifdef NAYK_CRYPTO_X86
+
+// Свертка (folding) четырьмя 128-битными потоками умножением без переносов, затем редукция Барретта
+// (Intel, "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction").
+// crc - регистр без финальной инверсии, size >= 64 и кратен 16.
+NAYK_TARGET_PCLMUL
+quint32 crc32_PCLMUL(quint32 crc, const quint8 *data, qint64 size)
+{
+    // константы для полинома 0x04C11DB7 (отраженные): x^(4*128+32) и т.д. mod P
+    alignas(16) static const quint64 k1k2[2] = { Q_UINT64_C(0x0154442bd4), Q_UINT64_C(0x01c6e41596) };
+    alignas(16) static const quint64 k3k4[2] = { Q_UINT64_C(0x01751997d0), Q_UINT64_C(0x00ccaa009e) };
+    alignas(16) static const quint64 k5k0[2] = { Q_UINT64_C(0x0163cd6124), Q_UINT64_C(0x0000000000) };
+    alignas(16) static const quint64 poly[2] = { Q_UINT64_C(0x01db710641), Q_UINT64_C(0x01f7011641) };
+
+    const __m128i *src = reinterpret_cast<const __m128i*>(data);
+    __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+    x1 = _mm_loadu_si128(src    );
+    x2 = _mm_loadu_si128(src + 1);
+    x3 = _mm_loadu_si128(src + 2);
+    x4 = _mm_loadu_si128(src + 3);
+    x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(static_cast<int>(crc)));
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+    src += 4;
+    size -= 64;
+
+    // 4 x 128 бит за итерацию
+    for (; size >= 64; size -= 64, src += 4) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+        x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+        x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+        x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128(src    ));
+        x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128(src + 1));
+        x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128(src + 2));
+        x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128(src + 3));
+    }
+
+    // 4 потока -> 128 бит
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+    x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+    x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+    // оставшиеся блоки по 128 бит
+    for (; size >= 16; size -= 16, ++src) {
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(_mm_xor_si128(x1, _mm_loadu_si128(src)), x5);
+    }
+
+    // 128 -> 64 бита
+    x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+    x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+    x1 = _mm_srli_si128(x1, 8);
+    x1 = _mm_xor_si128(x1, x2);
+    x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+    x2 = _mm_srli_si128(x1, 4);
+    x1 = _mm_and_si128(x1, x3);
+    x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    // редукция Барретта до 32 бит
+    x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+    x2 = _mm_and_si128(x1, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+    x2 = _mm_and_si128(x2, x3);
+    x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+    x1 = _mm_xor_si128(x1, x2);
+
+    return static_cast<quint32>(_mm_extract_epi32(x1, 1));
+}
+
+#endif // NAYK_CRYPTO_X86
+
+/* CRC-32 PCLMULQDQ End Section ==========================================================================*/
+
+// CRC-32 без финальной инверсии: аппаратная свертка для больших буферов, хвост < 16 байт - таблицами
+quint32 crc32_Update(quint32 crc, const quint8 *data, qint64 size)
+{
+#ifdef NAYK_CRYPTO_X86
+    if ((size >= 64) && cpuHasPCLMUL()) {
+        const qint64 foldSize = size & ~Q_INT64_C(15);
+        crc = crc32_PCLMUL( crc, data, foldSize );
+        data += foldSize;
+        size -= foldSize;
+    }
+#endif
+    return Crc32_IsoHdlc::update( crc, data, size );
+}
+
+/*
+Name :   CRC-8 Dallas
+Width :  8
+Poly :   0x31 = x^8 + x^5 + x^4 + x^0
+Init :   0x00
+RefIn :  True
+RefOut : True
+XorOut : 0x00
+Check :  0xA1 = "123456789"
+*/
+quint8 Crypto::crc8_Dallas(const QByteArray &data)
+{
+    return crc8_Dallas( reinterpret_cast<const quint8*>(data.constData()), data.size() );
+}
+//====================================================================================================
+quint8 Crypto::crc8_Dallas(const QVector<quint8> &data)
+{
+    return crc8_Dallas( data.constData(), data.size() );
+}
+//==========================================================================================================
+quint8 Crypto::crc8_Dallas(const quint8 * data, qint32 size)
+{
+    return Crc8_Maxim::calc( data, size );
+}
+//==================================================================================================
 /*
   Name  : CRC-8
   Poly  : 0x31    x^8 + x^5 + x^4 + 1
@@ -514,64 +1715,19 @@ const quint8 crc8_Table[256] = {
 */
 quint8 Crypto::crc8(const QVector<quint8> &data)
 {
-    quint8 result = 0xFF;
-
-    for(int i=0; i<data.size(); i++) {
-        result = crc8_Table[ result ^ data.at(i) ];
-    }
-    return result;
+    return crc8( data.constData(), data.size() );
 }
 //==================================================================================================
 quint8 Crypto::crc8(const QByteArray &data)
 {
-    quint8 result = 0xFF;
-
-    for(int i=0; i<data.size(); i++) {
-        result = crc8_Table[ result ^ static_cast<quint8>(data.at(i)) ];
-    }
-    return result;
+    return crc8( reinterpret_cast<const quint8*>(data.constData()), data.size() );
 }
 //==================================================================================================
 quint8 Crypto::crc8(const quint8 *data, qint32 size)
 {
-    quint8 crc = 0xFF;
-    while (size--) crc = crc8_Table[crc ^ *data++];
-    return crc;
-}
-//==================================================================================================
-const quint16 crc16_CCITT_Table[256] = {
-    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
-    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
-    0x1231, 0x0210, 0x3273, 0x2252, 0x52B5, 0x4294, 0x72F7, 0x62D6,
-    0x9339, 0x8318, 0xB37B, 0xA35A, 0xD3BD, 0xC39C, 0xF3FF, 0xE3DE,
-    0x2462, 0x3443, 0x0420, 0x1401, 0x64E6, 0x74C7, 0x44A4, 0x5485,
-    0xA56A, 0xB54B, 0x8528, 0x9509, 0xE5EE, 0xF5CF, 0xC5AC, 0xD58D,
-    0x3653, 0x2672, 0x1611, 0x0630, 0x76D7, 0x66F6, 0x5695, 0x46B4,
-    0xB75B, 0xA77A, 0x9719, 0x8738, 0xF7DF, 0xE7FE, 0xD79D, 0xC7BC,
-    0x48C4, 0x58E5, 0x6886, 0x78A7, 0x0840, 0x1861, 0x2802, 0x3823,
-    0xC9CC, 0xD9ED, 0xE98E, 0xF9AF, 0x8948, 0x9969, 0xA90A, 0xB92B,
-    0x5AF5, 0x4AD4, 0x7AB7, 0x6A96, 0x1A71, 0x0A50, 0x3A33, 0x2A12,
-    0xDBFD, 0xCBDC, 0xFBBF, 0xEB9E, 0x9B79, 0x8B58, 0xBB3B, 0xAB1A,
-    0x6CA6, 0x7C87, 0x4CE4, 0x5CC5, 0x2C22, 0x3C03, 0x0C60, 0x1C41,
-    0xEDAE, 0xFD8F, 0xCDEC, 0xDDCD, 0xAD2A, 0xBD0B, 0x8D68, 0x9D49,
-    0x7E97, 0x6EB6, 0x5ED5, 0x4EF4, 0x3E13, 0x2E32, 0x1E51, 0x0E70,
-    0xFF9F, 0xEFBE, 0xDFDD, 0xCFFC, 0xBF1B, 0xAF3A, 0x9F59, 0x8F78,
-    0x9188, 0x81A9, 0xB1CA, 0xA1EB, 0xD10C, 0xC12D, 0xF14E, 0xE16F,
-    0x1080, 0x00A1, 0x30C2, 0x20E3, 0x5004, 0x4025, 0x7046, 0x6067,
-    0x83B9, 0x9398, 0xA3FB, 0xB3DA, 0xC33D, 0xD31C, 0xE37F, 0xF35E,
-    0x02B1, 0x1290, 0x22F3, 0x32D2, 0x4235, 0x5214, 0x6277, 0x7256,
-    0xB5EA, 0xA5CB, 0x95A8, 0x8589, 0xF56E, 0xE54F, 0xD52C, 0xC50D,
-    0x34E2, 0x24C3, 0x14A0, 0x0481, 0x7466, 0x6447, 0x5424, 0x4405,
-    0xA7DB, 0xB7FA, 0x8799, 0x97B8, 0xE75F, 0xF77E, 0xC71D, 0xD73C,
-    0x26D3, 0x36F2, 0x0691, 0x16B0, 0x6657, 0x7676, 0x4615, 0x5634,
-    0xD94C, 0xC96D, 0xF90E, 0xE92F, 0x99C8, 0x89E9, 0xB98A, 0xA9AB,
-    0x5844, 0x4865, 0x7806, 0x6827, 0x18C0, 0x08E1, 0x3882, 0x28A3,
-    0xCB7D, 0xDB5C, 0xEB3F, 0xFB1E, 0x8BF9, 0x9BD8, 0xABBB, 0xBB9A,
-    0x4A75, 0x5A54, 0x6A37, 0x7A16, 0x0AF1, 0x1AD0, 0x2AB3, 0x3A92,
-    0xFD2E, 0xED0F, 0xDD6C, 0xCD4D, 0xBDAA, 0xAD8B, 0x9DE8, 0x8DC9,
-    0x7C26, 0x6C07, 0x5C64, 0x4C45, 0x3CA2, 0x2C83, 0x1CE0, 0x0CC1,
-    0xEF1F, 0xFF3E, 0xCF5D, 0xDF7C, 0xAF9B, 0xBFBA, 0x8FD9, 0x9FF8,
-    0x6E17, 0x7E36, 0x4E55, 0x5E74, 0x2E93, 0x3EB2, 0x0ED1, 0x1EF0 };
+    return Crc8_Nrsc5::calc( data, size );
+}
+//==================================================================================================
 /*
   Name  : CRC-16 CCITT
   Poly  : 0x1021    x^16 + x^12 + x^5 + 1
@@ -583,65 +1739,19 @@ const quint16 crc16_CCITT_Table[256] = {
 */
 quint16 Crypto::crc16_Ccitt(const QVector<quint8> &data)
 {
-    quint16 result = 0xFFFF;
-
-    for(int i=0; i<data.size(); i++) {
-        result = static_cast<quint16>(result << 8) ^ crc16_CCITT_Table[ (result >> 8) ^ static_cast<quint8>(data.at(i)) ];
-    }
-    return result;
+    return crc16_Ccitt( data.constData(), data.size() );
 }
 //==================================================================================================
 quint16 Crypto::crc16_Ccitt(const QByteArray &data)
 {
-    quint16 result = 0xFFFF;
-
-    for(int i=0; i<data.size(); i++) {
-        result = static_cast<quint16>(result << 8) ^ crc16_CCITT_Table[ (result >> 8) ^ static_cast<quint8>(data.at(i)) ];
-    }
-    return result;
+    return crc16_Ccitt( reinterpret_cast<const quint8*>(data.constData()), data.size() );
 }
 //==================================================================================================
 quint16 Crypto::crc16_Ccitt(const quint8 *data, qint32 size)
 {
-    quint16 crc = 0xFFFF;
-
-    while (size--) crc = static_cast<quint16>(crc << 8) ^ crc16_CCITT_Table[(crc >> 8) ^ *data++];
-    return crc;
-}
-//==================================================================================================
-const quint16 crc16_Table[256] = {
-    0x0000, 0xC0C1, 0xC181, 0x0140, 0xC301, 0x03C0, 0x0280, 0xC241,
-    0xC601, 0x06C0, 0x0780, 0xC741, 0x0500, 0xC5C1, 0xC481, 0x0440,
-    0xCC01, 0x0CC0, 0x0D80, 0xCD41, 0x0F00, 0xCFC1, 0xCE81, 0x0E40,
-    0x0A00, 0xCAC1, 0xCB81, 0x0B40, 0xC901, 0x09C0, 0x0880, 0xC841,
-    0xD801, 0x18C0, 0x1980, 0xD941, 0x1B00, 0xDBC1, 0xDA81, 0x1A40,
-    0x1E00, 0xDEC1, 0xDF81, 0x1F40, 0xDD01, 0x1DC0, 0x1C80, 0xDC41,
-    0x1400, 0xD4C1, 0xD581, 0x1540, 0xD701, 0x17C0, 0x1680, 0xD641,
-    0xD201, 0x12C0, 0x1380, 0xD341, 0x1100, 0xD1C1, 0xD081, 0x1040,
-    0xF001, 0x30C0, 0x3180, 0xF141, 0x3300, 0xF3C1, 0xF281, 0x3240,
-    0x3600, 0xF6C1, 0xF781, 0x3740, 0xF501, 0x35C0, 0x3480, 0xF441,
-    0x3C00, 0xFCC1, 0xFD81, 0x3D40, 0xFF01, 0x3FC0, 0x3E80, 0xFE41,
-    0xFA01, 0x3AC0, 0x3B80, 0xFB41, 0x3900, 0xF9C1, 0xF881, 0x3840,
-    0x2800, 0xE8C1, 0xE981, 0x2940, 0xEB01, 0x2BC0, 0x2A80, 0xEA41,
-    0xEE01, 0x2EC0, 0x2F80, 0xEF41, 0x2D00, 0xEDC1, 0xEC81, 0x2C40,
-    0xE401, 0x24C0, 0x2580, 0xE541, 0x2700, 0xE7C1, 0xE681, 0x2640,
-    0x2200, 0xE2C1, 0xE381, 0x2340, 0xE101, 0x21C0, 0x2080, 0xE041,
-    0xA001, 0x60C0, 0x6180, 0xA141, 0x6300, 0xA3C1, 0xA281, 0x6240,
-    0x6600, 0xA6C1, 0xA781, 0x6740, 0xA501, 0x65C0, 0x6480, 0xA441,
-    0x6C00, 0xACC1, 0xAD81, 0x6D40, 0xAF01, 0x6FC0, 0x6E80, 0xAE41,
-    0xAA01, 0x6AC0, 0x6B80, 0xAB41, 0x6900, 0xA9C1, 0xA881, 0x6840,
-    0x7800, 0xB8C1, 0xB981, 0x7940, 0xBB01, 0x7BC0, 0x7A80, 0xBA41,
-    0xBE01, 0x7EC0, 0x7F80, 0xBF41, 0x7D00, 0xBDC1, 0xBC81, 0x7C40,
-    0xB401, 0x74C0, 0x7580, 0xB541, 0x7700, 0xB7C1, 0xB681, 0x7640,
-    0x7200, 0xB2C1, 0xB381, 0x7340, 0xB101, 0x71C0, 0x7080, 0xB041,
-    0x5000, 0x90C1, 0x9181, 0x5140, 0x9301, 0x53C0, 0x5280, 0x9241,
-    0x9601, 0x56C0, 0x5780, 0x9741, 0x5500, 0x95C1, 0x9481, 0x5440,
-    0x9C01, 0x5CC0, 0x5D80, 0x9D41, 0x5F00, 0x9FC1, 0x9E81, 0x5E40,
-    0x5A00, 0x9AC1, 0x9B81, 0x5B40, 0x9901, 0x59C0, 0x5880, 0x9841,
-    0x8801, 0x48C0, 0x4980, 0x8941, 0x4B00, 0x8BC1, 0x8A81, 0x4A40,
-    0x4E00, 0x8EC1, 0x8F81, 0x4F40, 0x8D01, 0x4DC0, 0x4C80, 0x8C41,
-    0x4400, 0x84C1, 0x8581, 0x4540, 0x8701, 0x47C0, 0x4680, 0x8641,
-    0x8201, 0x42C0, 0x4380, 0x8341, 0x4100, 0x81C1, 0x8081, 0x4040 };
+    return Crc16_Ibm3740::calc( data, size );
+}
+//==================================================================================================
 /*
   Name  : CRC 16
   Width : 16
@@ -654,29 +1764,18 @@ const quint16 crc16_Table[256] = {
 */
 quint16 Crypto::crc16(const QVector<quint8> &data)
 {
-    quint16 result = 0x0000;
-
-    for(int i=0; i<data.size(); i++) {
-        result = static_cast<quint16>(result >> 8) ^ crc16_Table[ (result ^ data.at(i)) & 0xFF ];
-    }
-    return result;
+    return Crc16_Arc::calc( data );
 }
 //==================================================================================================
 quint16 Crypto::crc16(const QByteArray &data)
 {
-    quint16 result = 0x0000;
-
-    for(int i=0; i<data.size(); i++) {
-        result = static_cast<quint16>(result >> 8) ^ crc16_Table[ (result ^ static_cast<quint8>(data.at(i))) & 0xFF ];
-    }
-    return result;
+    return Crc16_Arc::calc( data );
 }
 //==================================================================================================
 quint16 Crypto::crc16(const quint8 *data, qint32 size)
 {
-    quint16 crc = 0xFFFF;
-    while (size--) crc = (crc >> 8) ^ crc16_Table[(crc ^ *data++) & 0xFF];
-    return crc;
+    // исторически эта перегрузка начинает с 0xFFFF
+    return Crc16_Modbus::calc( data, size );
 }
 //==================================================================================================
 quint8 getIndexInCrc16Table(quint8 regValue)
@@ -685,7 +1784,7 @@ quint8 getIndexInCrc16Table(quint8 regValue)
     quint8 result = 0;
 
     while (i < 256) {
-        if( static_cast<quint8>(crc16_Table[i] >> 8) == regValue ) {
+        if( static_cast<quint8>(Crc16_Arc::tables.t[0][i] >> 8) == regValue ) {
             return static_cast<quint8>(i);
         }
         i++;
@@ -708,9 +1807,9 @@ quint16 Crypto::crc16_Restore(quint16 needCRC, quint16 newCRC)
     quint8 c0, n, k, x, y;
 
     n = getIndexInCrc16Table(d1);
-    c0 = static_cast<quint8>( crc16_Table[n] & 0x00FF);
+    c0 = static_cast<quint8>( Crc16_Arc::tables.t[0][n] & 0x00FF);
     k = getIndexInCrc16Table(c0 ^ d0);
-    b0 = static_cast<quint8>(crc16_Table[k] & 0x00FF);
+    b0 = static_cast<quint8>(Crc16_Arc::tables.t[0][k] & 0x00FF);
     y = a1 ^ b0 ^ n;
     x = a0 ^ k;
 
@@ -728,32 +1827,19 @@ quint16 Crypto::crc16_Restore(quint16 needCRC, quint16 newCRC)
 */
 quint16 Crypto::crc16_Arc(const QVector<quint8> &data)
 {
-    quint16 result = 0xFFFF;
-
-    for(int i=0; i<data.size(); i++) {
-        result = (result >> 8) ^ crc16_Table[ (result & 0xFF) ^ data.at(i) ];
-    }
-    return result;
+    return crc16_Arc( data.constData(), data.size() );
 }
 //==================================================================================================
 quint16 Crypto::crc16_Arc(const QByteArray &data)
 {
-    quint16 result = 0xFFFF;
-
-    for(int i=0; i<data.size(); i++) {
-        result = (result >> 8) ^ crc16_Table[ (result & 0xFF) ^ static_cast<quint8>(data.at(i)) ];
-    }
-    return result;
+    return crc16_Arc( reinterpret_cast<const quint8*>(data.constData()), data.size() );
 }
 //==================================================================================================
 quint16 Crypto::crc16_Arc(const quint8 *data, qint32 size)
 {
-    quint16 crc = 0xFFFF;
-    while (size--) crc = (crc >> 8) ^ crc16_Table[(crc & 0xFF) ^ *data++];
-    return crc;
+    return Crc16_Modbus::calc( data, size );
 }
 //==================================================================================================
-const quint16 wmPoly = 0x3D65;
 /*
   Name  : CRC-16 (Wireless MBus)
   Poly  : 0x3D65  x16 + x13 + x12 + x11 + x10 + x8 + x6 + x5 + x2 + 1
@@ -762,104 +1848,43 @@ const quint16 wmPoly = 0x3D65;
 */
 quint16 Crypto::crc16_Wmbus(const QVector<quint8> &data)
 {
-    quint16 result = 0x0000;
-
-    for(int i=0; i<data.size(); i++) {
-        result = result ^ static_cast<quint16>( (static_cast<quint16>(data.at(i)) & 0x00FF) << 8);
-        for (int n = 0; n < 8; n++)
-            result = static_cast<quint16>( result & 0x8000 ? (result << 1) ^ wmPoly : result << 1);
-    }
-    return result ^ 0xFFFF;
+    return crc16_Wmbus( data.constData(), data.size() );
 }
 //==================================================================================================
 quint16 Crypto::crc16_Wmbus(const QByteArray &data)
 {
-    quint16 result = 0x0000;
-
-    for(int i=0; i<data.size(); i++) {
-        result = result ^ static_cast<quint16>( (static_cast<quint16>(data.at(i)) & 0x00FF) << 8);
-        for (int n = 0; n < 8; n++)
-            result = static_cast<quint16>( result & 0x8000 ? (result << 1) ^ wmPoly : result << 1);
-    }
-    return result ^ 0xFFFF;
+    return crc16_Wmbus( reinterpret_cast<const quint8*>(data.constData()), data.size() );
 }
 //==================================================================================================
 quint16 Crypto::crc16_Wmbus(const quint8 *data, qint32 size)
 {
-    quint16 crc = 0x0000;
-    while (size--) {
-        crc = crc ^ static_cast<quint16>( static_cast<quint16>( *data++ )  << 8);
-        for (int n = 0; n < 8; n++)
-            crc = static_cast<quint16>(crc & 0x8000 ? (crc << 1) ^ wmPoly : crc << 1);
-    }
-    return crc ^ 0xFFFF;
-}
-//==================================================================================================
-const quint32 crc32_Table[256] = {
-    0x00000000, 0x77073096, 0xEE0E612C, 0x990951BA,
-    0x076DC419, 0x706AF48F, 0xE963A535, 0x9E6495A3,
-    0x0EDB8832, 0x79DCB8A4, 0xE0D5E91E, 0x97D2D988,
-    0x09B64C2B, 0x7EB17CBD, 0xE7B82D07, 0x90BF1D91,
-    0x1DB71064, 0x6AB020F2, 0xF3B97148, 0x84BE41DE,
-    0x1ADAD47D, 0x6DDDE4EB, 0xF4D4B551, 0x83D385C7,
-    0x136C9856, 0x646BA8C0, 0xFD62F97A, 0x8A65C9EC,
-    0x14015C4F, 0x63066CD9, 0xFA0F3D63, 0x8D080DF5,
-    0x3B6E20C8, 0x4C69105E, 0xD56041E4, 0xA2677172,
-    0x3C03E4D1, 0x4B04D447, 0xD20D85FD, 0xA50AB56B,
-    0x35B5A8FA, 0x42B2986C, 0xDBBBC9D6, 0xACBCF940,
-    0x32D86CE3, 0x45DF5C75, 0xDCD60DCF, 0xABD13D59,
-    0x26D930AC, 0x51DE003A, 0xC8D75180, 0xBFD06116,
-    0x21B4F4B5, 0x56B3C423, 0xCFBA9599, 0xB8BDA50F,
-    0x2802B89E, 0x5F058808, 0xC60CD9B2, 0xB10BE924,
-    0x2F6F7C87, 0x58684C11, 0xC1611DAB, 0xB6662D3D,
-    0x76DC4190, 0x01DB7106, 0x98D220BC, 0xEFD5102A,
-    0x71B18589, 0x06B6B51F, 0x9FBFE4A5, 0xE8B8D433,
-    0x7807C9A2, 0x0F00F934, 0x9609A88E, 0xE10E9818,
-    0x7F6A0DBB, 0x086D3D2D, 0x91646C97, 0xE6635C01,
-    0x6B6B51F4, 0x1C6C6162, 0x856530D8, 0xF262004E,
-    0x6C0695ED, 0x1B01A57B, 0x8208F4C1, 0xF50FC457,
-    0x65B0D9C6, 0x12B7E950, 0x8BBEB8EA, 0xFCB9887C,
-    0x62DD1DDF, 0x15DA2D49, 0x8CD37CF3, 0xFBD44C65,
-    0x4DB26158, 0x3AB551CE, 0xA3BC0074, 0xD4BB30E2,
-    0x4ADFA541, 0x3DD895D7, 0xA4D1C46D, 0xD3D6F4FB,
-    0x4369E96A, 0x346ED9FC, 0xAD678846, 0xDA60B8D0,
-    0x44042D73, 0x33031DE5, 0xAA0A4C5F, 0xDD0D7CC9,
-    0x5005713C, 0x270241AA, 0xBE0B1010, 0xC90C2086,
-    0x5768B525, 0x206F85B3, 0xB966D409, 0xCE61E49F,
-    0x5EDEF90E, 0x29D9C998, 0xB0D09822, 0xC7D7A8B4,
-    0x59B33D17, 0x2EB40D81, 0xB7BD5C3B, 0xC0BA6CAD,
-    0xEDB88320, 0x9ABFB3B6, 0x03B6E20C, 0x74B1D29A,
-    0xEAD54739, 0x9DD277AF, 0x04DB2615, 0x73DC1683,
-    0xE3630B12, 0x94643B84, 0x0D6D6A3E, 0x7A6A5AA8,
-    0xE40ECF0B, 0x9309FF9D, 0x0A00AE27, 0x7D079EB1,
-    0xF00F9344, 0x8708A3D2, 0x1E01F268, 0x6906C2FE,
-    0xF762575D, 0x806567CB, 0x196C3671, 0x6E6B06E7,
-    0xFED41B76, 0x89D32BE0, 0x10DA7A5A, 0x67DD4ACC,
-    0xF9B9DF6F, 0x8EBEEFF9, 0x17B7BE43, 0x60B08ED5,
-    0xD6D6A3E8, 0xA1D1937E, 0x38D8C2C4, 0x4FDFF252,
-    0xD1BB67F1, 0xA6BC5767, 0x3FB506DD, 0x48B2364B,
-    0xD80D2BDA, 0xAF0A1B4C, 0x36034AF6, 0x41047A60,
-    0xDF60EFC3, 0xA867DF55, 0x316E8EEF, 0x4669BE79,
-    0xCB61B38C, 0xBC66831A, 0x256FD2A0, 0x5268E236,
-    0xCC0C7795, 0xBB0B4703, 0x220216B9, 0x5505262F,
-    0xC5BA3BBE, 0xB2BD0B28, 0x2BB45A92, 0x5CB36A04,
-    0xC2D7FFA7, 0xB5D0CF31, 0x2CD99E8B, 0x5BDEAE1D,
-    0x9B64C2B0, 0xEC63F226, 0x756AA39C, 0x026D930A,
-    0x9C0906A9, 0xEB0E363F, 0x72076785, 0x05005713,
-    0x95BF4A82, 0xE2B87A14, 0x7BB12BAE, 0x0CB61B38,
-    0x92D28E9B, 0xE5D5BE0D, 0x7CDCEFB7, 0x0BDBDF21,
-    0x86D3D2D4, 0xF1D4E242, 0x68DDB3F8, 0x1FDA836E,
-    0x81BE16CD, 0xF6B9265B, 0x6FB077E1, 0x18B74777,
-    0x88085AE6, 0xFF0F6A70, 0x66063BCA, 0x11010B5C,
-    0x8F659EFF, 0xF862AE69, 0x616BFFD3, 0x166CCF45,
-    0xA00AE278, 0xD70DD2EE, 0x4E048354, 0x3903B3C2,
-    0xA7672661, 0xD06016F7, 0x4969474D, 0x3E6E77DB,
-    0xAED16A4A, 0xD9D65ADC, 0x40DF0B66, 0x37D83BF0,
-    0xA9BCAE53, 0xDEBB9EC5, 0x47B2CF7F, 0x30B5FFE9,
-    0xBDBDF21C, 0xCABAC28A, 0x53B39330, 0x24B4A3A6,
-    0xBAD03605, 0xCDD70693, 0x54DE5729, 0x23D967BF,
-    0xB3667A2E, 0xC4614AB8, 0x5D681B02, 0x2A6F2B94,
-    0xB40BBE37, 0xC30C8EA1, 0x5A05DF1B, 0x2D02EF8D };
+    return Crc16_En13757::calc( data, size );
+}
+//==================================================================================================
+/*
+  Name  : CRC-16/MODBUS
+  Poly  : 0x8005    x^16 + x^15 + x^2 + 1
+  Init  : 0xFFFF
+  Revert: true
+  XorOut: 0x0000
+  Check : 0x4B37 ("123456789")
+  то же, что crc16_Arc (исторически названная так реализация совпадает с MODBUS)
+*/
+quint16 Crypto::crc16_Modbus(const QVector<quint8> &data)
+{
+    return Crc16_Modbus::calc( data );
+}
+//==================================================================================================
+quint16 Crypto::crc16_Modbus(const QByteArray &data)
+{
+    return Crc16_Modbus::calc( data );
+}
+//==================================================================================================
+quint16 Crypto::crc16_Modbus(const quint8 *data, qint32 size)
+{
+    return Crc16_Modbus::calc( data, size );
+}
+//==================================================================================================
 /*
   Name  : CRC-32
   Poly  : 0x04C11DB7    x^32 + x^26 + x^23 + x^22 + x^16 + x^12 + x^11 + x^10 + x^8 + x^7 + x^5 + x^4 + x^2 + x + 1
@@ -871,29 +1896,166 @@ const quint32 crc32_Table[256] = {
 */
 quint32 Crypto::crc32(const QVector<quint8> &data)
 {
-    quint32 result = 0xFFFFFFFF;
-
-    for(int i=0; i<data.size(); i++) {
-        result = (result >> 8) ^ crc32_Table[ (result ^ data.at(i)) & 0xFF ];
-    }
-    return result ^ 0xFFFFFFFF;
+    return crc32( data.constData(), data.size() );
 }
 //==================================================================================================
 quint32 Crypto::crc32(const QByteArray &data)
 {
-    quint32 result = 0xFFFFFFFF;
+    return crc32( reinterpret_cast<const quint8*>(data.constData()), data.size() );
+}
+//==================================================================================================
+quint32 Crypto::crc32(const quint8 *data, qint32 size)
+{
+    return crc32_Update( 0xFFFFFFFF, data, size ) ^ 0xFFFFFFFF;
+}
+//==================================================================================================
+/*
+  Name  : CRC-32C (Castagnoli)
+  Poly  : 0x1EDC6F41
+  Init  : 0xFFFFFFFF
+  Revert: true
+  XorOut: 0xFFFFFFFF
+  Check : 0xE3069283 ("123456789")
+*/
+quint32 Crypto::crc32C(const QVector<quint8> &data)
+{
+    return Crc32C::calc( data );
+}
+//==================================================================================================
+quint32 Crypto::crc32C(const QByteArray &data)
+{
+    return Crc32C::calc( data );
+}
+//==================================================================================================
+quint32 Crypto::crc32C(const quint8 *data, qint32 size)
+{
+    return Crc32C::calc( data, size );
+}
+//==================================================================================================
+Crc::Crc(CrcAlg algorythm)
+    : _algorythm(algorythm)
+{
+    reset();
+}
+//==================================================================================================
+void Crc::reset()
+{
+    switch (_algorythm) {
+    case CrcAlg_8_Dallas: _crc = Crc8_Maxim::init(); break;
+    case CrcAlg_8: _crc = Crc8_Nrsc5::init(); break;
+    case CrcAlg_16_Ccitt: _crc = Crc16_Ibm3740::init(); break;
+    case CrcAlg_16: _crc = Crc16_Arc::init(); break;
+    case CrcAlg_16_Arc: _crc = Crc16_Modbus::init(); break;
+    case CrcAlg_16_Wmbus: _crc = Crc16_En13757::init(); break;
+    case CrcAlg_32: _crc = Crc32_IsoHdlc::init(); break;
+    case CrcAlg_32C: _crc = Crc32C::init(); break;
+    }
+}
+//==================================================================================================
+void Crc::update(const quint8 *data, qint64 size)
+{
+    if (!data || (size <= 0)) return;
 
-    for(int i=0; i<data.size(); i++) {
-        result = (result >> 8) ^ crc32_Table[ (result ^ static_cast<quint8>(data.at(i))) & 0xFF ];
+    switch (_algorythm) {
+    case CrcAlg_8_Dallas:
+        _crc = Crc8_Maxim::update( static_cast<quint8>(_crc), data, size );
+        break;
+    case CrcAlg_8:
+        _crc = Crc8_Nrsc5::update( static_cast<quint8>(_crc), data, size );
+        break;
+    case CrcAlg_16_Ccitt:
+        _crc = Crc16_Ibm3740::update( static_cast<quint16>(_crc), data, size );
+        break;
+    case CrcAlg_16:
+        _crc = Crc16_Arc::update( static_cast<quint16>(_crc), data, size );
+        break;
+    case CrcAlg_16_Arc:
+        _crc = Crc16_Modbus::update( static_cast<quint16>(_crc), data, size );
+        break;
+    case CrcAlg_16_Wmbus:
+        _crc = Crc16_En13757::update( static_cast<quint16>(_crc), data, size );
+        break;
+    case CrcAlg_32:
+        _crc = crc32_Update( _crc, data, size );
+        break;
+    case CrcAlg_32C:
+        _crc = Crc32C::update( _crc, data, size );
+        break;
     }
-    return result ^ 0xFFFFFFFF;
 }
 //==================================================================================================
-quint32 Crypto::crc32(const quint8 *data, qint32 size)
+void Crc::update(const QByteArray &data)
+{
+    update( reinterpret_cast<const quint8*>(data.constData()), data.size() );
+}
+//==================================================================================================
+void Crc::update(const QVector<quint8> &data)
 {
-    quint32 crc = 0xFFFFFFFF;
-    while (size--) crc = (crc >> 8) ^ crc32_Table[(crc ^ *data++) & 0xFF];
-    return crc ^ 0xFFFFFFFF;
+    update( data.constData(), data.size() );
+}
+//==================================================================================================
+quint32 Crc::value() const
+{
+    switch (_algorythm) {
+    case CrcAlg_8_Dallas: return Crc8_Maxim::finalize( static_cast<quint8>(_crc) );
+    case CrcAlg_8: return Crc8_Nrsc5::finalize( static_cast<quint8>(_crc) );
+    case CrcAlg_16_Ccitt: return Crc16_Ibm3740::finalize( static_cast<quint16>(_crc) );
+    case CrcAlg_16: return Crc16_Arc::finalize( static_cast<quint16>(_crc) );
+    case CrcAlg_16_Arc: return Crc16_Modbus::finalize( static_cast<quint16>(_crc) );
+    case CrcAlg_16_Wmbus: return Crc16_En13757::finalize( static_cast<quint16>(_crc) );
+    case CrcAlg_32: return Crc32_IsoHdlc::finalize( _crc );
+    case CrcAlg_32C: return Crc32C::finalize( _crc );
+    }
+    return _crc;
+}
+//==================================================================================================
+/*
+  Склейка CRC32 (как crc32_combine в zlib):
+  crc(A+B) = crc(A) * x^(8*lenB) mod P  xor  crc(B)
+  умножение по модулю P в отраженном представлении, x^(2^k) mod P - таблица на этапе компиляции
+*/
+constexpr quint32 crc32_MultModP(quint32 a, quint32 b)
+{
+    quint32 m = 1u << 31;
+    quint32 p = 0;
+    for (;;) {
+        if (a & m) {
+            p ^= b;
+            if ((a & (m - 1)) == 0) break;
+        }
+        m >>= 1;
+        b = (b & 1) ? (b >> 1) ^ 0xEDB88320 : b >> 1;
+    }
+    return p;
+}
+
+struct Crc32_X2nTable
+{
+    quint32 t[32];
+};
+
+constexpr Crc32_X2nTable crc32_MakeX2nTable()
+{
+    Crc32_X2nTable res {};
+    quint32 p = 1u << 30; // x^1
+    res.t[0] = p;
+    for (int n = 1; n < 32; ++n) res.t[n] = p = crc32_MultModP(p, p);
+    return res;
+}
+
+constexpr Crc32_X2nTable crc32_X2n = crc32_MakeX2nTable();
+
+quint32 Crc::combine(quint32 crcA, quint32 crcB, qint64 lenB)
+{
+    if (lenB <= 0) return crcA;
+
+    // x^(8*lenB) mod P
+    quint32 p = 1u << 31; // x^0
+    int k = 3;
+    for (; lenB; lenB >>= 1, ++k) {
+        if (lenB & 1) p = crc32_MultModP(crc32_X2n.t[k & 31], p);
+    }
+    return crc32_MultModP(p, crcA) ^ crcB;
 }
 //==================================================================================================
 
@@ -0,0 +1,448 @@
+/****************************************************************************
+** Copyright (c) 2019 Evgeny Teterin (nayk) <sutcedortal@gmail.com>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QMap>
+
+#include "fastcgi_server.h"
+
+namespace nayk {
+
+// протокол FastCGI 1.0:
+const int FcgiHeaderLength      = 8;
+const int FcgiMaxContentLength  = 65535;
+const quint8 FcgiVersion        = 1;
+// типы записей:
+const quint8 FcgiBeginRequest   = 1;
+const quint8 FcgiAbortRequest   = 2;
+const quint8 FcgiEndRequest     = 3;
+const quint8 FcgiParams         = 4;
+const quint8 FcgiStdin          = 5;
+const quint8 FcgiStdout         = 6;
+const quint8 FcgiGetValues      = 9;
+const quint8 FcgiGetValuesResult= 10;
+const quint8 FcgiUnknownType    = 11;
+// роль, флаги и статусы:
+const quint16 FcgiResponder     = 1;
+const quint8 FcgiKeepConn       = 1;
+const quint8 FcgiRequestComplete= 0;
+const quint8 FcgiOverloaded     = 2;
+const quint8 FcgiUnknownRole    = 3;
+// ограничения на запрос и соединение:
+const int MaxParamsSize         = 1024 * 1024;
+const int MaxConnectionRequests = 64;
+// содержимое запроса хранится в QByteArray
+const qint64 MaxContentLimit    = 0x7FFFFFFF - FcgiMaxContentLength;
+
+//======================================================================================================
+// Чтение длины пары имя-значение: 1 байт (< 128) или 4 байта со старшим битом
+static bool readFcgiLength(const uchar *&p, const uchar *end, int &length)
+{
+    if(p >= end) return false;
+    if((p[0] & 0x80) == 0) {
+        length = p[0];
+        p++;
+        return true;
+    }
+    if((end - p) < 4) return false;
+    length = static_cast<int>( ((p[0] & 0x7F) << 24) | (p[1] << 16) | (p[2] << 8) | p[3] );
+    p += 4;
+    return true;
+}
+//======================================================================================================
+static void appendFcgiLength(QByteArray &buf, int length)
+{
+    if(length < 0x80) {
+        buf.append( static_cast<char>(length) );
+        return;
+    }
+    buf.append( static_cast<char>( ((length >> 24) & 0x7F) | 0x80 ) );
+    buf.append( static_cast<char>( (length >> 16) & 0xFF ) );
+    buf.append( static_cast<char>( (length >> 8) & 0xFF ) );
+    buf.append( static_cast<char>( length & 0xFF ) );
+}
+//======================================================================================================
+static bool decodeFcgiParams(const QByteArray &data, QMap<QString, QString> &params)
+{
+    const uchar *p = reinterpret_cast<const uchar*>( data.constData() );
+    const uchar *end = p + data.size();
+
+    while(p < end) {
+        int nameLength, valueLength;
+        if(!readFcgiLength(p, end, nameLength) || !readFcgiLength(p, end, valueLength)) return false;
+        if((end - p) < (static_cast<qint64>(nameLength) + valueLength)) return false;
+        const char *name = reinterpret_cast<const char*>(p);
+        params.insert( QString::fromLatin1(name, nameLength),
+                       QString::fromUtf8(name + nameLength, valueLength) );
+        p += nameLength + valueLength;
+    }
+    return true;
+}
+//======================================================================================================
+// Состояние одного запроса внутри соединения (FastCGI допускает мультиплексирование)
+struct FastCgiRequest
+{
+    bool keepConn {false};
+    bool paramsDone {false};
+    QByteArray params;
+    QByteArray content;
+    HttpServer *server {nullptr};
+};
+//======================================================================================================
+// Соединение с веб-сервером: разбор записей, сборка запросов и отправка ответов.
+// Принадлежит сокету и удаляется вместе с ним.
+class FastCgiConnection : public QObject
+{
+public:
+    FastCgiConnection(FastCgiServer *owner, QIODevice *device);
+
+private:
+    FastCgiServer *_owner;
+    QIODevice *_device;
+    QByteArray _buffer;
+    QMap<quint16, FastCgiRequest> _requests;
+    //
+    void readRecords();
+    void processRecord(quint8 type, quint16 id, const QByteArray &content);
+    void processGetValues(const QByteArray &content);
+    void startRequest(quint16 id);
+    void sendResponse(quint16 id, const QByteArray &headers, const QByteArray &content);
+    void endRequest(quint16 id, quint8 protocolStatus);
+    void rejectRequest(quint16 id, const QByteArray &status);
+    void writeRecord(quint8 type, quint16 id, const char *data, int size);
+    void writeStream(quint16 id, const QByteArray &data);
+};
+//======================================================================================================
+FastCgiConnection::FastCgiConnection(FastCgiServer *owner, QIODevice *device)
+    : QObject(device)
+    , _owner(owner)
+    , _device(device)
+{
+    connect(_device, &QIODevice::readyRead, this, [this]() { readRecords(); });
+    if(_device->bytesAvailable() > 0) readRecords();
+}
+//======================================================================================================
+void FastCgiConnection::readRecords()
+{
+    if(!_device->isOpen()) return;
+    _buffer.append( _device->readAll() );
+
+    const uchar *data = reinterpret_cast<const uchar*>( _buffer.constData() );
+    int pos = 0;
+
+    while((_buffer.size() - pos) >= FcgiHeaderLength) {
+        const uchar *h = data + pos;
+        if(h[0] != FcgiVersion) {
+            emit _owner->toLog( LogWarning, QObject::tr("FastCGI: неверная версия протокола, соединение закрыто.") );
+            _buffer.clear();
+            _device->close();
+            return;
+        }
+        const quint16 id = static_cast<quint16>( (h[2] << 8) | h[3] );
+        const int contentLength = (h[4] << 8) | h[5];
+        const int recordLength = FcgiHeaderLength + contentLength + h[6];
+        if((_buffer.size() - pos) < recordLength) break;
+
+        processRecord( h[1], id, QByteArray(_buffer.constData() + pos + FcgiHeaderLength, contentLength) );
+        pos += recordLength;
+        // endRequest() закрыл соединение (последний запрос без FCGI_KEEP_CONN
+        // или синхронный обработчик): остальные записи уже некому обрабатывать
+        if(!_device->isOpen()) {
+            _buffer.clear();
+            return;
+        }
+    }
+    if(pos > 0) _buffer.remove(0, pos);
+}
+//======================================================================================================
+void FastCgiConnection::processRecord(quint8 type, quint16 id, const QByteArray &content)
+{
+    if(id == 0) {
+        // управляющие записи
+        if(type == FcgiGetValues) {
+            processGetValues(content);
+        }
+        else {
+            const char body[FcgiHeaderLength] = { static_cast<char>(type), 0, 0, 0, 0, 0, 0, 0 };
+            writeRecord(FcgiUnknownType, 0, body, FcgiHeaderLength);
+        }
+        return;
+    }
+
+    if(type == FcgiBeginRequest) {
+        if(content.size() < 8) return;
+        const uchar *body = reinterpret_cast<const uchar*>( content.constData() );
+        const quint16 role = static_cast<quint16>( (body[0] << 8) | body[1] );
+        FastCgiRequest req;
+        req.keepConn = (body[2] & FcgiKeepConn) != 0;
+        if(role != FcgiResponder) {
+            // FCGI_KEEP_CONN отклоненного запроса тоже учитывается: endRequest() берет его из _requests
+            _requests.insert(id, req);
+            endRequest(id, FcgiUnknownRole);
+            return;
+        }
+        if(!_requests.contains(id) && (_requests.size() >= MaxConnectionRequests)) {
+            emit _owner->toLog( LogWarning, QObject::tr("FastCGI: слишком много одновременных запросов в соединении.") );
+            _requests.insert(id, req);
+            endRequest(id, FcgiOverloaded);
+            return;
+        }
+        _requests.insert(id, req);
+        return;
+    }
+
+    if(!_requests.contains(id)) return;
+    FastCgiRequest &req = _requests[id];
+
+    switch (type) {
+    case FcgiParams:
+        if(content.isEmpty()) req.paramsDone = true;
+        else if((req.params.size() + content.size()) > MaxParamsSize) rejectRequest(id, "431 Request Header Fields Too Large");
+        else req.params.append(content);
+        break;
+    case FcgiStdin:
+        if(req.server) break;
+        if(!content.isEmpty()) {
+            if((req.content.size() + content.size()) > _owner->maxContentLength()) rejectRequest(id, "413 Payload Too Large");
+            else req.content.append(content);
+            break;
+        }
+        if(!req.paramsDone) {
+            emit _owner->toLog( LogWarning, QObject::tr("FastCGI: окончание FCGI_STDIN до окончания FCGI_PARAMS.") );
+            endRequest(id, FcgiRequestComplete);
+            break;
+        }
+        startRequest(id);
+        break;
+    case FcgiAbortRequest:
+        if(req.server) req.server->deleteLater();
+        endRequest(id, FcgiRequestComplete);
+        break;
+    default:
+        break;
+    }
+}
+//======================================================================================================
+void FastCgiConnection::processGetValues(const QByteArray &content)
+{
+    QMap<QString, QString> names;
+    decodeFcgiParams(content, names);
+
+    QByteArray result;
+    if(names.contains("FCGI_MPXS_CONNS")) {
+        appendFcgiLength(result, 15);
+        appendFcgiLength(result, 1);
+        result.append("FCGI_MPXS_CONNS1");
+    }
+    writeRecord(FcgiGetValuesResult, 0, result.constData(), result.size());
+}
+//======================================================================================================
+void FastCgiConnection::startRequest(quint16 id)
+{
+    FastCgiRequest &req = _requests[id];
+
+    QMap<QString, QString> headers;
+    if(!decodeFcgiParams(req.params, headers)) {
+        emit _owner->toLog( LogWarning, QObject::tr("FastCGI: неверный формат FCGI_PARAMS.") );
+        endRequest(id, FcgiRequestComplete);
+        return;
+    }
+
+    HttpServer *server = new HttpServer(this);
+    server->setRequest(headers, req.content);
+    req.server = server;
+    req.params.clear();
+    req.content.clear();
+
+    connect(server, &HttpServer::responseReady, this, [this, id](QByteArray headers, QByteArray content) {
+        sendResponse(id, headers, content);
+    });
+    // обработчик удалил объект, не отправив ответ: запрос все равно нужно завершить
+    connect(server, &QObject::destroyed, this, [this, id, server]() {
+        if(_requests.contains(id) && (_requests.value(id).server == server)) {
+            endRequest(id, FcgiRequestComplete);
+        }
+    });
+
+    emit _owner->newRequest(server);
+}
+//======================================================================================================
+void FastCgiConnection::sendResponse(quint16 id, const QByteArray &headers, const QByteArray &content)
+{
+    if(!_requests.contains(id)) return;
+
+    writeStream(id, headers);
+    writeStream(id, content);
+    writeRecord(FcgiStdout, id, nullptr, 0);
+
+    HttpServer *server = _requests.value(id).server;
+    if(server) server->deleteLater();
+    endRequest(id, FcgiRequestComplete);
+}
+//======================================================================================================
+void FastCgiConnection::endRequest(quint16 id, quint8 protocolStatus)
+{
+    const char body[8] = { 0, 0, 0, 0, static_cast<char>(protocolStatus), 0, 0, 0 };
+    writeRecord(FcgiEndRequest, id, body, 8);
+
+    const bool keepConn = _requests.value(id).keepConn;
+    _requests.remove(id);
+    if(!keepConn && _requests.isEmpty()) _device->close();
+}
+//======================================================================================================
+// Запрос сверх ограничений: ответ с кодом ошибки без вызова обработчика и FCGI_END_REQUEST;
+// оставшиеся записи этого запроса отбрасываются как записи неизвестного запроса
+void FastCgiConnection::rejectRequest(quint16 id, const QByteArray &status)
+{
+    emit _owner->toLog( LogWarning, QObject::tr("FastCGI: запрос отклонен: %1.").arg(QString::fromLatin1(status)) );
+    writeStream(id, "Status: " + status + "\r\nContent-Length: 0\r\n\r\n");
+    writeRecord(FcgiStdout, id, nullptr, 0);
+    endRequest(id, FcgiRequestComplete);
+}
+//======================================================================================================
+void FastCgiConnection::writeStream(quint16 id, const QByteArray &data)
+{
+    int pos = 0;
+    while(pos < data.size()) {
+        const int n = qMin(data.size() - pos, FcgiMaxContentLength);
+        writeRecord(FcgiStdout, id, data.constData() + pos, n);
+        pos += n;
+    }
+}
+//======================================================================================================
+void FastCgiConnection::writeRecord(quint8 type, quint16 id, const char *data, int size)
+{
+    if(!_device->isOpen()) return;
+    static const char padding[FcgiHeaderLength] = { 0 };
+    const int paddingLength = (FcgiHeaderLength - (size % FcgiHeaderLength)) % FcgiHeaderLength;
+
+    const char header[FcgiHeaderLength] = {
+        static_cast<char>(FcgiVersion), static_cast<char>(type),
+        static_cast<char>(id >> 8), static_cast<char>(id & 0xFF),
+        static_cast<char>(size >> 8), static_cast<char>(size & 0xFF),
+        static_cast<char>(paddingLength), 0
+    };
+    _device->write(header, FcgiHeaderLength);
+    if(size > 0) _device->write(data, size);
+    if(paddingLength > 0) _device->write(padding, paddingLength);
+}
+//======================================================================================================
+FastCgiServer::FastCgiServer(QObject *parent) : QObject(parent)
+{
+
+}
+//======================================================================================================
+FastCgiServer::~FastCgiServer()
+{
+    close();
+}
+//======================================================================================================
+bool FastCgiServer::listen(const QString &socketName)
+{
+    close();
+    // сокет мог остаться от предыдущего запуска:
+    QLocalServer::removeServer(socketName);
+
+    _localServer = new QLocalServer(this);
+    connect(_localServer, &QLocalServer::newConnection, this, &FastCgiServer::acceptLocalConnections);
+    if(!_localServer->listen(socketName)) {
+        _lastError = QObject::tr("Не удалось открыть сокет '%1': %2").arg(socketName).arg(_localServer->errorString());
+        emit toLog(LogError, _lastError);
+        close();
+        return false;
+    }
+    emit toLog(LogInfo, QObject::tr("FastCGI: ожидание запросов на сокете '%1'.").arg(_localServer->fullServerName()));
+    return true;
+}
+//======================================================================================================
+bool FastCgiServer::listen(const QHostAddress &address, quint16 port)
+{
+    close();
+
+    _tcpServer = new QTcpServer(this);
+    connect(_tcpServer, &QTcpServer::newConnection, this, &FastCgiServer::acceptTcpConnections);
+    if(!_tcpServer->listen(address, port)) {
+        _lastError = QObject::tr("Не удалось открыть порт %1: %2").arg(port).arg(_tcpServer->errorString());
+        emit toLog(LogError, _lastError);
+        close();
+        return false;
+    }
+    emit toLog(LogInfo, QObject::tr("FastCGI: ожидание запросов на %1:%2.")
+               .arg(_tcpServer->serverAddress().toString()).arg(_tcpServer->serverPort()));
+    return true;
+}
+//======================================================================================================
+void FastCgiServer::close()
+{
+    if(_localServer) {
+        _localServer->close();
+        delete _localServer;
+        _localServer = nullptr;
+    }
+    if(_tcpServer) {
+        _tcpServer->close();
+        delete _tcpServer;
+        _tcpServer = nullptr;
+    }
+}
+//======================================================================================================
+void FastCgiServer::setMaxContentLength(qint64 size)
+{
+    _maxContentLength = qBound(static_cast<qint64>(0), size, MaxContentLimit);
+}
+//======================================================================================================
+bool FastCgiServer::isListening() const
+{
+    return (_localServer && _localServer->isListening()) || (_tcpServer && _tcpServer->isListening());
+}
+//======================================================================================================
+quint16 FastCgiServer::serverPort() const
+{
+    return _tcpServer ? _tcpServer->serverPort() : 0;
+}
+//======================================================================================================
+void FastCgiServer::acceptLocalConnections()
+{
+    while(_localServer && _localServer->hasPendingConnections()) {
+        QLocalSocket *socket = _localServer->nextPendingConnection();
+        connect(socket, &QLocalSocket::disconnected, socket, &QObject::deleteLater);
+        new FastCgiConnection(this, socket);
+        if(_dbg) emit toLog(LogDbg, QObject::tr("FastCGI: новое соединение."));
+    }
+}
+//======================================================================================================
+void FastCgiServer::acceptTcpConnections()
+{
+    while(_tcpServer && _tcpServer->hasPendingConnections()) {
+        QTcpSocket *socket = _tcpServer->nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        new FastCgiConnection(this, socket);
+        if(_dbg) emit toLog(LogDbg, QObject::tr("FastCGI: новое соединение с %1.").arg(socket->peerAddress().toString()));
+    }
+}
+//======================================================================================================
+} // namespace nayk
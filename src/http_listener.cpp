@@ -0,0 +1,461 @@
+/****************************************************************************
+** Copyright (c) 2019 Evgeny Teterin (nayk) <sutcedortal@gmail.com>
+** All right reserved.
+**
+** Permission is hereby granted, free of charge, to any person obtaining
+** a copy of this software and associated documentation files (the
+** "Software"), to deal in the Software without restriction, including
+** without limitation the rights to use, copy, modify, merge, publish,
+** distribute, sublicense, and/or sell copies of the Software, and to
+** permit persons to whom the Software is furnished to do so, subject to
+** the following conditions:
+**
+** The above copyright notice and this permission notice shall be
+** included in all copies or substantial portions of the Software.
+**
+** THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+** EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+** MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+** NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE
+** LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION
+** OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+**
+****************************************************************************/
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QLocale>
+#include <QDateTime>
+#include <QMap>
+
+#include "http_listener.h"
+
+namespace nayk {
+
+const int MaxHeaderSize = 64 * 1024;
+const qint64 ReadBufferSize = 1024 * 1024; // сверх этого сокет не читает, пока данные не заберут
+// тело хранится в QByteArray, а в буфере соединения - вместе с заголовком и частью следующих данных
+const qint64 MaxContentLimit = 0x7FFFFFFF - MaxHeaderSize - ReadBufferSize;
+
+//======================================================================================================
+// Значение заголовка Date, пересчитывается раз в секунду
+static QByteArray httpDate()
+{
+    static thread_local qint64 cachedSec = -1;
+    static thread_local QByteArray cached;
+
+    const qint64 sec = QDateTime::currentMSecsSinceEpoch() / 1000;
+    if(sec != cachedSec) {
+        cachedSec = sec;
+        cached = QLocale::c().toString( QDateTime::fromMSecsSinceEpoch(sec * 1000, Qt::UTC),
+                                        "ddd, dd MMM yyyy hh:mm:ss 'GMT'" ).toLatin1();
+    }
+    return cached;
+}
+//======================================================================================================
+// Соединение с клиентом: разбор запросов HTTP/1.1 и отправка ответов в порядке запросов.
+// Принадлежит сокету и удаляется вместе с ним.
+class HttpListenerConnection : public QObject
+{
+public:
+    HttpListenerConnection(HttpListener *owner, QTcpSocket *socket);
+
+private:
+    enum ParseResult { ParseIncomplete, ParseDone, ParseError };
+
+    HttpListener *_owner;
+    QTcpSocket *_socket;
+    QTimer _idleTimer;
+    QTimer _headerTimer;
+    QByteArray _buffer;
+    HttpServer *_server {nullptr};
+    bool _reading {false};
+    bool _closing {false};
+    // разобранный заголовок текущего запроса:
+    int _bodyStart {-1};
+    QMap<QString, QString> _cgi;
+    qint64 _contentLength {0};
+    bool _chunked {false};
+    int _chunkPos {0};
+    QByteArray _chunkedBody;
+    bool _expectContinue {false};
+    bool _keepAlive {true};
+    bool _head {false};
+    //
+    void readRequests();
+    ParseResult parseHead();
+    ParseResult parseBody(QByteArray &body, int &consumed);
+    void compactChunks();
+    void startRequest(const QByteArray &body);
+    void sendResponse(const QByteArray &headers, const QByteArray &content);
+    void sendError(const QByteArray &status);
+};
+//======================================================================================================
+HttpListenerConnection::HttpListenerConnection(HttpListener *owner, QTcpSocket *socket)
+    : QObject(socket)
+    , _owner(owner)
+    , _socket(socket)
+{
+    _idleTimer.setSingleShot(true);
+    connect(&_idleTimer, &QTimer::timeout, this, [this]() {
+        if(_server) return;
+        _closing = true;
+        _socket->disconnectFromHost();
+    });
+    // срок на весь заголовок запроса с его первого байта: не продлевается каждым чтением,
+    // иначе клиент, присылающий заголовок по байту, держит соединение бесконечно
+    _headerTimer.setSingleShot(true);
+    connect(&_headerTimer, &QTimer::timeout, this, [this]() {
+        if(_server || _closing || (_bodyStart >= 0)) return;
+        sendError("408 Request Timeout");
+    });
+    // пока обрабатывается запрос, данные из сокета не забираются: чтение из сети
+    // останавливается на ReadBufferSize, и клиент с конвейером не раздувает память
+    _socket->setReadBufferSize(ReadBufferSize);
+    connect(_socket, &QTcpSocket::readyRead, this, [this]() { readRequests(); });
+    _idleTimer.start( _owner->keepAliveTimeout() );
+}
+//======================================================================================================
+void HttpListenerConnection::readRequests()
+{
+    if(_closing) {
+        _socket->readAll();
+        return;
+    }
+    if(_server) return;
+    _buffer.append( _socket->readAll() );
+    _idleTimer.start( _owner->keepAliveTimeout() );
+
+    // запросы обрабатываются по одному: следующий разбирается после ответа на текущий
+    _reading = true;
+    while(!_server && !_closing && !_buffer.isEmpty()) {
+
+        if(_bodyStart < 0) {
+            if(!_headerTimer.isActive()) _headerTimer.start( _owner->headerTimeout() );
+            // пустые строки перед запросом допускаются (RFC 7230, 3.5)
+            int skip = 0;
+            while((skip < _buffer.size()) && ((_buffer.at(skip) == '\r') || (_buffer.at(skip) == '\n'))) skip++;
+            if(skip > 0) _buffer.remove(0, skip);
+            if(_buffer.isEmpty() || (parseHead() != ParseDone)) break;
+            _headerTimer.stop();
+        }
+
+        QByteArray body;
+        int consumed = 0;
+        ParseResult res = parseBody(body, consumed);
+        if(res == ParseIncomplete) {
+            if(_expectContinue) {
+                _expectContinue = false;
+                _socket->write("HTTP/1.1 100 Continue\r\n\r\n");
+            }
+            break;
+        }
+        if(res == ParseError) break;
+
+        _buffer.remove(0, consumed);
+        startRequest(body);
+    }
+    _reading = false;
+}
+//======================================================================================================
+HttpListenerConnection::ParseResult HttpListenerConnection::parseHead()
+{
+    const int end = _buffer.indexOf("\r\n\r\n");
+    if(end < 0) {
+        if(_buffer.size() <= MaxHeaderSize) return ParseIncomplete;
+        sendError("431 Request Header Fields Too Large");
+        return ParseError;
+    }
+    if(end > MaxHeaderSize) {
+        sendError("431 Request Header Fields Too Large");
+        return ParseError;
+    }
+
+    const QList<QByteArray> lines = _buffer.left(end).split('\n');
+    const QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+    if(requestLine.size() != 3) {
+        sendError("400 Bad Request");
+        return ParseError;
+    }
+    const QByteArray method = requestLine.at(0).toUpper();
+    const QByteArray uri = requestLine.at(1);
+    const QByteArray version = requestLine.at(2);
+    if(!version.startsWith("HTTP/1.")) {
+        sendError("505 HTTP Version Not Supported");
+        return ParseError;
+    }
+
+    _cgi.clear();
+    const int q = uri.indexOf('?');
+    _cgi.insert(ServerHeaderRequestMethod, QString::fromLatin1(method));
+    _cgi.insert(ServerHeaderRequestUri, QString::fromUtf8(uri));
+    _cgi.insert(ServerHeaderScriptName, QString::fromUtf8( (q < 0) ? uri : uri.left(q) ));
+    _cgi.insert(ServerHeaderQueryString, (q < 0) ? QString() : QString::fromUtf8( uri.mid(q + 1) ));
+    _cgi.insert(ServerHeaderServerProtocol, QString::fromLatin1(version));
+    _cgi.insert(ServerHeaderRequestScheme, "http");
+    _cgi.insert(ServerHeaderRemoteAddress, _socket->peerAddress().toString());
+    _cgi.insert(ServerHeaderRemotePort, QString::number(_socket->peerPort()));
+    _cgi.insert(ServerHeaderServerAddress, _socket->localAddress().toString());
+    _cgi.insert(ServerHeaderServerPort, QString::number(_socket->localPort()));
+
+    bool hasLength = false;
+    _contentLength = 0;
+    for(int i=1; i<lines.size(); i++) {
+        const QByteArray line = lines.at(i).trimmed();
+        const int n = line.indexOf(':');
+        if(n < 1) {
+            sendError("400 Bad Request");
+            return ParseError;
+        }
+        const QByteArray name = line.left(n).trimmed().toUpper();
+        const QString value = QString::fromUtf8( line.mid(n + 1).trimmed() );
+
+        if(name == "CONTENT-LENGTH") {
+            bool ok;
+            _contentLength = value.toLongLong(&ok);
+            if(!ok || (_contentLength < 0)) {
+                sendError("400 Bad Request");
+                return ParseError;
+            }
+            hasLength = true;
+            continue;
+        }
+
+        const QString key = (name == "CONTENT-TYPE") ? ServerHeaderContentType
+                                                     : "HTTP_" + QString::fromLatin1(name).replace("-", "_");
+        // повторы заголовка объединяются через запятую, а Cookie - через "; " (RFC 6265, 5.4)
+        if(_cgi.contains(key)) _cgi.insert(key, _cgi.value(key) + ((key == ServerHeaderHttpCookie) ? "; " : ", ") + value);
+        else _cgi.insert(key, value);
+    }
+
+    const QString connection = _cgi.value(ServerHeaderHttpConnection).toLower();
+    _keepAlive = (version == "HTTP/1.0") ? connection.contains("keep-alive") : !connection.contains("close");
+    _chunked = _cgi.value("HTTP_TRANSFER_ENCODING").toLower().contains("chunked");
+    _expectContinue = (_cgi.value("HTTP_EXPECT").toLower() == "100-continue");
+    _head = (method == "HEAD");
+
+    if(_chunked) {
+        _contentLength = 0;
+    }
+    else if(hasLength) {
+        _cgi.insert(ServerHeaderContentLength, QString::number(_contentLength));
+    }
+    if(_contentLength > _owner->maxContentLength()) {
+        sendError("413 Payload Too Large");
+        return ParseError;
+    }
+
+    _bodyStart = end + 4;
+    _chunkPos = _bodyStart;
+    _chunkedBody.clear();
+    return ParseDone;
+}
+//======================================================================================================
+HttpListenerConnection::ParseResult HttpListenerConnection::parseBody(QByteArray &body, int &consumed)
+{
+    if(!_chunked) {
+        if((_buffer.size() - _bodyStart) < _contentLength) return ParseIncomplete;
+        const int length = static_cast<int>(_contentLength);
+        if(length > 0) body = _buffer.mid(_bodyStart, length);
+        consumed = _bodyStart + length;
+        return ParseDone;
+    }
+
+    forever {
+        const int lineEnd = _buffer.indexOf("\r\n", _chunkPos);
+        if(lineEnd < 0) {
+            compactChunks();
+            return ParseIncomplete;
+        }
+
+        QByteArray sizeLine = _buffer.mid(_chunkPos, lineEnd - _chunkPos);
+        const int ext = sizeLine.indexOf(';');
+        if(ext >= 0) sizeLine.truncate(ext);
+        bool ok;
+        const qint64 size = sizeLine.trimmed().toLongLong(&ok, 16);
+        if(!ok || (size < 0)) {
+            sendError("400 Bad Request");
+            return ParseError;
+        }
+
+        if(size == 0) {
+            // последний блок; трейлеры пропускаются до пустой строки
+            const int end = _buffer.indexOf("\r\n\r\n", lineEnd);
+            if(end < 0) {
+                compactChunks();
+                return ParseIncomplete;
+            }
+            body = _chunkedBody;
+            _chunkedBody.clear();
+            consumed = end + 4;
+            return ParseDone;
+        }
+
+        if((_chunkedBody.size() + size) > _owner->maxContentLength()) {
+            sendError("413 Payload Too Large");
+            return ParseError;
+        }
+        const int dataStart = lineEnd + 2;
+        if((_buffer.size() - dataStart) < (size + 2)) {
+            compactChunks();
+            return ParseIncomplete;
+        }
+        _chunkedBody.append(_buffer.constData() + dataStart, static_cast<int>(size));
+        _chunkPos = dataStart + static_cast<int>(size) + 2;
+    }
+}
+//======================================================================================================
+// Разобранные блоки chunked уже скопированы в _chunkedBody: их сырые данные убираются
+// из буфера (раз на чтение, а не на блок), чтобы буфер не рос на накладные расходы блоков
+void HttpListenerConnection::compactChunks()
+{
+    if(_chunkPos <= _bodyStart) return;
+    _buffer.remove(_bodyStart, _chunkPos - _bodyStart);
+    _chunkPos = _bodyStart;
+}
+//======================================================================================================
+void HttpListenerConnection::startRequest(const QByteArray &body)
+{
+    if(_chunked) _cgi.insert(ServerHeaderContentLength, QString::number(body.size()));
+    _bodyStart = -1;
+    _idleTimer.stop();
+
+    HttpServer *server = new HttpServer(this);
+    server->setRequest(_cgi, body);
+    _server = server;
+
+    connect(server, &HttpServer::responseReady, this, [this](QByteArray headers, QByteArray content) {
+        sendResponse(headers, content);
+    });
+    // обработчик удалил объект, не отправив ответ: клиент не должен ждать
+    connect(server, &QObject::destroyed, this, [this, server]() {
+        if(_server != server) return;
+        _server = nullptr;
+        sendError("500 Internal Server Error");
+    });
+
+    emit _owner->newRequest(server);
+}
+//======================================================================================================
+void HttpListenerConnection::sendResponse(const QByteArray &headers, const QByteArray &content)
+{
+    if(!_server) return;
+    _server->deleteLater();
+    _server = nullptr;
+
+    // заголовки в формате CGI: код ответа из "Status", "Connection" определяет соединение
+    QByteArray status = "200 OK";
+    QByteArray fields;
+    const QList<QByteArray> lines = headers.split('\n');
+    for(const QByteArray &rawLine: lines) {
+        const QByteArray line = rawLine.trimmed();
+        if(line.isEmpty()) continue;
+        const QByteArray lower = line.toLower();
+        if(lower.startsWith("status:")) {
+            status = line.mid(7).trimmed();
+            continue;
+        }
+        if(lower.startsWith("connection:")) continue;
+        fields.append(line);
+        fields.append("\r\n");
+    }
+
+    QByteArray head;
+    head.reserve(fields.size() + 128);
+    head.append("HTTP/1.1 ");
+    head.append(status);
+    head.append("\r\nDate: ");
+    head.append(httpDate());
+    head.append(_keepAlive ? "\r\nConnection: keep-alive\r\n" : "\r\nConnection: close\r\n");
+    head.append(fields);
+    head.append("\r\n");
+
+    _socket->write(head);
+    if(!_head && !content.isEmpty()) _socket->write(content);
+
+    if(!_keepAlive) {
+        _closing = true;
+        _socket->disconnectFromHost();
+        return;
+    }
+    _idleTimer.start( _owner->keepAliveTimeout() );
+    // ответ отправлен асинхронно: в буфере и в сокете могут ждать следующие запросы
+    if(!_reading && (!_buffer.isEmpty() || _socket->bytesAvailable())) {
+        QTimer::singleShot(0, this, [this]() { readRequests(); });
+    }
+}
+//======================================================================================================
+void HttpListenerConnection::sendError(const QByteArray &status)
+{
+    emit _owner->toLog( LogWarning, QObject::tr("HTTP: %1 (%2).")
+                        .arg(QString::fromLatin1(status)).arg(_socket->peerAddress().toString()) );
+    _closing = true;
+    _buffer.clear();
+    _socket->write("HTTP/1.1 " + status + "\r\nDate: " + httpDate()
+                   + "\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+    _socket->disconnectFromHost();
+}
+//======================================================================================================
+HttpListener::HttpListener(QObject *parent) : QObject(parent)
+{
+
+}
+//======================================================================================================
+HttpListener::~HttpListener()
+{
+    close();
+}
+//======================================================================================================
+bool HttpListener::listen(const QHostAddress &address, quint16 port)
+{
+    close();
+
+    _tcpServer = new QTcpServer(this);
+    connect(_tcpServer, &QTcpServer::newConnection, this, &HttpListener::acceptConnections);
+    if(!_tcpServer->listen(address, port)) {
+        _lastError = QObject::tr("Не удалось открыть порт %1: %2").arg(port).arg(_tcpServer->errorString());
+        emit toLog(LogError, _lastError);
+        close();
+        return false;
+    }
+    emit toLog(LogInfo, QObject::tr("HTTP: ожидание запросов на %1:%2.")
+               .arg(_tcpServer->serverAddress().toString()).arg(_tcpServer->serverPort()));
+    return true;
+}
+//======================================================================================================
+void HttpListener::close()
+{
+    if(_tcpServer) {
+        _tcpServer->close();
+        delete _tcpServer;
+        _tcpServer = nullptr;
+    }
+}
+//======================================================================================================
+void HttpListener::setMaxContentLength(qint64 size)
+{
+    _maxContentLength = qBound(static_cast<qint64>(0), size, MaxContentLimit);
+}
+//======================================================================================================
+bool HttpListener::isListening() const
+{
+    return _tcpServer && _tcpServer->isListening();
+}
+//======================================================================================================
+quint16 HttpListener::serverPort() const
+{
+    return _tcpServer ? _tcpServer->serverPort() : 0;
+}
+//======================================================================================================
+void HttpListener::acceptConnections()
+{
+    while(_tcpServer && _tcpServer->hasPendingConnections()) {
+        QTcpSocket *socket = _tcpServer->nextPendingConnection();
+        connect(socket, &QTcpSocket::disconnected, socket, &QObject::deleteLater);
+        new HttpListenerConnection(this, socket);
+        if(_dbg) emit toLog(LogDbg, QObject::tr("HTTP: новое соединение с %1.").arg(socket->peerAddress().toString()));
+    }
+}
+//======================================================================================================
+} // namespace nayk
@@ -27,18 +27,26 @@
 #include <QIODevice>
 #include <QTextStream>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QByteArrayMatcher>
+#include <QTemporaryFile>
+#include <QDir>
 
 #include <string>
 #include <iostream>
+#include <cerrno>
+#include <cstring>
 #include "stdio.h"
 
 #ifdef Q_OS_WIN32
 #include "fcntl.h"
 #include "io.h"
+#else
+#include <poll.h>
+#include <unistd.h>
 #endif
 
 #include "http_server.h"
-#include "system_utils.h"
 
 extern char** environ;
 
@@ -46,8 +54,61 @@ namespace nayk {
 
 const int QueryTimeOutMax  = 300000;
 const int ReadTimeOutMax   = 60000;
-const qint64 MaxBufferSize = 1024;
+const qint64 MaxContentLength = 0x7FFFFFFF - 64; // предел размера QByteArray
+const int UploadChunkSize   = 1024 * 1024;
+const int InitialContentSize = 16 * 1024 * 1024;
+const int MaxPartHeaderSize = 64 * 1024;
+const int MaxPartValueSize  = 16 * 1024 * 1024; // текстовые и JSON части, которые не пишутся на диск
 
+//======================================================================================================
+// Заголовки части multipart/form-data
+struct MultipartPart
+{
+    QString name;
+    QString fileName;
+    bool binType {false};
+    bool jsonType {false};
+};
+//======================================================================================================
+// Потоковый разбор multipart/form-data: содержимое подается кусками по мере чтения,
+// двоичные и файловые части крупнее порога пишутся во временные файлы
+class MultipartStream
+{
+public:
+    MultipartStream(const QByteArray &boundary, qint64 threshold, const QString &dir, QObject *fileParent,
+                    QMap<QString, QString> &post, QMap<QString, QByteArray> &bin,
+                    QMap<QString, QJsonValue> &json, QMap<QString, QTemporaryFile*> &files);
+    ~MultipartStream();
+    bool write(const char *data, int size);
+    bool finish();
+    QString errorString() const { return _error; }
+
+private:
+    enum State { StatePreamble, StateDelimiter, StateHeaders, StateBody, StateEnd };
+
+    State _state {StatePreamble};
+    bool _skipped {false}; // часть преамбулы уже отброшена
+    QByteArray _buf;
+    QByteArray _dashBoundary;
+    QByteArray _endl;
+    QByteArray _delimiter;
+    qint64 _threshold;
+    QString _dir;
+    QObject *_fileParent;
+    QMap<QString, QString> &_post;
+    QMap<QString, QByteArray> &_bin;
+    QMap<QString, QJsonValue> &_json;
+    QMap<QString, QTemporaryFile*> &_files;
+    // текущая часть:
+    MultipartPart _part;
+    QByteArray _value;
+    QTemporaryFile *_file {nullptr};
+    QString _error;
+    //
+    bool process(bool atEnd);
+    bool appendValue(const char *data, int size);
+    bool finishPart();
+};
 //======================================================================================================
 HttpServer::HttpServer(QObject *parent) : QObject(parent)
 {
@@ -59,83 +120,135 @@ HttpServer::~HttpServer()
 
 }
 //======================================================================================================
-bool HttpServer::readRequestContent(QByteArray &buf)
+void HttpServer::setRequest(const QMap<QString, QString> &headers, const QByteArray &content)
+{
+    _external = true;
+    _externalHeaders = headers;
+    _externalContent = content;
+}
+//======================================================================================================
+bool HttpServer::readRequestContent(QByteArray &buf, MultipartStream *stream /* = nullptr */)
 {
     bool ok;
-    int contentLength = mRequestHeaders.value(ServerHeaderContentLength).toInt(&ok);
+    const qint64 contentLength = mRequestHeaders.value(ServerHeaderContentLength).toLongLong(&ok);
     if(!ok) {
         _lastError = QObject::tr("Неверный формат заголовка запроса 'Content-Length'.");
         return false;
     }
+
+    if(_external) {
+        // содержимое уже принято транспортом целиком
+        if(_externalContent.count() != contentLength) {
+            emit toLog( LogWarning, QObject::tr("Значение 'Content-Length' не соответствует фактической длине ") +
+                        QString::number(_externalContent.count()) );
+        }
+        if(!stream) {
+            buf = _externalContent;
+            return true;
+        }
+        // разбору подается кусками, чтобы не копировать содержимое еще раз целиком
+        for(int pos = 0; pos < _externalContent.size(); pos += UploadChunkSize) {
+            if(!stream->write(_externalContent.constData() + pos, qMin(UploadChunkSize, _externalContent.size() - pos))) {
+                _lastError = stream->errorString();
+                return false;
+            }
+        }
+        return true;
+    }
+    if(contentLength < 0) {
+        _lastError = QObject::tr("Неверный формат заголовка запроса 'Content-Length'.");
+        return false;
+    }
+    if(!stream && (contentLength > MaxContentLength)) {
+        // в память целиком читается не больше предела QByteArray; больше - только с setUploadFileThreshold()
+        _lastError = QObject::tr("Слишком большое содержимое запроса: ") + QString::number(contentLength);
+        return false;
+    }
     if(_dbg) emit toLog( LogDbg, QObject::tr("Начало получения содержимого запроса.") );
 
 #ifdef Q_OS_WIN32
     _setmode(_fileno(stdin), _O_BINARY);
+    const int fd = _fileno(stdin);
+#else
+    const int fd = fileno(stdin);
 #endif
-    QFile standardInput;
-    if(!standardInput.open( stdin, QIODevice::ReadOnly )) {
-        _lastError = QObject::tr("Не удалось открыть стандартный поток на чтение.");
-        return false;
-    }
 
+    // буфер заполняется крупными чтениями напрямую из дескриптора, без промежуточных копий.
+    // 'Content-Length' - значение клиента, поэтому сразу выделяется не больше InitialContentSize,
+    // дальше буфер растет вдвое по мере прихода данных. При потоковом разборе буфер -
+    // один кусок, который после каждого чтения передается разбору и используется снова
+    buf.resize( static_cast<int>(qMin(contentLength, static_cast<qint64>(stream ? UploadChunkSize : InitialContentSize))) );
+    qint64 total = 0;
+    int readCount = 0;
     bool readTimeOut = false;
     bool queryTimeOut = false;
-    int blockCnt = 0;
-    QString queStr = "";
-    qint64 startTimeMSec = QDateTime::currentMSecsSinceEpoch();
-    qint64 curInTimeMSec = startTimeMSec;
-    qint64 curMS, timeMS, sumTime = 0;
+    int readError = 0;
+    QElapsedTimer timer;
+    timer.start();
 
-    while(!standardInput.atEnd() && !readTimeOut && !queryTimeOut) {
+    while(total < contentLength) {
 
-        curMS = QDateTime::currentMSecsSinceEpoch();
+        if(!stream && (total == buf.size())) {
+            buf.resize( static_cast<int>(qMin(contentLength, 2 * total)) );
+        }
+        char *data = stream ? buf.data() : buf.data() + total;
+        const qint64 size = stream ? qMin(contentLength - total, static_cast<qint64>(buf.size())) : buf.size() - total;
 
-        if((curMS - curInTimeMSec) > ReadTimeOutMax) {
-            readTimeOut = true;
+#ifndef Q_OS_WIN32
+        // ожидание данных без опроса и пауз: poll() просыпается, как только данные пришли
+        const qint64 queryLeft = QueryTimeOutMax - timer.elapsed();
+        if(queryLeft <= 0) {
+            queryTimeOut = true;
             break;
         }
-        if((curMS - startTimeMSec) > QueryTimeOutMax) {
-            queryTimeOut = true;
+        pollfd pfd;
+        pfd.fd = fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        const int res = ::poll(&pfd, 1, static_cast<int>( qMin(static_cast<qint64>(ReadTimeOutMax), queryLeft) ));
+        if(res < 0) {
+            if(errno == EINTR) continue;
+            readError = errno;
             break;
         }
-
-        // засекаем текущее время:
-        curMS = QDateTime::currentMSecsSinceEpoch();
-        QByteArray readBuf = standardInput.read(MaxBufferSize);
-        // вычисляем разницу:
-        timeMS = QDateTime::currentMSecsSinceEpoch() - curMS;
-        sumTime += timeMS;
-
-        if(!queStr.isEmpty()) queStr += ", ";
-        queStr += QString::number( readBuf.size() ) + "=" + QString::number( timeMS ) + QObject::tr(" мсек");
-
-        if(readBuf.isEmpty()) {
-            System::pauseMS(20);
-            continue;
+        if(res == 0) {
+            if(queryLeft <= ReadTimeOutMax) queryTimeOut = true;
+            else readTimeOut = true;
+            break;
         }
-
-        buf.append(readBuf);
-
-        QString logStr = "";
-        for(int i=0; i<readBuf.size(); i++) {
-            logStr += " " + QString(readBuf.mid(i,1).toHex()).toUpper();
+        const ssize_t n = ::read(fd, data, static_cast<size_t>(size));
+#else
+        // для каналов Windows poll() недоступен: блокирующее чтение, тайм-аут задает веб-сервер
+        const int n = _read(fd, data, static_cast<unsigned int>(size));
+#endif
+        if(n < 0) {
+            if(errno == EINTR) continue;
+            readError = errno;
+            break;
         }
-        logStr = QString::number(blockCnt) + " =" + logStr;
-        if(blockCnt < 10) logStr = "0" + logStr;
-        blockCnt++;
-        if(_dbg) emit toLog( LogDbg, QObject::tr("БЛОК ") + logStr + " [" + QString::number(readBuf.size()) + QObject::tr(" Б]") );
+        if(n == 0) break; // поток закрыт раньше, чем пришел весь 'Content-Length'
 
-        if(buf.count() >= contentLength) break;
-        curInTimeMSec = QDateTime::currentMSecsSinceEpoch();
+        if(stream && !stream->write(data, static_cast<int>(n))) {
+            _lastError = stream->errorString();
+            buf.clear();
+            return false;
+        }
+        total += n;
+        readCount++;
     }
-    standardInput.close();
+    if(stream) buf.clear();
+    else buf.resize(static_cast<int>(total));
 
     if(_dbg) {
         emit toLog( LogDbg, QObject::tr("Окончание получения содержимого запроса.") );
-        emit toLog( LogDbg, QObject::tr("Кол-во считанных байт и время передачи последовательно: ") + queStr );
-        emit toLog( LogDbg, QObject::tr("Всего прочитано байт: ") + QString::number(buf.size()) +
-                    QObject::tr("; Не прочитано (разница с 'Content-Length'): ") + QString::number(contentLength - buf.size()) );
-        emit toLog( LogDbg, QObject::tr("Общее время на чтение содержимого запроса: ") + QString::number(sumTime) + QObject::tr(" мсек.") );
+        emit toLog( LogDbg, QObject::tr("Всего прочитано байт: ") + QString::number(total) +
+                    QObject::tr("; Не прочитано (разница с 'Content-Length'): ") + QString::number(contentLength - total) );
+        emit toLog( LogDbg, QObject::tr("Кол-во операций чтения: ") + QString::number(readCount) );
+        emit toLog( LogDbg, QObject::tr("Общее время на чтение содержимого запроса: ") + QString::number(timer.elapsed()) + QObject::tr(" мсек.") );
+    }
+    if(readError) {
+        _lastError = QObject::tr("Ошибка чтения содержимого запроса: ") + QString::fromLocal8Bit(strerror(readError));
+        return false;
     }
     if(readTimeOut) {
         _lastError = QObject::tr("Тайм-аут ожидания данных содержимого запроса.");
@@ -146,9 +259,9 @@ bool HttpServer::readRequestContent(QByteArray &buf)
         return false;
     }
 
-    if(buf.count() != contentLength) {
+    if(total != contentLength) {
         emit toLog( LogWarning, QObject::tr("Значение 'Content-Length' не соответствует фактической длине ") +
-                    QString::number(buf.count()) );
+                    QString::number(total) );
     }
     return true;
 }
@@ -212,6 +325,17 @@ void HttpServer::processCookies()
 //===================================================================================================
 void HttpServer::processHeaders()
 {
+    if(_external) {
+        QMap<QString, QString>::const_iterator itr;
+        for (itr = _externalHeaders.constBegin(); itr != _externalHeaders.constEnd(); ++itr) {
+            QString strName = itr.key().trimmed().toUpper();
+            QString strVal = itr.value().trimmed();
+            if(strName.isEmpty() || strVal.isEmpty()) continue;
+            mRequestHeaders.insert(strName, strVal);
+        }
+        return;
+    }
+
     int i = 0;
     while( environ[i] ) {
         QString strVal = QString(environ[i++]);
@@ -236,8 +360,10 @@ bool HttpServer::processPost()
 {
     if (mRequestHeaders.value(ServerHeaderRequestMethod).toUpper() != MethodPost) return true;
 
+    // 64 бит: при записи файловых частей на диск содержимое может быть больше 2 ГБ,
+    // предел размера для чтения в память проверяет readRequestContent()
     bool ok;
-    int contentLength = mRequestHeaders.value(ServerHeaderContentLength).toInt(&ok);
+    const qint64 contentLength = mRequestHeaders.value(ServerHeaderContentLength).toLongLong(&ok);
     if(!ok || (contentLength==0)) {
         _lastError = QObject::tr("Неверный формат заголовка запроса 'Content-Length'.");
         return false;
@@ -264,13 +390,43 @@ bool HttpServer::processPost()
 
     if(_requestContentType == ContentTypeWWWForm) {
         std::string strPostData;
-        std::getline(std::cin, strPostData);
+        if(_external) {
+            int n = _externalContent.indexOf('\n');
+            strPostData = (n < 0) ? _externalContent.toStdString() : _externalContent.left(n).toStdString();
+        }
+        else {
+            std::getline(std::cin, strPostData);
+        }
         if (!QString::fromStdString(strPostData).isEmpty()) {
             mRequestPostParameters = decodeQuery(QString().fromStdString(strPostData));
         }
         return true;
     }
 
+    QString boundary = "";
+
+    if(_requestContentType == ContentTypeMultipartForm) {
+
+        for(int i=1; i<sList.size(); i++) {
+            QString strVal = QString(sList.at(i)).trimmed();
+            if (strVal.toUpper().left(9) == "BOUNDARY=") {
+                strVal.remove(0,9);
+                boundary = strVal.trimmed();
+                if((boundary.length()>2) && (boundary.left(1) == "\"") && (boundary.right(1) == "\"")) {
+                    boundary.remove(0,1);
+                    boundary.chop(1);
+                }
+                break;
+            }
+        }
+        if(boundary.isEmpty()) {
+            _lastError = QObject::tr("Не найдено значение разделителя 'Boundary'.");
+            return false;
+        }
+        // крупные файловые части пишутся во временные файлы по мере чтения
+        if(_uploadFileThreshold >= 0) return readMultipartToFiles(boundary.toLatin1());
+    }
+
     if(!readRequestContent(_requestContent)) return false;
 
     if(_requestContentType == ContentTypeJSON) {
@@ -292,128 +448,413 @@ bool HttpServer::processPost()
     }
     else if(_requestContentType == ContentTypeMultipartForm) {
 
-        QString boundary = "";
-
-        for(int i=1; i<sList.size(); i++) {
-            QString strVal = QString(sList.at(i)).trimmed();
-            if (strVal.toUpper().left(9) == "BOUNDARY=") {
-                strVal.remove(0,9);
-                boundary = strVal.trimmed();
-                if((boundary.length()>2) && (boundary.left(1) == "\"") && (boundary.right(1) == "\"")) {
-                    boundary.remove(0,1);
-                    boundary.chop(1);
-                }
-                break;
-            }
-        }
-        if(boundary.isEmpty()) {
-            _lastError = QObject::tr("Не найдено значение разделителя 'Boundary'.");
+        if(!parseMultipart(boundary.toLatin1())) {
+            mRequestBinParameters.clear();
             _requestContent.clear();
             return false;
         }
+    }
 
-        QString endl = "\r\n";
-        int ii = 0;
+    return true;
+}
+//===================================================================================================
+// Параметр заголовка части (name="..." или name=...), имя без учета регистра
+static QByteArray multipartHeaderParam(const char *begin, const char *end, const char *key)
+{
+    const int keyLength = static_cast<int>( qstrlen(key) );
+    const char *p = static_cast<const char*>( memchr(begin, ';', static_cast<size_t>(end - begin)) );
+
+    while(p && (p < end)) {
+        p++;
+        while((p < end) && ((*p == ' ') || (*p == '\t'))) p++;
+        const char *eq = static_cast<const char*>( memchr(p, '=', static_cast<size_t>(end - p)) );
+        if(!eq) break;
+        const char *nameEnd = eq;
+        while((nameEnd > p) && ((nameEnd[-1] == ' ') || (nameEnd[-1] == '\t'))) nameEnd--;
+        const bool match = ((nameEnd - p) == keyLength) && (qstrnicmp(p, key, static_cast<uint>(keyLength)) == 0);
+
+        const char *valueBegin = eq + 1;
+        const char *valueEnd;
+        if((valueBegin < end) && (*valueBegin == '"')) {
+            valueBegin++;
+            valueEnd = static_cast<const char*>( memchr(valueBegin, '"', static_cast<size_t>(end - valueBegin)) );
+            if(!valueEnd) valueEnd = end;
+            p = static_cast<const char*>( memchr(valueEnd, ';', static_cast<size_t>(end - valueEnd)) );
+        }
+        else {
+            valueEnd = static_cast<const char*>( memchr(valueBegin, ';', static_cast<size_t>(end - valueBegin)) );
+            if(!valueEnd) valueEnd = end;
+            p = valueEnd;
+        }
+        if(match) return QByteArray(valueBegin, static_cast<int>(valueEnd - valueBegin)).trimmed();
+    }
+    return QByteArray();
+}
+//===================================================================================================
+static bool multipartHeaderIs(const char *begin, const char *end, const char *name)
+{
+    const int length = static_cast<int>( qstrlen(name) );
+    return ((end - begin) == length) && (qstrnicmp(begin, name, static_cast<uint>(length)) == 0);
+}
+//===================================================================================================
+// Заголовки части multipart: от начала первой строки до пустой строки (не включая)
+static void parseMultipartHeaders(const char *begin, const char *end, const QByteArray &endl, MultipartPart &part)
+{
+    const char *line = begin;
+    while(line < end) {
+        const char *lineEnd = static_cast<const char*>( memchr(line, endl.at(0), static_cast<size_t>(end - line)) );
+        if(!lineEnd) lineEnd = end;
+        const char *colon = static_cast<const char*>( memchr(line, ':', static_cast<size_t>(lineEnd - line)) );
+
+        if(colon) {
+            const char *nameEnd = colon;
+            while((nameEnd > line) && ((nameEnd[-1] == ' ') || (nameEnd[-1] == '\t'))) nameEnd--;
+
+            if(multipartHeaderIs(line, nameEnd, "content-disposition")) {
+                part.name = QString::fromUtf8( multipartHeaderParam(colon, lineEnd, "name") );
+                part.fileName = QString::fromUtf8( multipartHeaderParam(colon, lineEnd, "filename") );
+            }
+            else if(multipartHeaderIs(line, nameEnd, "content-type")) {
+                const QByteArray value = QByteArray(colon + 1, static_cast<int>(lineEnd - colon - 1)).toLower();
+                part.binType = value.contains(ContentTypeBinary.toLatin1());
+                part.jsonType = value.contains(ContentTypeJSON.toLatin1());
+            }
+            else if(multipartHeaderIs(line, nameEnd, "content-transfer-encoding")) {
+                const QByteArray value = QByteArray(colon + 1, static_cast<int>(lineEnd - colon - 1)).trimmed().toUpper();
+                part.binType = (value == "BINARY");
+            }
+        }
+        line = lineEnd + endl.size();
+    }
+}
+//===================================================================================================
+// Значение части: двоичное/файл, JSON или текст. false - неверный JSON
+static bool storeMultipartValue(const MultipartPart &part, const QByteArray &value,
+                                QMap<QString, QString> &post, QMap<QString, QByteArray> &bin,
+                                QMap<QString, QJsonValue> &json)
+{
+    if(value.isEmpty()) return true;
 
-        if( _requestContent.contains( QString("\r\n--"+boundary+"\r\n").toLocal8Bit() ) ) endl = "\r\n"; else
-        if( _requestContent.contains( QString("\r--"+boundary+"\r").toLocal8Bit() ) ) endl = "\r"; else
-        if( _requestContent.contains( QString("\n--"+boundary+"\n").toLocal8Bit() ) ) endl = "\n";
+    if(part.binType || !part.fileName.isEmpty()) {
+        bin.insert( part.name, value );
+    }
+    else if(part.jsonType) {
+        QJsonDocument doc = QJsonDocument::fromJson(value);
+        if(doc.isNull() || doc.isEmpty() || !doc.isObject()) return false;
+        json.insert( part.name, doc.object() );
+    }
+    else {
+        QString val = QString::fromUtf8(value.constData(), value.size()).trimmed();
+        if(val.isEmpty()) val = "1";
+        post.insert( part.name, val );
+    }
+    return true;
+}
+//===================================================================================================
+MultipartStream::MultipartStream(const QByteArray &boundary, qint64 threshold, const QString &dir, QObject *fileParent,
+                                 QMap<QString, QString> &post, QMap<QString, QByteArray> &bin,
+                                 QMap<QString, QJsonValue> &json, QMap<QString, QTemporaryFile*> &files)
+    : _dashBoundary("--" + boundary)
+    , _threshold(threshold)
+    , _dir(dir)
+    , _fileParent(fileParent)
+    , _post(post)
+    , _bin(bin)
+    , _json(json)
+    , _files(files)
+{
 
-        QString boundaryMiddle = "--" + boundary + endl, boundaryEnd = "--" + boundary + "--";
-        bool itsEnd = false;
+}
+//===================================================================================================
+MultipartStream::~MultipartStream()
+{
+    // недописанная часть (ошибка или обрыв) на диске не остается
+    delete _file;
+}
+//===================================================================================================
+bool MultipartStream::write(const char *data, int size)
+{
+    _buf.append(data, size);
+    return process(false);
+}
+//===================================================================================================
+bool MultipartStream::finish()
+{
+    return process(true);
+}
+//===================================================================================================
+bool MultipartStream::process(bool atEnd)
+{
+    int pos = 0;
+    bool ok = true;
 
-        while((_requestContent.size()>0) && (!itsEnd)) {
-            // 1) удаляем часть контента до первого разделителя включая разделитель:
-            ii = _requestContent.indexOf( boundaryMiddle.toLocal8Bit() );
-            if(ii<0) break;
-            _requestContent.remove(0, ii+boundaryMiddle.length());
-            if(_requestContent.size() < 1) break;
+    while(ok && (_state != StateEnd)) {
+        const int left = _buf.size() - pos;
 
-            // 2) Определить положение следующего разделителя:
-            ii = _requestContent.indexOf( QString(endl + boundaryMiddle).toLocal8Bit() );
-            if(ii<0) {
-                itsEnd = true;
-                ii = _requestContent.indexOf( QString(endl + boundaryEnd).toLocal8Bit() );
-                if (ii < 0) ii = _requestContent.indexOf( QString(boundaryEnd).toLocal8Bit() );
-                if(ii < 0) ii = _requestContent.count();
+        if(_state == StatePreamble) {
+            // первый разделитель: в начале содержимого или после перевода строки
+            int n = _buf.indexOf(_dashBoundary, pos);
+            while((n == 0) ? _skipped : ((n > 0) && (_buf.at(n - 1) != '\n') && (_buf.at(n - 1) != '\r'))) {
+                n = _buf.indexOf(_dashBoundary, n + 1);
             }
-            if(ii<1) break;
-            // 3) копировать часть до разделителя и удалить из буфера:
-            QByteArray bVal = _requestContent.left(ii);
-            _requestContent.remove(0,ii);
-
-            // 4) отделить заголовок от данных:
-            ii = bVal.indexOf( QString(endl+endl).toLocal8Bit() );
-            if(ii<1) continue;
-
-            // 5) проверяем заголовок
-            sList = QString(bVal).left(ii).split(endl, QString::SkipEmptyParts);
-            bVal.remove(0, ii + 2*endl.length() );
-            if(bVal.count()<1) continue;
-
-            QString sName = "";
-            QString sFileName = "";
-            QString sType = "BINARY";
-            bool binType = false;
-            bool jsonType = false;
-
-            for(int i=0; i<sList.size(); i++) {
-
-                if( QString( sList.at(i) ).toUpper().contains("CONTENT-DISPOSITION:") ) {
-                    ii = QString( sList.at(i) ).toUpper().indexOf(" NAME=\"");
-                    if(ii<0) ii = QString( sList.at(i) ).toUpper().indexOf(";NAME=\"");
-                    if(ii>=0) {
-                        sName = QString( sList.at(i) ).right( QString(sList.at(i)).length() - ii - 7 );
-                        ii = sName.indexOf("\"");
-                        sName = (ii>0) ? sName.left(ii) : "";
-                    }
-                    ii = QString( sList.at(i) ).toUpper().indexOf(" FILENAME=\"");
-                    if(ii<0) ii = QString( sList.at(i) ).toUpper().indexOf(";FILENAME=\"");
-                    if(ii>=0) {
-                        sFileName = QString( sList.at(i) ).right( QString(sList.at(i)).length() - ii - 11 );
-                        ii = sFileName.indexOf("\"");
-                        sFileName = (ii>0) ? sFileName.left(ii) : "";
-                    }
-                }
-                else if( QString( sList.at(i) ).toUpper().contains("CONTENT-TYPE:") ) {
-                    binType = QString( sList.at(i) ).toLower().contains(ContentTypeBinary);
-                    jsonType = QString( sList.at(i) ).toLower().contains(ContentTypeJSON);
-                }
-                else {
-                    ii = QString( sList.at(i) ).toUpper().indexOf("CONTENT-TRANSFER-ENCODING:");
-                    if(ii>=0) {
-                        sType = QString( sList.at(i) ).right(
-                                    QString(sList.at(i)).length() - ii - 26 ).trimmed().toUpper();
-                        binType = (sType == "BINARY");
-                    }
+            if(n < 0) {
+                // хвост, в котором может начинаться разделитель, и символ перед ним ждут следующего куска
+                const int keep = _buf.size() - _dashBoundary.size();
+                if(keep > pos) {
+                    pos = keep;
+                    _skipped = true;
                 }
+                if(atEnd) _state = StateEnd;
+                break;
             }
-            if(sName.isEmpty()) continue;
-            //
-            if(binType || !sFileName.isEmpty()) {
-                mRequestBinParameters.insert(sName, bVal);
+            pos = n + _dashBoundary.size();
+            _state = StateDelimiter;
+        }
+        else if(_state == StateDelimiter) {
+            // "--" - конец содержимого, иначе перевод строки (при первом разделителе он определяет
+            // перевод строки клиента) и заголовки новой части
+            if((left < 2) && !atEnd) break;
+            const char *p = _buf.constData() + pos;
+            if((left >= 2) && (p[0] == '-') && (p[1] == '-')) {
+                _state = StateEnd;
+                break;
             }
-            else if(jsonType) {
-
-                QJsonDocument doc = QJsonDocument::fromJson(bVal);
-                if(doc.isNull() || doc.isEmpty() || !doc.isObject()) {
-                    _lastError = QObject::tr("Неверный формат параметра запроса JSON.");
-                    _requestContent.clear();
+            int skip = 0;
+            while((skip < left) && ((p[skip] == ' ') || (p[skip] == '\t'))) skip++;
+            if(_endl.isEmpty()) {
+                if((left - skip) < 2 && !atEnd) break;
+                if((left - skip) < 1) { _state = StateEnd; break; }
+                if(p[skip] == '\n') _endl = "\n";
+                else if(p[skip] != '\r') { _state = StateEnd; break; }
+                else _endl = ((left - skip) >= 2) && (p[skip + 1] == '\n') ? "\r\n" : "\r";
+                _delimiter = _endl + _dashBoundary;
+            }
+            if((left - skip) < _endl.size()) {
+                if(atEnd) _state = StateEnd;
+                break;
+            }
+            if(memcmp(p + skip, _endl.constData(), static_cast<size_t>(_endl.size())) != 0) {
+                _state = StateEnd;
+                break;
+            }
+            pos += skip + _endl.size();
+            _state = StateHeaders;
+        }
+        else if(_state == StateHeaders) {
+            _part = MultipartPart();
+            _value.clear();
+            // пустой блок заголовков: сразу перевод строки
+            if((left >= _endl.size()) && (memcmp(_buf.constData() + pos, _endl.constData(), static_cast<size_t>(_endl.size())) == 0)) {
+                pos += _endl.size();
+                _state = StateBody;
+                continue;
+            }
+            const int n = _buf.indexOf(_endl + _endl, pos);
+            if(n < 0) {
+                if(left > MaxPartHeaderSize) {
+                    _error = QObject::tr("Слишком большой заголовок части multipart.");
                     return false;
                 }
-                mRequestJsonParameters.insert( sName, doc.object() );
+                if(atEnd) _state = StateEnd;
+                break;
             }
-            else {
-                QString val = QString(bVal).trimmed();
-                if(val.isEmpty()) val = "1";
-                mRequestPostParameters.insert( sName, val );
+            parseMultipartHeaders(_buf.constData() + pos, _buf.constData() + n, _endl, _part);
+            pos = n + 2 * _endl.size();
+            _state = StateBody;
+        }
+        else if(_state == StateBody) {
+            const int n = _buf.indexOf(_delimiter, pos);
+            if(n >= 0) {
+                ok = appendValue(_buf.constData() + pos, n - pos) && finishPart();
+                pos = n + _delimiter.size();
+                _state = StateDelimiter;
+                continue;
+            }
+            if(atEnd) {
+                // последняя часть без перевода строки перед закрывающим разделителем
+                int end = _buf.indexOf(_dashBoundary + "--", pos);
+                if(end < 0) end = _buf.size();
+                ok = appendValue(_buf.constData() + pos, end - pos) && finishPart();
+                _state = StateEnd;
+                break;
+            }
+            // хвост, в котором может начинаться разделитель, ждет следующего куска
+            const int safe = _buf.size() - _delimiter.size() + 1;
+            if(safe > pos) {
+                ok = appendValue(_buf.constData() + pos, safe - pos);
+                pos = safe;
             }
+            break;
+        }
+    }
+
+    if(_state == StateEnd) _buf.clear();
+    else if(pos > 0) _buf.remove(0, pos);
+    return ok;
+}
+//===================================================================================================
+bool MultipartStream::appendValue(const char *data, int size)
+{
+    if(_part.name.isEmpty() || (size <= 0)) return true;
+
+    if(!_file) {
+        const bool fileType = _part.binType || !_part.fileName.isEmpty();
+        if(!fileType && (size > MaxPartValueSize - _value.size())) {
+            _error = QObject::tr("Слишком большое значение параметра '%1' multipart.").arg(_part.name);
+            return false;
         }
-        _requestContent.clear();
+        _value.append(data, size);
+        // в памяти файловая часть не растет больше MaxPartValueSize при любом пороге
+        if(!fileType || (_value.size() <= qMin(_threshold, static_cast<qint64>(MaxPartValueSize)))) return true;
+
+        // часть превысила порог: дальше пишется на диск
+        _file = new QTemporaryFile(QDir(_dir).filePath("upload_XXXXXX"));
+        if(!_file->open()) {
+            _error = QObject::tr("Не удалось создать временный файл в '%1': %2").arg(_dir).arg(_file->errorString());
+            return false;
+        }
+        data = _value.constData();
+        size = _value.size();
+    }
+
+    if(_file->write(data, size) != size) {
+        _error = QObject::tr("Ошибка записи временного файла '%1': %2").arg(_file->fileName()).arg(_file->errorString());
+        return false;
+    }
+    _value.clear();
+    return true;
+}
+//===================================================================================================
+bool MultipartStream::finishPart()
+{
+    if(_part.name.isEmpty()) return true;
+
+    if(_file) {
+        _file->close();
+        _file->setParent(_fileParent);
+        delete _files.value(_part.name, nullptr);
+        _files.insert(_part.name, _file);
+        _file = nullptr;
+        return true;
+    }
+
+    if(!storeMultipartValue(_part, _value, _post, _bin, _json)) {
+        _error = QObject::tr("Неверный формат параметра запроса JSON.");
+        return false;
     }
+    _value.clear();
+    return true;
+}
+//===================================================================================================
+bool HttpServer::parseMultipart(const QByteArray &boundary)
+{
+    const char *data = _requestContent.constData();
+    const int size = _requestContent.size();
+
+    // первый разделитель: в начале содержимого или после перевода строки (как в MultipartStream)
+    const QByteArray dashBoundary = "--" + boundary;
+    int first = _requestContent.indexOf(dashBoundary);
+    while((first > 0) && (data[first - 1] != '\n') && (data[first - 1] != '\r')) {
+        first = _requestContent.indexOf(dashBoundary, first + 1);
+    }
+    if(first < 0) return true;
+
+    // перевод строки клиента - тот, что стоит после первого разделителя
+    int n = first + dashBoundary.size();
+    while((n < size) && ((data[n] == ' ') || (data[n] == '\t'))) n++;
+    if((n >= size) || ((data[n] != '\n') && (data[n] != '\r'))) return true;
+    const QByteArray endl = (data[n] == '\n') ? "\n" : (((n + 1) < size) && (data[n + 1] == '\n')) ? "\r\n" : "\r";
+    const int endlLength = endl.size();
+    const QByteArrayMatcher delimiter( endl + dashBoundary );
+    const QByteArrayMatcher headersEnd( endl + endl );
+
+    // Один проход по содержимому: каждый байт просматривается не более одного раза
+    // поиском разделителя и один раз разбором заголовков своей части. Значения
+    // файловых и двоичных частей ссылаются на _requestContent без копирования.
+    enum { StateDelimiter, StatePart, StateEnd } state = StateDelimiter;
+    int pos = first + dashBoundary.size();
+
+    while(state != StateEnd) {
+        switch (state) {
+
+        case StateDelimiter:
+            // "--" после разделителя - конец содержимого, иначе перевод строки и новая часть
+            if(((size - pos) >= 2) && (data[pos] == '-') && (data[pos + 1] == '-')) {
+                state = StateEnd;
+                break;
+            }
+            while((pos < size) && ((data[pos] == ' ') || (data[pos] == '\t'))) pos++;
+            if(((size - pos) < endlLength) || (memcmp(data + pos, endl.constData(), static_cast<size_t>(endlLength)) != 0)) {
+                state = StateEnd;
+                break;
+            }
+            pos += endlLength;
+            state = StatePart;
+            break;
+
+        case StatePart: {
+            const int partBegin = pos;
+            int partEnd = delimiter.indexIn(_requestContent, partBegin);
+            if(partEnd < 0) {
+                // последняя часть без перевода строки перед закрывающим разделителем
+                partEnd = _requestContent.indexOf(dashBoundary + "--", partBegin);
+                if(partEnd < 0) partEnd = size;
+                pos = size;
+                state = StateEnd;
+            }
+            else {
+                pos = partEnd + endlLength + dashBoundary.size();
+                state = StateDelimiter;
+            }
 
+            // заголовки части: от перевода строки разделителя до пустой строки;
+            // поиск ограничен самой частью
+            const QByteArray block = QByteArray::fromRawData(data + partBegin - endlLength,
+                                                             partEnd - partBegin + endlLength);
+            const int headerBlockEnd = headersEnd.indexIn(block, 0);
+            if(headerBlockEnd < 1) break;
+            const int bodyBegin = partBegin - endlLength + headerBlockEnd + 2 * endlLength;
+            if(bodyBegin >= partEnd) break;
+
+            MultipartPart part;
+            parseMultipartHeaders(data + partBegin, data + partBegin - endlLength + headerBlockEnd, endl, part);
+            if(part.name.isEmpty()) break;
+
+            if(!storeMultipartValue(part, QByteArray::fromRawData(data + bodyBegin, partEnd - bodyBegin),
+                                    mRequestPostParameters, mRequestBinParameters, mRequestJsonParameters)) {
+                _lastError = QObject::tr("Неверный формат параметра запроса JSON.");
+                return false;
+            }
+            break;
+        }
+
+        default:
+            state = StateEnd;
+            break;
+        }
+    }
     return true;
 }
+//===================================================================================================
+bool HttpServer::readMultipartToFiles(const QByteArray &boundary)
+{
+    const QString dir = _uploadDir.isEmpty() ? QDir::tempPath() : _uploadDir;
+    MultipartStream stream(boundary, _uploadFileThreshold, dir, this,
+                           mRequestPostParameters, mRequestBinParameters, mRequestJsonParameters, mRequestFiles);
+
+    // содержимое целиком в памяти не держится: _requestContent остается пустым,
+    // а буфер чтения - один кусок
+    QByteArray chunk;
+    if(readRequestContent(chunk, &stream) && stream.finish()) return true;
+
+    if(!stream.errorString().isEmpty()) _lastError = stream.errorString();
+    qDeleteAll(mRequestFiles);
+    mRequestFiles.clear();
+    mRequestPostParameters.clear();
+    mRequestBinParameters.clear();
+    mRequestJsonParameters.clear();
+    return false;
+}
 //=================================================================================================
 void HttpServer::readRequest(bool *ok /* = nullptr */)
 {
@@ -434,6 +875,8 @@ bool HttpServer::processReadRequest()
     mRequestPostParameters.clear();
     mRequestBinParameters.clear();
     mRequestJsonParameters.clear();
+    qDeleteAll(mRequestFiles);
+    mRequestFiles.clear();
     _requestContent.clear();
     _readRequestOK = true;
 
@@ -551,6 +994,25 @@ bool HttpServer::writeResponseContent()
     }
     headers.append( QString("\r\n").toUtf8() );
 
+    if(_external) {
+        emit responseReady(headers, _responseContent);
+    }
+    else if(!writeStandardOutput(headers)) {
+        return false;
+    }
+
+    if(_dbg && mResponseHeaders.value(HeaderContentType).contains(ContentTypeJSON)) {
+        emit toLog(LogDbg, QObject::tr("JSON содержимое ответа:"));
+        QString logStr = QJsonDocument::fromJson(_responseContent).toJson();
+        if(logStr.length() > 5000) logStr = logStr.left(5000) + "\n...";
+        emit toLog(LogDbg, logStr);
+    }
+
+    return true;
+}
+//===================================================================================================
+bool HttpServer::writeStandardOutput(QByteArray headers)
+{
 #ifdef Q_OS_WIN32
     _setmode(_fileno(stdout), _O_BINARY);
 #endif
@@ -590,13 +1052,6 @@ bool HttpServer::writeResponseContent()
         return false;
     }
 
-    if(_dbg && mResponseHeaders.value(HeaderContentType).contains(ContentTypeJSON)) {
-        emit toLog(LogDbg, QObject::tr("JSON содержимое ответа:"));
-        QString logStr = QJsonDocument::fromJson(_responseContent).toJson();
-        if(logStr.length() > 5000) logStr = logStr.left(5000) + "\n...";
-        emit toLog(LogDbg, logStr);
-    }
-
     return true;
 }
 //===================================================================================================
@@ -609,11 +1064,14 @@ QVariant HttpServer::requestParameter(const QString &name) const
         return QVariant(mRequestGetParameters.value(name));
     }
     if (mRequestBinParameters.contains(name)) {
-        return QVariant(mRequestBinParameters.value(name));
+        return QVariant(requestBinParameter(name));
     }
     if (mRequestJsonParameters.contains(name)) {
         return QVariant(mRequestJsonParameters.value(name));
     }
+    if (mRequestFiles.contains(name)) {
+        return QVariant(mRequestFiles.value(name)->fileName());
+    }
 
     return QVariant();
 }
@@ -653,11 +1111,41 @@ QString HttpServer::requestCookie(const QString &name) const
 QByteArray HttpServer::requestBinParameter(const QString &name) const
 {
     if (mRequestBinParameters.contains(name)) {
-        return mRequestBinParameters.value(name);
+        // значение - срез содержимого запроса (fromRawData): наружу отдается собственная копия
+        const QByteArray value = mRequestBinParameters.value(name);
+        return QByteArray(value.constData(), value.size());
     }
     return QByteArray();
 }
 //===================================================================================================
+QMap<QString, QByteArray> HttpServer::requestBinParameters() const
+{
+    QMap<QString, QByteArray> params;
+    QMap<QString, QByteArray>::const_iterator itr;
+    for (itr = mRequestBinParameters.constBegin(); itr != mRequestBinParameters.constEnd(); ++itr) {
+        params.insert(itr.key(), QByteArray(itr.value().constData(), itr.value().size()));
+    }
+    return params;
+}
+//===================================================================================================
+QString HttpServer::requestFileParameter(const QString &name) const
+{
+    if (mRequestFiles.contains(name)) {
+        return mRequestFiles.value(name)->fileName();
+    }
+    return QString();
+}
+//===================================================================================================
+QMap<QString, QString> HttpServer::requestFileParameters() const
+{
+    QMap<QString, QString> files;
+    QMap<QString, QTemporaryFile*>::const_iterator itr;
+    for (itr = mRequestFiles.constBegin(); itr != mRequestFiles.constEnd(); ++itr) {
+        files.insert(itr.key(), itr.value()->fileName());
+    }
+    return files;
+}
+//===================================================================================================
 QJsonValue HttpServer::requestJsonParameter(const QString &name) const
 {
     if (mRequestJsonParameters.contains(name)) {
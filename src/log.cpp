@@ -22,11 +22,28 @@
 ** WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 **
 ****************************************************************************/
+#include <QAtomicInt>
 #include <QCoreApplication>
+#include <QDataStream>
 #include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QRegularExpression>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include <algorithm>
+#include <cstring>
+#include <functional>
 
 #include "log.h"
 #include "filesys.h"
+#include "crc.h"
+#include "parallel.h"
 
 namespace nayk {
 //=======================================================================================================
@@ -60,67 +77,625 @@ const QString clLogDbgLight       = "#006766";
 const QString clLogOtherDark      = "#8f8f8f";
 const QString clLogOtherLight     = "#888888";
 
+const int LogQueueMax             = 100000; // при переполнении очереди write() ждет писателя
+const int LogArchiveChunk         = 16 * 1024 * 1024; // сжатие при ротации: отдельный член gzip на кусок
+
+// постоянные метки типов строк, индекс - LogType
+const QString logTags[] = { "[inf] ", "[wrn] ", "[err] ", "[<<<] ", "[>>>] ", "[txt] ", "[dbg] " };
+
+//=======================================================================================================
+// строки оформления highlightLog, строятся один раз на пару (формат, темный фон); индекс - LogType
+struct LogStyle
+{
+    QString preDate, prePrefix, suffix, endLine, emptyText;
+    QString pre[LogOther + 1];
+    QString open[LogOther + 1];
+    QString close[LogOther + 1];
+    int lineOverhead {0};
+};
+//=======================================================================================================
+static LogStyle makeLogStyle(LogFormat logFormat, bool darkBackground)
+{
+    LogStyle style;
+    style.endLine = "\n";
+    style.emptyText = " ";
+    style.lineOverhead = 2;
+    if ((logFormat != RichLog) && (logFormat != HtmlLog)) return style;
+
+    const QString pre = (logFormat == RichLog) ? "<font color=\"" : "<span style=\"color: ";
+    const QString post = (logFormat == RichLog) ? "\">" : ";\">";
+    const QString colors[] = {
+        darkBackground ? clLogInfDark : clLogInfLight,
+        darkBackground ? clLogWrnDark : clLogWrnLight,
+        darkBackground ? clLogErrDark : clLogErrLight,
+        darkBackground ? clLogInDark : clLogInLight,
+        darkBackground ? clLogOutDark : clLogOutLight,
+        darkBackground ? clLogTxtDark : clLogTxtLight,
+        darkBackground ? clLogDbgDark : clLogDbgLight,
+        darkBackground ? clLogOtherDark : clLogOtherLight
+    };
+
+    style.endLine = "<br>";
+    style.emptyText = "&nbsp;";
+    style.suffix = (logFormat == RichLog) ? "</font>" : "</span>";
+    style.preDate = pre + (darkBackground ? clLogDateDark : clLogDateLight) + post;
+    style.prePrefix = pre + (darkBackground ? clLogPrefixDark : clLogPrefixLight) + post;
+    for (int i = LogInfo; i <= LogOther; ++i) style.pre[i] = pre + colors[i] + post;
+    style.open[LogWarning] = "<i>";
+    style.close[LogWarning] = "</i>";
+    style.open[LogError] = "<b><i>";
+    style.close[LogError] = "</i></b>";
+
+    style.lineOverhead = style.preDate.size() + style.prePrefix.size() + style.pre[LogOther].size()
+            + 3 * style.suffix.size() + 15 + style.endLine.size() + style.emptyText.size();
+    return style;
+}
+//=======================================================================================================
+static const LogStyle &logStyle(LogFormat logFormat, bool darkBackground)
+{
+    static const LogStyle styles[3][2] = {
+        { makeLogStyle(PlainLog, false), makeLogStyle(PlainLog, true) },
+        { makeLogStyle(RichLog, false), makeLogStyle(RichLog, true) },
+        { makeLogStyle(HtmlLog, false), makeLogStyle(HtmlLog, true) }
+    };
+    const int f = ((logFormat == RichLog) || (logFormat == HtmlLog)) ? logFormat : PlainLog;
+    return styles[f][darkBackground ? 1 : 0];
+}
+//=======================================================================================================
+// тип строки по трем символам метки ("inf" из "[inf]"), LogOther - если метка неизвестна
+static LogType logTagType(const QChar *tag)
+{
+    for (int i = LogInfo; i < LogOther; ++i) {
+        const QString &t = logTags[i];
+        if ((tag[0] == t.at(1)) && (tag[1] == t.at(2)) && (tag[2] == t.at(3))) return static_cast<LogType>(i);
+    }
+    return LogOther;
+}
+//=======================================================================================================
+// добавление текста с заменой символов, как в QString::toHtmlEscaped()
+static void appendLogText(QString &res, const QChar *str, int len, bool escape)
+{
+    if (!escape) {
+        res.append(str, len);
+        return;
+    }
+    int from = 0;
+    for (int i = 0; i < len; ++i) {
+        const ushort c = str[i].unicode();
+        if ((c != '<') && (c != '>') && (c != '&') && (c != '"')) continue;
+        res.append(str + from, i - from);
+        res += (c == '<') ? QLatin1String("&lt;") : (c == '>') ? QLatin1String("&gt;")
+             : (c == '&') ? QLatin1String("&amp;") : QLatin1String("&quot;");
+        from = i + 1;
+    }
+    res.append(str + from, len - from);
+}
+//=======================================================================================================
+// кэш времени для текущего потока: "[HH:mm:ss." форматируется раз в секунду, в пределах секунды
+// дописываются только миллисекунды; смещение локального времени тоже запрашивается раз в секунду
+struct LogTimeCache
+{
+    int second {-1};
+    QString secondText;
+    qint64 utcSecond {-1};
+    int offset {0};
+};
+
+thread_local LogTimeCache logTimeCache;
+
+//=======================================================================================================
+// кодирование записей двоичного лога
+const char LogBinaryVersion       = 1;
+const qint64 LogUnixEpochDay      = 2440588; // юлианский день 1970-01-01
+
+static qint64 logWallTime(const QDateTime &date)
+{
+    return (date.date().toJulianDay() - LogUnixEpochDay) * 86400000 + date.time().msecsSinceStartOfDay();
+}
+
+static quint64 logZigZag(qint64 value)
+{
+    return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+}
+
+static int putLogVarint(char *buf, quint64 value)
+{
+    int n = 0;
+    while (value >= 0x80) {
+        buf[n++] = static_cast<char>((value & 0x7F) | 0x80);
+        value >>= 7;
+    }
+    buf[n++] = static_cast<char>(value);
+    return n;
+}
+
+// false - данные кончились или испорчены
+static bool getLogVarint(const char *data, qint64 size, qint64 &pos, quint64 &value)
+{
+    value = 0;
+    for (int shift = 0; (shift < 64) && (pos < size); shift += 7) {
+        const quint8 b = static_cast<quint8>(data[pos++]);
+        value |= static_cast<quint64>(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+//=======================================================================================================
+// каталог суток в дереве логов: root/yyyy/MM/dd/
+static QString logDayPath(const QString &rootLogDir, const QDate &date)
+{
+    QString d = QDir::toNativeSeparators(rootLogDir);
+    if(d.right(1) != QDir::separator()) d += QDir::separator();
+    return d + date.toString("yyyy") + QDir::separator()
+            + date.toString("MM") + QDir::separator()
+            + date.toString("dd") + QDir::separator();
+}
+//=======================================================================================================
+static QString newLogFileName(const QString &path, const QDateTime &date, const QString &ext)
+{
+    QString name = date.toString("HHmmsszzz");
+    int n = 99;
+    // учитываются и уже сжатые при ротации файлы
+    while ( (n>10) && ( FileSys::fileExists( path + name + QString::number(n,10) + ext )
+                        || FileSys::fileExists( path + name + QString::number(n,10) + ext + ".gz" )))
+        n--;
+    return name + QString::number(n) + ext;
+}
+//=======================================================================================================
+// фоновая обработка закрытого при ротации файла: сжатие и ограничение общего объема логов.
+// Задачи выполняются по одной в пуле Log, поэтому не мешают друг другу
+class LogArchiveTask : public QRunnable
+{
+public:
+    LogArchiveTask(const QString &fileName, bool compress, const QString &logDir, bool dayTree,
+                   qint64 maxTotalSize, const QString &activeFile, const QString &startFile)
+        : _fileName(fileName), _compress(compress), _logDir(logDir), _dayTree(dayTree),
+          _maxTotalSize(maxTotalSize), _activeFile(activeFile), _startFile(startFile) {}
+    void run() override;
+
+private:
+    QString _fileName;
+    bool _compress;
+    QString _logDir;
+    bool _dayTree;
+    qint64 _maxTotalSize;
+    QString _activeFile;
+    QString _startFile;
+
+    void compressFile();
+    void applyRetention();
+};
+//=======================================================================================================
+void LogArchiveTask::run()
+{
+    if (_compress) compressFile();
+    if (_maxTotalSize > 0) applyRetention();
+}
+//=======================================================================================================
+void LogArchiveTask::compressFile()
+{
+    // размер файла при ротации только по суткам не ограничен: файл сжимается кусками по
+    // LogArchiveChunk, каждый - отдельный член gzip (RFC 1952, 2.2), память не зависит от размера
+    QFile f(_fileName);
+    if (!f.open(QIODevice::ReadOnly)) return;
+    QSaveFile out(_fileName + ".gz");
+    if (!out.open(QIODevice::WriteOnly)) return;
+
+    do {
+        const QByteArray chunk = f.read(LogArchiveChunk);
+        if (chunk.isEmpty() && !f.atEnd()) return;  // ошибка чтения
+        const QByteArray gz = Log::compressLog(chunk);
+        if (gz.isEmpty() || (out.write(gz) != gz.size())) return;
+    } while (!f.atEnd());
+    f.close();
+
+    if (!out.commit()) return;
+    QFile::remove(_fileName);
+    QFile::remove( LogIndex::indexFileName(_fileName) );
+}
+//=======================================================================================================
+void LogArchiveTask::applyRetention()
+{
+    // удаляются самые старые файлы; в дереве логов учитываются только файлы вида yyyy/MM/dd/*.[b]log[.gz].
+    // Чужие логи в том же каталоге не трогаются: свои - это имена newLogFileName и файл из startLog(fileName)
+    const QRegularExpression dayTreeRe("^[\\\\/]?\\d{4}[\\\\/]\\d{2}[\\\\/]\\d{2}[\\\\/][^\\\\/]+$");
+    const QRegularExpression ownRe("^\\d{11}\\.b?log(\\.gz)?$");
+    const QString active = QFileInfo(_activeFile).absoluteFilePath();
+    const QString root = QFileInfo(_logDir).absoluteFilePath();
+
+    QFileInfoList files;
+    qint64 total = 0;
+    QDirIterator it(_logDir, QStringList() << "*.log" << "*.log.gz" << "*.blog" << "*.blog.gz", QDir::Files | QDir::NoSymLinks,
+                    _dayTree ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+    while (it.hasNext()) {
+        it.next();
+        const QFileInfo info = it.fileInfo();
+        if (_dayTree && !dayTreeRe.match( info.absoluteFilePath().mid(root.size()) ).hasMatch()) continue;
+        const QString name = info.fileName();
+        const bool startFile = !_startFile.isEmpty() && ((name == _startFile) || (name == _startFile + ".gz"));
+        if (!startFile && !ownRe.match(name).hasMatch()) continue;
+        total += info.size();
+        if (info.absoluteFilePath() != active) files.append(info);
+    }
+
+    std::sort(files.begin(), files.end(), [](const QFileInfo &a, const QFileInfo &b) {
+        if (a.lastModified() != b.lastModified()) return a.lastModified() < b.lastModified();
+        return a.fileName() < b.fileName();
+    });
+
+    for (int i = 0; (i < files.size()) && (total > _maxTotalSize); ++i) {
+        if (!QFile::remove( files.at(i).absoluteFilePath() )) continue;
+        QFile::remove( LogIndex::indexFileName(files.at(i).absoluteFilePath()) );
+        total -= files.at(i).size();
+    }
+}
+
+//=======================================================================================================
+// поток асинхронной записи: очередь под коротким мьютексом, писатель забирает ее целиком (swap)
+struct LogEntry
+{
+    QDateTime date;
+    LogType logType;
+    QString text;
+};
+
+class LogWriter : public QThread
+{
+public:
+    LogWriter(Log *log, int flushBytes, int flushMsec)
+        : _log(log), _flushBytes(flushBytes), _flushMsec(flushMsec) {}
+    ~LogWriter() { stop(); }
+    bool enqueue(LogType logType, const QDateTime &date, const QString &text);
+    bool flush();
+    void stop();
+    void setThreshold(int flushBytes, int flushMsec);
+
+protected:
+    void run() override;
+
+private:
+    Log *_log;
+    QMutex _mutex;
+    QWaitCondition _hasData;
+    QWaitCondition _hasSpace;
+    QWaitCondition _flushed;
+    QVector<LogEntry> _queue;
+    quint64 _enqueuedCount {0};
+    quint64 _flushedCount {0};
+    int _flushBytes;
+    int _flushMsec;
+    bool _flushRequested {false};
+    bool _stop {false};
+    bool _failed {false};
+};
+//=======================================================================================================
+bool LogWriter::enqueue(LogType logType, const QDateTime &date, const QString &text)
+{
+    QMutexLocker locker(&_mutex);
+    while ((_queue.size() >= LogQueueMax) && !_failed) _hasSpace.wait(&_mutex);
+    if (_failed) return false;
+    if (_queue.isEmpty()) _hasData.wakeOne();
+    _queue.append( LogEntry { date, logType, text } );
+    ++_enqueuedCount;
+    return true;
+}
+//=======================================================================================================
+bool LogWriter::flush()
+{
+    QMutexLocker locker(&_mutex);
+    const quint64 target = _enqueuedCount;
+    _flushRequested = true;
+    _hasData.wakeOne();
+    while ((_flushedCount < target) && !_failed && isRunning()) _flushed.wait(&_mutex, 100);
+    return !_failed;
+}
+//=======================================================================================================
+void LogWriter::stop()
+{
+    if (!isRunning()) return;
+    {
+        QMutexLocker locker(&_mutex);
+        _stop = true;
+        _hasData.wakeOne();
+    }
+    wait();
+}
+//=======================================================================================================
+void LogWriter::setThreshold(int flushBytes, int flushMsec)
+{
+    QMutexLocker locker(&_mutex);
+    _flushBytes = flushBytes;
+    _flushMsec = flushMsec;
+}
+//=======================================================================================================
+void LogWriter::run()
+{
+    QVector<LogEntry> batch;
+    quint64 written = 0;
+    qint64 unflushed = 0;
+    QElapsedTimer sinceFlush;
+    sinceFlush.start();
+
+    for (;;) {
+        bool flushRequested = false;
+        bool stop = false;
+        int flushBytes = 0;
+        int flushMsec = 0;
+        {
+            QMutexLocker locker(&_mutex);
+            while (_queue.isEmpty() && !_stop && !_flushRequested) {
+                if (unflushed == 0) {
+                    _hasData.wait(&_mutex);
+                    continue;
+                }
+                // есть несброшенные данные: ждем не дольше порога по времени
+                const qint64 remaining = _flushMsec - sinceFlush.elapsed();
+                if (remaining <= 0) break;
+                _hasData.wait(&_mutex, static_cast<unsigned long>(remaining));
+            }
+            batch.swap(_queue);
+            _hasSpace.wakeAll();
+            flushRequested = _flushRequested;
+            _flushRequested = false;
+            stop = _stop;
+            flushBytes = _flushBytes;
+            flushMsec = _flushMsec;
+        }
+
+        bool ok = true;
+        for (const LogEntry &entry: batch) {
+            const qint64 size = _log->writeEntry( entry.logType, entry.date, entry.text );
+            if (size < 0) {
+                ok = false;
+                break;
+            }
+            unflushed += size;
+        }
+        written += static_cast<quint64>(batch.size());
+        batch.clear();
+
+        if (ok && (flushRequested || stop || (unflushed >= flushBytes) || (sinceFlush.elapsed() >= flushMsec))) {
+            _log->stream.flush();
+            _log->file.flush();
+            _log->_fileSize = _log->file.pos();
+            ok = (_log->stream.status() == QTextStream::Ok);
+            unflushed = 0;
+            sinceFlush.restart();
+        }
+
+        {
+            QMutexLocker locker(&_mutex);
+            if (!ok) _failed = true;
+            if (unflushed == 0) _flushedCount = written;
+            _flushed.wakeAll();
+            if ((stop && _queue.isEmpty()) || _failed) break;
+        }
+    }
+}
 //=======================================================================================================
 Log::Log(QObject *parent, QDateTime startTime, const QString &logDir, bool startLogging) : QObject(parent)
 {
     startingTime = startTime.isValid() ? startTime : QDateTime::currentDateTime();
-    logPath = QDir::toNativeSeparators( logDir.isEmpty() ? QDir::currentPath() : logDir );
-    if (logPath.right(1) != QDir::separator())
-        logPath += QDir::separator();
-    logPath += startingTime.toString("yyyy") + QDir::separator()
-            + startingTime.toString("MM") + QDir::separator()
-            + startingTime.toString("dd") + QDir::separator();
+    _localTime = (startingTime.offsetFromUtc() != 0);
+    logRoot = logDir.isEmpty() ? QDir::currentPath() : logDir;
+    logPath = logDayPath(logRoot, startingTime.date());
+    _archivePool = new QThreadPool(this);
+    _archivePool->setMaxThreadCount(1);
     if (startLogging)
         startLog();
 }
 //=======================================================================================================
 Log::~Log()
 {
-    if (file.isOpen()) {
+    if (isOpened()) {
         writeLastLine();
+        stopWriter();
+        _opened.storeRelease(0);
         file.close();
-        emit closeFile(logPath + logFile);
+        emit closeFile(logFileName());
+    }
+    stopWriter();
+    _archivePool->waitForDone();
+}
+//=======================================================================================================
+void Log::setAsync(bool on)
+{
+    if (on == isAsync()) return;
+
+    if (on) {
+        stream.flush();
+        _writer = new LogWriter(this, _flushBytes, _flushMsec);
+        _writer->start();
+    }
+    else {
+        stopWriter();
     }
 }
 //=======================================================================================================
+void Log::setFlushThreshold(int flushBytes, int flushMsec)
+{
+    _flushBytes = qMax(flushBytes, 0);
+    _flushMsec = qMax(flushMsec, 0);
+    if (_writer) _writer->setThreshold(_flushBytes, _flushMsec);
+}
+//=======================================================================================================
+bool Log::flush()
+{
+    if(!isOpened()) {
+        setLastError(tr("Лог-файл не открыт для записи."));
+        return false;
+    }
+    if (_writer) {
+        if (!_writer->flush()) return writeError();
+        return true;
+    }
+
+    stream.flush();
+    file.flush();
+    if (stream.status() != QTextStream::Ok) return writeError();
+    return true;
+}
+//=======================================================================================================
+void Log::setRotation(qint64 maxFileSize, bool daily)
+{
+    _maxFileSize = (maxFileSize > 0) ? maxFileSize : 0;
+    _daily = daily;
+}
+//=======================================================================================================
+bool Log::waitForArchive(int msecs)
+{
+    return _archivePool->waitForDone(msecs);
+}
+//=======================================================================================================
+QString Log::logFileName() const
+{
+    // при асинхронной записи имя меняется в потоке писателя
+    QMutexLocker locker(&_nameMutex);
+    return logPath + logFile;
+}
+//=======================================================================================================
+QString Log::lastError() const
+{
+    QMutexLocker locker(&_nameMutex);
+    return _lastError;
+}
+//=======================================================================================================
+// ошибку может записать поток писателя (ротация), а прочитать - поток владельца
+void Log::setLastError(const QString &text)
+{
+    QMutexLocker locker(&_nameMutex);
+    _lastError = text;
+}
+//=======================================================================================================
+// openFile/closeFile всегда приходят в потоке владельца, даже если файл сменил поток писателя
+void Log::emitFileSignal(const char *signal, const QString &fileName)
+{
+    const Qt::ConnectionType type = (QThread::currentThread() == thread()) ? Qt::DirectConnection : Qt::QueuedConnection;
+    QMetaObject::invokeMethod(this, signal, type, Q_ARG(QString, fileName));
+}
+//=======================================================================================================
+void Log::stopWriter()
+{
+    if (!_writer) return;
+    _writer->stop();
+    delete _writer;
+    _writer = nullptr;
+}
+//=======================================================================================================
+bool Log::writeError()
+{
+    stopWriter();
+    _opened.storeRelease(0);
+    file.close();
+    setLastError(tr("Ошибка при записи в лог-файл."));
+    emitFileSignal("closeFile", logFileName());
+    return false;
+}
+//=======================================================================================================
 bool Log::startLog(const QString &fileName, bool saveDbg)
 {
     _dbg = saveDbg;
 
-    if(file.isOpen()) {
-        _lastError = tr("Лог-файл уже открыт на запись.");
+    if(isOpened()) {
+        setLastError(tr("Лог-файл уже открыт на запись."));
         return false;
     }
     if(fileName.isEmpty()) {
-        logFile = startingTime.toString("HHmmsszzz");
-        int n = 99;
-        while ( (n>10) && FileSys::fileExists( logPath + logFile + QString::number(n,10) + ".log" ))
-            n--;
-        logFile += QString::number(n) + ".log";
+        _startFile = "";
+        if (!openLogFile(logPath, newLogFileName(logPath, startingTime, _binary ? ".blog" : ".log"))) return false;
     }
     else {
-        logPath = FileSys::extractFilePath(fileName);
-        logFile = FileSys::extractFileName(fileName);
+        logRoot = "";
+        _startFile = FileSys::extractFileName(fileName);
+        if (!openLogFile(FileSys::extractFilePath(fileName), FileSys::extractFileName(fileName))) return false;
     }
-    if(!FileSys::makePath(logPath)) {
-        _lastError = tr("Не удалось создать каталог для лог-файла.");
+    _opened.storeRelease(1);
+    return writeFirstLine();
+}
+//=======================================================================================================
+bool Log::openLogFile(const QString &path, const QString &name)
+{
+    if(!FileSys::makePath(path)) {
+        setLastError(tr("Не удалось создать каталог для лог-файла."));
         return false;
     }
+    {
+        QMutexLocker locker(&_nameMutex);
+        logPath = path;
+        logFile = name;
+    }
 
-    file.setFileName(logPath + logFile);
-    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        _lastError = tr("Не удалось создать лог-файл.");
+    file.setFileName(path + name);
+    if (!file.open(_binary ? QIODevice::WriteOnly : QIODevice::WriteOnly | QIODevice::Text)) {
+        setLastError(tr("Не удалось создать лог-файл."));
         return false;
     }
-    emit openFile(logPath + logFile);
+    _fileDate = currentTime().date();
+    _fileSize = 0;
+    _binaryTime = 0;
+    if (_binary) {
+        const char header[] = { 'N', 'L', 'O', 'G', LogBinaryVersion, static_cast<char>(_localTime ? 1 : 0) };
+        if (file.write(header, sizeof(header)) != sizeof(header)) {
+            file.close();
+            setLastError(tr("Не удалось создать лог-файл."));
+            return false;
+        }
+    }
+    emitFileSignal("openFile", path + name);
     stream.setDevice(&file);
-    return writeFirstLine();
+    return true;
+}
+//=======================================================================================================
+bool Log::rotate(const QDateTime &date)
+{
+    stream.flush();
+    file.close();
+    const QString oldFile = logFileName();
+    emitFileSignal("closeFile", oldFile);
+
+    const QString path = logRoot.isEmpty() ? logPath : logDayPath(logRoot, date.date());
+    if (!openLogFile(path, newLogFileName(path, date, _binary ? ".blog" : ".log"))) return false;
+    _fileDate = date.date();
+
+    if (_compress || (_maxTotalSize > 0)) {
+        _archivePool->start( new LogArchiveTask(oldFile, _compress, logRoot.isEmpty() ? path : logRoot,
+                                                !logRoot.isEmpty(), _maxTotalSize, path + logFile, _startFile) );
+    }
+    return true;
+}
+//=======================================================================================================
+qint64 Log::writeEntry(LogType logType, const QDateTime &date, const QString &text)
+{
+    const bool full = (_maxFileSize > 0) && (_fileSize >= _maxFileSize);
+    const bool newDay = _daily && date.isValid() && (date.date() != _fileDate);
+    if ((full || newDay) && !rotate(date)) return -1;
+
+    const qint64 size = _binary ? writeRecord(logType, date, text) : writeLines(stream, logType, date, text);
+    if (size > 0) _fileSize += size;
+    return size;
+}
+//=======================================================================================================
+qint64 Log::writeRecord(LogType logType, const QDateTime &date, const QString &text)
+{
+    // время записи - местное (или UTC) время суток как в текстовом логе, в мсек от 1970-01-01
+    const qint64 time = logWallTime(date);
+    const QByteArray payload = text.toUtf8();
+
+    char head[24];
+    int n = putLogVarint(head, logZigZag(time - _binaryTime));
+    head[n++] = static_cast<char>(logType);
+    n += putLogVarint(head + n, static_cast<quint64>(payload.size()));
+    _binaryTime = time;
+
+    if ((file.write(head, n) != n) || (file.write(payload) != payload.size())) return -1;
+    return n + payload.size();
 }
 //=======================================================================================================
 bool Log::writeFirstLine()
 {
-    if(!file.isOpen()) {
-        _lastError = tr("Лог-файл не открыт для записи.");
+    if(!isOpened()) {
+        setLastError(tr("Лог-файл не открыт для записи."));
         return false;
     }
 
@@ -130,14 +705,14 @@ bool Log::writeFirstLine()
 //=======================================================================================================
 bool Log::writeLastLine()
 {
-    if(!file.isOpen()) {
-        _lastError = tr("Лог-файл не открыт для записи.");
+    if(!isOpened()) {
+        setLastError(tr("Лог-файл не открыт для записи."));
         return false;
     }
 
     QCoreApplication::processEvents();
 
-    QDateTime now = (startingTime.offsetFromUtc() != 0) ? QDateTime::currentDateTime() : QDateTime::currentDateTimeUtc();
+    QDateTime now = currentTime();
     qint64 n = now.toMSecsSinceEpoch() - startingTime.toMSecsSinceEpoch();
     QString logStr = tr("----- Окончание. Время работы: ") + QString::number(n) + tr(" мсек. -----");
 
@@ -146,62 +721,84 @@ bool Log::writeLastLine()
 //=======================================================================================================
 QString Log::getLogPrefix(LogType logType, const QDateTime &date)
 {
-    QString prefix = "[" + date.toString("HH:mm:ss.zzz") + "]";
-
-    switch (logType) {
-    case LogInfo:
-        prefix += "[inf] ";
-        break;
-    case LogWarning:
-        prefix += "[wrn] ";
-        break;
-    case LogError:
-        prefix += "[err] ";
-        break;
-    case LogIn:
-        prefix += "[<<<] ";
-        break;
-    case LogOut:
-        prefix += "[>>>] ";
-        break;
-    case LogText:
-        prefix += "[txt] ";
-        break;
-    case LogDbg:
-        prefix += "[dbg] ";
-        break;
-    default:
-        prefix = "";
-        break;
+    if ((logType < LogInfo) || (logType >= LogOther)) return "";
+
+    QString prefix;
+    prefix.reserve(20);
+    prefix += QChar('[');
+
+    if (date.isValid()) {
+        const int msecs = date.time().msecsSinceStartOfDay();
+        LogTimeCache &cache = logTimeCache;
+        if (cache.second != msecs / 1000) {
+            cache.second = msecs / 1000;
+            cache.secondText = date.toString("HH:mm:ss.");
+        }
+        const int ms = msecs % 1000;
+        prefix += cache.secondText;
+        prefix += QChar('0' + ms / 100);
+        prefix += QChar('0' + ms / 10 % 10);
+        prefix += QChar('0' + ms % 10);
     }
+
+    prefix += QChar(']');
+    prefix += logTags[logType];
     return prefix;
 }
 //=======================================================================================================
+QDateTime Log::currentTime() const
+{
+    if (!_localTime) return QDateTime::currentDateTimeUtc();
+
+    const qint64 msecs = QDateTime::currentMSecsSinceEpoch();
+    LogTimeCache &cache = logTimeCache;
+    if (cache.utcSecond != msecs / 1000) {
+        cache.utcSecond = msecs / 1000;
+        cache.offset = QDateTime::fromMSecsSinceEpoch(msecs).offsetFromUtc();
+    }
+    return QDateTime::fromMSecsSinceEpoch(msecs, Qt::OffsetFromUTC, cache.offset);
+}
+//=======================================================================================================
 bool Log::write(LogType logType, const QString &text)
 {
-    if(!file.isOpen()) {
-        _lastError = tr("Лог-файл не открыт для записи.");
+    if(!isOpened()) {
+        setLastError(tr("Лог-файл не открыт для записи."));
         return false;
     }
 
-    QDateTime now = (startingTime.offsetFromUtc() != 0) ? QDateTime::currentDateTime() : QDateTime::currentDateTimeUtc();
-    QString prefix = getLogPrefix(logType, now);
-    QStringList sl = text.split("\n");
-    for(int i=0; i<sl.size(); i++) {
-        stream << prefix << QString(sl.at(i)) << "\n";
+    QDateTime now = currentTime();
+
+    if (_writer) {
+        // ошибка записи в потоке писателя проявляется на следующем вызове
+        if (!_writer->enqueue(logType, now, text)) return writeError();
+        return true;
     }
 
+    if (writeEntry(logType, now, text) < 0) return writeError();
     stream.flush();
     file.flush();
-    if (stream.status() != QTextStream::Ok) {
-        file.close();
-        _lastError = tr("Ошибка при записи в лог-файл.");
-        emit closeFile(logPath + logFile);
-        return false;
-    }
+    _fileSize = file.pos();
+    if (stream.status() != QTextStream::Ok) return writeError();
     return true;
 }
 //=======================================================================================================
+qint64 Log::writeLines(QTextStream &stream, LogType logType, const QDateTime &date, const QString &text)
+{
+    const QString prefix = getLogPrefix(logType, date);
+    if (!text.contains(QChar('\n'))) {
+        stream << prefix << text << QChar('\n');
+        return prefix.size() + text.size() + 1;
+    }
+
+    const QStringList sl = text.split("\n");
+    qint64 size = 0;
+    for(int i=0; i<sl.size(); i++) {
+        stream << prefix << sl.at(i) << QChar('\n');
+        size += prefix.size() + sl.at(i).size() + 1;
+    }
+    return size;
+}
+//=======================================================================================================
 QString Log::highlightLogString(LogFormat logFormat, QDateTime dateTime, LogType logType, const QString &text, bool darkBackground)
 {
     QString prefix = getLogPrefix(logType, dateTime);
@@ -223,82 +820,50 @@ QString Log::highlightLogString(LogFormat logFormat, LogType logType, const QStr
 //=======================================================================================================
 QString Log::highlightLog(LogFormat logFormat, const QString &logText, bool darkBackground)
 {
-    QString res = "";
-    QStringList strList = logText.split("\n");
-    if(strList.isEmpty()) return res;
-
-    QString preDate = "", prePrefix = "", preInf = "", preWrn = "", preErr = "", preIn = "", preOut = "",
-            preTxt = "", preDbg = "", preOther = "";
-    QString suffix = "", endLine = "\n";
-
-    if(logFormat == RichLog) {
-        endLine = "<br>";
-        suffix = "</font>";
-        preDate = "<font color=\"" + (darkBackground ? clLogDateDark : clLogDateLight) + "\">";
-        prePrefix = "<font color=\"" + (darkBackground ? clLogPrefixDark : clLogPrefixLight) + "\">";
-        preInf = "<font color=\"" + (darkBackground ? clLogInfDark : clLogInfLight) + "\">";
-        preWrn = "<font color=\"" + (darkBackground ? clLogWrnDark : clLogWrnLight) + "\">";
-        preErr = "<font color=\"" + (darkBackground ? clLogErrDark : clLogErrLight) + "\">";
-        preIn = "<font color=\"" + (darkBackground ? clLogInDark : clLogInLight) + "\">";
-        preOut = "<font color=\"" + (darkBackground ? clLogOutDark : clLogOutLight) + "\">";
-        preTxt = "<font color=\"" + (darkBackground ? clLogTxtDark : clLogTxtLight) + "\">";
-        preDbg = "<font color=\"" + (darkBackground ? clLogDbgDark : clLogDbgLight) + "\">";
-        preOther = "<font color=\"" + (darkBackground ? clLogOtherDark : clLogOtherLight) + "\">";
-    }
-    else if(logFormat == HtmlLog) {
-        endLine = "<br>";
-        suffix = "</span>";
-        preDate = "<span style=\"color: " + (darkBackground ? clLogDateDark : clLogDateLight) + ";\">";
-        prePrefix = "<span style=\"color: " + (darkBackground ? clLogPrefixDark : clLogPrefixLight) + ";\">";
-        preInf = "<span style=\"color: " + (darkBackground ? clLogInfDark : clLogInfLight) + ";\">";
-        preWrn = "<span style=\"color: " + (darkBackground ? clLogWrnDark : clLogWrnLight) + ";\">";
-        preErr = "<span style=\"color: " + (darkBackground ? clLogErrDark : clLogErrLight) + ";\">";
-        preIn = "<span style=\"color: " + (darkBackground ? clLogInDark : clLogInLight) + ";\">";
-        preOut = "<span style=\"color: " + (darkBackground ? clLogOutDark : clLogOutLight) + ";\">";
-        preTxt = "<span style=\"color: " + (darkBackground ? clLogTxtDark : clLogTxtLight) + ";\">";
-        preDbg = "<span style=\"color: " + (darkBackground ? clLogDbgDark : clLogDbgLight) + ";\">";
-        preOther = "<span style=\"color: " + (darkBackground ? clLogOtherDark : clLogOtherLight) + ";\">";
-    }
-
-    for(int i=0; i<strList.size(); ++i) {
-        QString str = strList.at(i);
-        QString dtStr = "", typeStr = "";
-        while( (str.length()>0) && ( (str.right(1) == "\n") || (str.right(1) == "\r") ) ) str.remove( str.length()-1, 1 );
-
-        if((str.length() > 20) && (str[0] == QChar('[')) && (str[13] == QChar(']')) &&
+    const LogStyle &style = logStyle(logFormat, darkBackground);
+    const bool escapeText = (logFormat == HtmlLog);
+    const bool escapeTag = (logFormat == RichLog) || (logFormat == HtmlLog);
+    const QChar *data = logText.constData();
+    const int size = logText.size();
+
+    QString res;
+    res.reserve( size + (logText.count(QChar('\n')) + 1) * style.lineOverhead );
+
+    // один проход по строкам без промежуточных списков и копий
+    int pos = 0;
+    for (;;) {
+        int end = logText.indexOf(QChar('\n'), pos);
+        if (end < 0) end = size;
+        const int next = end + 1;
+        while( (end > pos) && (data[end - 1] == QChar('\r')) ) --end;
+
+        const QChar *str = data + pos;
+        int len = end - pos;
+        LogType logType = LogOther;
+
+        if((len > 20) && (str[0] == QChar('[')) && (str[13] == QChar(']')) &&
                 (str[14] == QChar('[')) && (str[18] == QChar(']')) ) {
-            dtStr = str.left(14);
-            typeStr = str.mid(14, 5);
-            str.remove(0,19);
+            logType = logTagType(str + 15);
+            res += style.preDate;
+            appendLogText(res, str, 14, escapeText);
+            res += style.suffix;
+            res += style.prePrefix;
+            appendLogText(res, str + 14, 5, escapeTag);
+            res += style.suffix;
+            str += 19;
+            len -= 19;
         }
 
-        QString line = "";
-        if(!dtStr.isEmpty())
-            line += preDate + ((logFormat == HtmlLog) ? dtStr.toHtmlEscaped() : dtStr) + suffix;
-        if(!typeStr.isEmpty())
-            line += prePrefix + ((logFormat != PlainLog) ? typeStr.toHtmlEscaped() : typeStr) + suffix;
-
-        if(logFormat == HtmlLog) str = str.toHtmlEscaped();
-        if(str.isEmpty()) str = (logFormat == PlainLog) ? " " : "&nbsp;";
-
-        if(typeStr == "[inf]")
-            line += preInf + str + suffix;
-        else if(typeStr == "[wrn]")
-            line += preWrn + ((logFormat == PlainLog) ? "" : "<i>") + str + ((logFormat == PlainLog) ? "" : "</i>") + suffix;
-        else if(typeStr == "[err]")
-            line += preErr + ((logFormat == PlainLog) ? "" : "<b><i>") + str + ((logFormat == PlainLog) ? "" : "</i></b>") + suffix;
-        else if(typeStr == "[<<<]")
-            line += preIn + str + suffix;
-        else if(typeStr == "[>>>]")
-            line += preOut + str + suffix;
-        else if(typeStr == "[txt]")
-            line += preTxt + str + suffix;
-        else if(typeStr == "[dbg]")
-            line += preDbg + str + suffix;
-        else
-            line += preOther + str + suffix;
-
-        res += line + endLine;
+        res += style.pre[logType];
+        res += style.open[logType];
+        if (len > 0) appendLogText(res, str, len, escapeText);
+        else res += style.emptyText;
+        res += style.close[logType];
+        res += style.suffix;
+        res += style.endLine;
+
+        if (next > size) break;
+        pos = next;
     }
     return res;
 }
@@ -306,34 +871,117 @@ QString Log::highlightLog(LogFormat logFormat, const QString &logText, bool dark
 QString Log::readLog(LogFormat logFormat, const QString &fileName, bool darkBackground)
 {
     QString res;
-    QFile f(fileName);
-    if(!f.open(QIODevice::ReadOnly | QIODevice::Text)) return res;
+    LogReader reader;
+    if(!reader.open(fileName)) return res;
 
-    while(!f.atEnd()) {
+    res = reader.text(0, reader.lineCount());
+    reader.close();
 
-        QString str = QString(f.readLine());
-        while( (str.length()>0) && ( (str.right(1) == "\n") || (str.right(1) == "\r") ) ) str.remove( str.length()-1, 1 );
-        res += str + "\n";
-    }
-    f.close();
-
-    return highlightLog( logFormat, res, darkBackground);;
+    return highlightLog( logFormat, res, darkBackground);
 }
 //=======================================================================================================
 QStringList Log::logFiles(const QString &logDir)
 {
     QDir dir(logDir);
-    return dir.entryList(QStringList("*.log"), QDir::Files | QDir::NoSymLinks);
+    return dir.entryList(QStringList() << "*.log" << "*.log.gz", QDir::Files | QDir::NoSymLinks);
 }
 //=======================================================================================================
 QStringList Log::logFiles(const QString &rootLogDir, QDate date)
 {
-    QString d = QDir::toNativeSeparators(rootLogDir);
-    if(d.right(1) != QDir::separator()) d += QDir::separator();
-    d += date.toString("yyyy") + QDir::separator() +
-            date.toString("MM") + QDir::separator() +
-            date.toString("dd") + QDir::separator();
-    return logFiles(d);
+    return logFiles( logDayPath(rootLogDir, date) );
+}
+//=======================================================================================================
+// gzip (RFC 1952) поверх qCompress: из потока zlib берется блок deflate, CRC32 считается отдельно.
+// Заголовок zlib и adler32 сохраняются в доп. поле "Qz", длина блока deflate - в поле "Ql",
+// чтобы uncompressLog мог вернуть поток в qUncompress и найти следующий член gzip;
+// внешние утилиты (gzip, zcat) эти поля пропускают
+QByteArray Log::compressLog(const QByteArray &data)
+{
+    // qCompress: 4 байта длины (BE) + zlib: 2 байта заголовка, deflate, 4 байта adler32
+    const QByteArray z = qCompress(data);
+    QByteArray zHeader("\x78\x9c", 2), deflate("\x03\x00", 2), adler("\x00\x00\x00\x01", 4);
+    if (!data.isEmpty()) {
+        if (z.size() < 10) return QByteArray();
+        zHeader = z.mid(4, 2);
+        deflate = z.mid(6, z.size() - 10);
+        adler = z.right(4);
+    }
+
+    const quint32 crc = Crc32_IsoHdlc::calc(data);
+    const quint32 size = static_cast<quint32>(data.size());
+    const quint32 deflateSize = static_cast<quint32>(deflate.size());
+
+    QByteArray res;
+    res.reserve(deflate.size() + 38);
+    res.append("\x1f\x8b\x08\x04", 4);      // ID1 ID2 CM=deflate FLG=FEXTRA
+    res.append("\x00\x00\x00\x00\x00\xff", 6);  // MTIME XFL OS
+    res.append("\x12\x00" "Qz" "\x06\x00", 6);     // XLEN, подполе "Qz" длиной 6
+    res.append(zHeader);
+    res.append(adler);
+    res.append("Ql" "\x04\x00", 4);                // подполе "Ql" длиной 4
+    for (int i = 0; i < 4; ++i) res.append( static_cast<char>((deflateSize >> (8 * i)) & 0xFF) );
+    res.append(deflate);
+    for (int i = 0; i < 4; ++i) res.append( static_cast<char>((crc >> (8 * i)) & 0xFF) );
+    for (int i = 0; i < 4; ++i) res.append( static_cast<char>((size >> (8 * i)) & 0xFF) );
+    return res;
+}
+//=======================================================================================================
+QByteArray Log::uncompressLog(const QByteArray &data)
+{
+    // члены gzip подряд (сжатие при ротации кусками); без поля "Ql" член должен быть последним
+    QByteArray res;
+    int member = 0;
+    do {
+        const uchar *p = reinterpret_cast<const uchar*>(data.constData()) + member;
+        const int left = data.size() - member;
+        if ((left < 18) || (p[0] != 0x1f) || (p[1] != 0x8b) || (p[2] != 8) || !(p[3] & 0x04))
+            return QByteArray();
+
+        // поиск подполей "Qz" и "Ql" в FEXTRA
+        const int xlen = p[10] | (p[11] << 8);
+        int pos = 12;
+        const int extraEnd = pos + xlen;
+        QByteArray zHeader, adler;
+        qint64 deflateSize = -1;
+        while ((pos + 4 <= extraEnd) && (extraEnd <= left)) {
+            const int len = p[pos + 2] | (p[pos + 3] << 8);
+            if ((p[pos] == 'Q') && (p[pos + 1] == 'z') && (len == 6)) {
+                zHeader = data.mid(member + pos + 4, 2);
+                adler = data.mid(member + pos + 6, 4);
+            }
+            else if ((p[pos] == 'Q') && (p[pos + 1] == 'l') && (len == 4) && (pos + 8 <= extraEnd)) {
+                deflateSize = static_cast<qint64>(p[pos + 4] | (p[pos + 5] << 8) | (p[pos + 6] << 16))
+                        | (static_cast<qint64>(p[pos + 7]) << 24);
+            }
+            pos += 4 + len;
+        }
+        if (adler.size() != 4) return QByteArray();
+
+        pos = extraEnd;
+        if (p[3] & 0x08) pos = data.indexOf('\0', member + pos) + 1 - member;   // FNAME
+        if (p[3] & 0x10) pos = data.indexOf('\0', member + pos) + 1 - member;   // FCOMMENT
+        if (p[3] & 0x02) pos += 2;                                             // FHCRC
+        if ((pos <= 0) || (pos > left - 8)) return QByteArray();
+        if (deflateSize < 0) deflateSize = left - 8 - pos;
+        if (deflateSize > left - 8 - pos) return QByteArray();
+
+        const int tail = pos + static_cast<int>(deflateSize);
+        const quint32 crc = static_cast<quint32>(p[tail] | (p[tail + 1] << 8) | (p[tail + 2] << 16)) | (static_cast<quint32>(p[tail + 3]) << 24);
+        const quint32 size = static_cast<quint32>(p[tail + 4] | (p[tail + 5] << 8) | (p[tail + 6] << 16)) | (static_cast<quint32>(p[tail + 7]) << 24);
+
+        QByteArray z;
+        z.reserve(tail - pos + 10);
+        for (int i = 3; i >= 0; --i) z.append( static_cast<char>((size >> (8 * i)) & 0xFF) );
+        z.append(zHeader);
+        z.append(data.constData() + member + pos, tail - pos);
+        z.append(adler);
+
+        const QByteArray part = (size == 0) ? QByteArray() : qUncompress(z);
+        if ((static_cast<quint32>(part.size()) != size) || (Crc32_IsoHdlc::calc(part) != crc)) return QByteArray();
+        res.append(part);
+        member += tail + 8;
+    } while (member < data.size());
+    return res;
 }
 //=======================================================================================================
 void Log::onLog(LogType logType, QString text)
@@ -342,4 +990,652 @@ void Log::onLog(LogType logType, QString text)
     write(logType, text);
 }
 //=======================================================================================================
+LogReader::LogReader(const QString &fileName)
+{
+    if(!fileName.isEmpty()) open(fileName);
+}
+//=======================================================================================================
+LogReader::~LogReader()
+{
+    close();
+}
+//=======================================================================================================
+bool LogReader::open(const QString &fileName)
+{
+    close();
+
+    if (fileName.endsWith(".gz", Qt::CaseInsensitive)) {
+        // архив ротации распаковывается в память целиком, его размер ограничен порогом ротации
+        QFile f(fileName);
+        if(!f.open(QIODevice::ReadOnly)) {
+            _lastError = QObject::tr("Не удалось открыть лог-файл.");
+            return false;
+        }
+        const QByteArray data = f.readAll();
+        f.close();
+        _buffer = Log::uncompressLog(data);
+        // пустой архив (ISIZE = 0) - не ошибка
+        if (_buffer.isEmpty() && (data.right(4) != QByteArray(4, '\0'))) {
+            _lastError = QObject::tr("Не удалось распаковать лог-файл.");
+            return false;
+        }
+        _data = _buffer.constData();
+        _size = _buffer.size();
+    }
+    else {
+        _file.setFileName(fileName);
+        if(!_file.open(QIODevice::ReadOnly)) {
+            _lastError = QObject::tr("Не удалось открыть лог-файл.");
+            return false;
+        }
+        if (!mapFile()) {
+            _file.close();
+            return false;
+        }
+    }
+
+    // двоичный лог читается как текст после преобразования в памяти
+    if (LogBinaryReader::isBinaryLog(_data, _size)) {
+        _buffer = LogBinaryReader::toText( QByteArray(_data, static_cast<int>(_size)) );
+        if (_map) _file.unmap(_map);
+        _file.close();
+        _map = nullptr;
+        _data = _buffer.constData();
+        _size = _buffer.size();
+    }
+
+    _open = true;
+    buildIndex(0);
+    return true;
+}
+//=======================================================================================================
+void LogReader::close()
+{
+    if (_map) _file.unmap(_map);
+    if (_file.isOpen()) _file.close();
+    _buffer.clear();
+    _map = nullptr;
+    _data = nullptr;
+    _size = 0;
+    _lineCount = 0;
+    _lastStart = 0;
+    _index.clear();
+    _open = false;
+}
+//=======================================================================================================
+bool LogReader::refresh()
+{
+    // файл мог быть дописан (или начат заново) пишущим процессом
+    if (!_file.isOpen()) return _open;
+
+    const qint64 oldSize = _size;
+    if (_file.size() == oldSize) return true;
+    if (!mapFile()) {
+        close();
+        return false;
+    }
+    buildIndex( (_size > oldSize) ? oldSize : 0 );
+    return true;
+}
+//=======================================================================================================
+bool LogReader::mapFile()
+{
+    if (_map) _file.unmap(_map);
+    _map = nullptr;
+    _data = nullptr;
+    _size = _file.size();
+    if (_size == 0) return true;
+
+    _map = _file.map(0, _size);
+    if (!_map) {
+        _lastError = QObject::tr("Не удалось отобразить лог-файл в память.");
+        _size = 0;
+        return false;
+    }
+    _data = reinterpret_cast<const char*>(_map);
+    return true;
+}
+//=======================================================================================================
+void LogReader::buildIndex(qint64 from)
+{
+    if (from == 0) {
+        _index.clear();
+        _index.append(0);
+        _lineCount = 0;
+        _lastStart = 0;
+    }
+
+    const char *p = _data + from;
+    const char *end = _data + _size;
+    while (p < end) {
+        const char *nl = static_cast<const char*>( memchr(p, '\n', static_cast<size_t>(end - p)) );
+        if (!nl) break;
+        p = nl + 1;
+        ++_lineCount;
+        _lastStart = p - _data;
+        if ((_lineCount % IndexStep) == 0) _index.append(_lastStart);
+    }
+}
+//=======================================================================================================
+qint64 LogReader::lineStart(qint64 index) const
+{
+    // ближайшая точка индекса и не более IndexStep-1 строк вперед
+    qint64 pos = _index.at( static_cast<int>(index / IndexStep) );
+    for (qint64 i = index % IndexStep; i > 0; --i) pos = lineEnd(pos) + 1;
+    return pos;
+}
+//=======================================================================================================
+qint64 LogReader::lineEnd(qint64 start) const
+{
+    const void *nl = memchr(_data + start, '\n', static_cast<size_t>(_size - start));
+    return nl ? static_cast<const char*>(nl) - _data : _size;
+}
+//=======================================================================================================
+QString LogReader::line(qint64 index) const
+{
+    const QStringList sl = lines(index, 1);
+    return sl.isEmpty() ? QString() : sl.first();
+}
+//=======================================================================================================
+QStringList LogReader::lines(qint64 first, qint64 count) const
+{
+    QStringList res;
+    if (first < 0) {
+        count += first;
+        first = 0;
+    }
+    count = qMin(count, lineCount() - first);
+    if (count <= 0) return res;
+
+    res.reserve( static_cast<int>(count) );
+    qint64 pos = lineStart(first);
+    for (qint64 i = 0; i < count; ++i) {
+        const qint64 end = lineEnd(pos);
+        qint64 len = end - pos;
+        while ((len > 0) && (_data[pos + len - 1] == '\r')) --len;
+        res.append( QString::fromUtf8(_data + pos, static_cast<int>(len)) );
+        pos = end + 1;
+    }
+    return res;
+}
+//=======================================================================================================
+QString LogReader::text(qint64 first, qint64 count) const
+{
+    // строки диапазона, каждая с "\n" в конце
+    const QStringList sl = lines(first, count);
+    int size = 0;
+    for (const QString &str: sl) size += str.size() + 1;
+
+    QString res;
+    res.reserve(size);
+    for (const QString &str: sl) {
+        res += str;
+        res += QChar('\n');
+    }
+    return res;
+}
+//=======================================================================================================
+QString LogReader::readLog(LogFormat logFormat, qint64 first, qint64 count, bool darkBackground) const
+{
+    const QStringList sl = lines(first, count);
+    if (sl.isEmpty()) return QString();
+    return Log::highlightLog(logFormat, sl.join("\n"), darkBackground);
+}
+//=======================================================================================================
+/*  LogIndex ========================================================================================== */
+
+const quint32 LogIndexMagic       = 0x4E4C4958; // "NLIX"
+const quint16 LogIndexVersion     = 1;
+const quint32 LogMsecsPerDay      = 86400000;
+const qint64 LogIndexReadChunk    = 4 * 1024 * 1024;
+
+// сводка по блоку из LogIndex::BlockLines строк; время - мсек от начала суток файла
+struct LogIndexBlock
+{
+    qint64 offset;
+    quint32 firstLine;
+    quint32 minTime;
+    quint32 maxTime;
+    quint8 types;
+};
+
+struct LogIndexData
+{
+    qint64 fileSize {0};        // размер файла на диске при последнем обновлении
+    qint64 sourceSize {0};      // проиндексировано байт (до конца последней полной строки)
+    qint64 lineCount {0};
+    qint64 dayStart {0};        // юлианский день, от которого отсчитывается время
+    quint32 lastTime {0};
+    QVector<LogIndexBlock> blocks;
+};
+//=======================================================================================================
+// разбор префикса "[HH:mm:ss.zzz][xxx]"; false - строка без префикса (LogOther без времени)
+static bool parseLogLine(const char *s, qint64 len, quint32 &time, LogType &logType)
+{
+    static const char tags[][4] = { "inf", "wrn", "err", "<<<", ">>>", "txt", "dbg" };
+    static const int digits[] = { 1, 2, 4, 5, 7, 8, 10, 11, 12 };
+
+    if ((len < 19) || (s[0] != '[') || (s[13] != ']') || (s[14] != '[') || (s[18] != ']')) return false;
+    if ((s[3] != ':') || (s[6] != ':') || (s[9] != '.')) return false;
+    for (int i: digits) {
+        if ((s[i] < '0') || (s[i] > '9')) return false;
+    }
+
+    const quint32 h = static_cast<quint32>((s[1] - '0') * 10 + (s[2] - '0'));
+    const quint32 m = static_cast<quint32>((s[4] - '0') * 10 + (s[5] - '0'));
+    const quint32 sec = static_cast<quint32>((s[7] - '0') * 10 + (s[8] - '0'));
+    const quint32 ms = static_cast<quint32>((s[10] - '0') * 100 + (s[11] - '0') * 10 + (s[12] - '0'));
+    time = ((h * 60 + m) * 60 + sec) * 1000 + ms;
+
+    logType = LogOther;
+    for (int i = LogInfo; i < LogOther; ++i) {
+        if (memcmp(s + 15, tags[i], 3) == 0) {
+            logType = static_cast<LogType>(i);
+            break;
+        }
+    }
+    return true;
+}
+//=======================================================================================================
+// время строки от начала суток файла: переход через полночь - шаг назад больше чем на 12 часов
+static quint32 logLineTime(quint32 lastTime, quint32 time)
+{
+    quint32 res = (lastTime / LogMsecsPerDay) * LogMsecsPerDay + time;
+    if (res + LogMsecsPerDay / 2 < lastTime) res += LogMsecsPerDay;
+    return res;
+}
+//=======================================================================================================
+// индексация полных строк буфера; возвращает число обработанных байт
+static qint64 indexLogLines(const char *data, qint64 size, qint64 baseOffset, LogIndexData &idx)
+{
+    qint64 pos = 0;
+    for (;;) {
+        const char *nl = static_cast<const char*>( memchr(data + pos, '\n', static_cast<size_t>(size - pos)) );
+        if (!nl) break;
+        const qint64 end = nl - data;
+
+        quint32 time = 0;
+        LogType logType = LogOther;
+        if (parseLogLine(data + pos, end - pos, time, logType)) idx.lastTime = logLineTime(idx.lastTime, time);
+        time = idx.lastTime;
+
+        if ((idx.lineCount % LogIndex::BlockLines) == 0) {
+            idx.blocks.append( LogIndexBlock { baseOffset + pos, static_cast<quint32>(idx.lineCount), time, time, 0 } );
+        }
+        LogIndexBlock &block = idx.blocks.last();
+        block.minTime = qMin(block.minTime, time);
+        block.maxTime = qMax(block.maxTime, time);
+        block.types |= static_cast<quint8>(1 << logType);
+
+        ++idx.lineCount;
+        pos = end + 1;
+    }
+    return pos;
+}
+//=======================================================================================================
+// дата файла - из пути yyyy/MM/dd, для файлов вне дерева логов - дата изменения
+static QDate logFileDate(const QString &fileName)
+{
+    const QRegularExpression re("(\\d{4})[\\\\/](\\d{2})[\\\\/](\\d{2})[\\\\/][^\\\\/]+$");
+    const QRegularExpressionMatch match = re.match( QDir::fromNativeSeparators(fileName) );
+    if (match.hasMatch()) {
+        const QDate date(match.captured(1).toInt(), match.captured(2).toInt(), match.captured(3).toInt());
+        if (date.isValid()) return date;
+    }
+    return QFileInfo(fileName).lastModified().date();
+}
+//=======================================================================================================
+static bool readLogIndex(const QString &fileName, LogIndexData &idx)
+{
+    QFile f( LogIndex::indexFileName(fileName) );
+    if (!f.open(QIODevice::ReadOnly)) return false;
+
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0, blockCount = 0;
+    quint16 version = 0;
+    in >> magic >> version;
+    if ((magic != LogIndexMagic) || (version != LogIndexVersion)) return false;
+    in >> idx.fileSize >> idx.sourceSize >> idx.lineCount >> idx.dayStart >> idx.lastTime >> blockCount;
+    if ((in.status() != QDataStream::Ok) || (blockCount > static_cast<quint32>(idx.lineCount / LogIndex::BlockLines + 1)))
+        return false;
+
+    idx.blocks.resize( static_cast<int>(blockCount) );
+    for (LogIndexBlock &block: idx.blocks) {
+        in >> block.offset >> block.firstLine >> block.minTime >> block.maxTime >> block.types;
+    }
+    return in.status() == QDataStream::Ok;
+}
+//=======================================================================================================
+static bool writeLogIndex(const QString &fileName, const LogIndexData &idx)
+{
+    QSaveFile f( LogIndex::indexFileName(fileName) );
+    if (!f.open(QIODevice::WriteOnly)) return false;
+
+    QDataStream out(&f);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << LogIndexMagic << LogIndexVersion << idx.fileSize << idx.sourceSize << idx.lineCount
+        << idx.dayStart << idx.lastTime << static_cast<quint32>(idx.blocks.size());
+    for (const LogIndexBlock &block: idx.blocks) {
+        out << block.offset << block.firstLine << block.minTime << block.maxTime << block.types;
+    }
+    return (out.status() == QDataStream::Ok) && f.commit();
+}
+//=======================================================================================================
+static bool readLogArchive(const QString &fileName, QByteArray &data)
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly)) return false;
+    data = Log::uncompressLog(f.readAll());
+    return true;
+}
+//=======================================================================================================
+static bool updateLogIndex(const QString &fileName, LogIndexData &idx)
+{
+    const QFileInfo info(fileName);
+    if (!info.exists()) return false;
+    const bool archive = fileName.endsWith(".gz", Qt::CaseInsensitive);
+
+    const bool loaded = readLogIndex(fileName, idx);
+    if (loaded && (idx.fileSize == info.size())) return true;
+    if (!loaded || archive || (info.size() < idx.fileSize)) {
+        idx = LogIndexData();
+        idx.dayStart = logFileDate(fileName).toJulianDay();
+    }
+    else if ((idx.lineCount % LogIndex::BlockLines) != 0) {
+        // незаполненный последний блок индексируется заново
+        const LogIndexBlock block = idx.blocks.takeLast();
+        idx.sourceSize = block.offset;
+        idx.lineCount = block.firstLine;
+        idx.lastTime = idx.blocks.isEmpty() ? block.minTime : idx.blocks.last().maxTime;
+    }
+
+    if (archive) {
+        QByteArray data;
+        if (!readLogArchive(fileName, data)) return false;
+        idx.sourceSize = indexLogLines(data.constData(), data.size(), 0, idx);
+    }
+    else {
+        QFile f(fileName);
+        if (!f.open(QIODevice::ReadOnly) || !f.seek(idx.sourceSize)) return false;
+        // читается кусками, неполная строка в конце куска переносится в следующий
+        QByteArray buf;
+        while (!f.atEnd()) {
+            const QByteArray chunk = f.read(LogIndexReadChunk);
+            if (chunk.isEmpty()) break;
+            buf += chunk;
+            const qint64 done = indexLogLines(buf.constData(), buf.size(), idx.sourceSize, idx);
+            idx.sourceSize += done;
+            buf.remove(0, static_cast<int>(done));
+        }
+    }
+
+    idx.fileSize = info.size();
+    writeLogIndex(fileName, idx);   // индекс только ускоряет поиск, ошибка записи не мешает ответу
+    return true;
+}
+//=======================================================================================================
+bool LogIndex::update(const QString &fileName)
+{
+    LogIndexData idx;
+    return updateLogIndex(fileName, idx);
+}
+//=======================================================================================================
+QVector<LogRecord> LogIndex::searchFile(const QString &fileName, const QDateTime &from, const QDateTime &to, int typeMask)
+{
+    QVector<LogRecord> res;
+    LogIndexData idx;
+    if (!updateLogIndex(fileName, idx) || idx.blocks.isEmpty()) return res;
+
+    // границы запроса во времени файла
+    const qint64 fromTime = (from.date().toJulianDay() - idx.dayStart) * LogMsecsPerDay + from.time().msecsSinceStartOfDay();
+    const qint64 toTime = (to.date().toJulianDay() - idx.dayStart) * LogMsecsPerDay + to.time().msecsSinceStartOfDay();
+    if (toTime < fromTime) return res;
+
+    QByteArray archive;
+    QFile f(fileName);
+    if (fileName.endsWith(".gz", Qt::CaseInsensitive)) {
+        if (!readLogArchive(fileName, archive)) return res;
+    }
+    else if (!f.open(QIODevice::ReadOnly)) {
+        return res;
+    }
+
+    const int count = idx.blocks.size();
+    for (int i = 0; i < count; ++i) {
+        const LogIndexBlock &block = idx.blocks.at(i);
+        if (!(block.types & typeMask) || (block.maxTime < fromTime) || (block.minTime > toTime)) continue;
+
+        // подряд идущие подходящие блоки читаются одним куском
+        int last = i;
+        while ((last + 1 < count) && (idx.blocks.at(last + 1).types & typeMask)
+               && (idx.blocks.at(last + 1).maxTime >= fromTime) && (idx.blocks.at(last + 1).minTime <= toTime)) ++last;
+        const qint64 begin = block.offset;
+        const qint64 end = (last + 1 < count) ? idx.blocks.at(last + 1).offset : idx.sourceSize;
+
+        QByteArray chunk;
+        if (!archive.isEmpty()) chunk = archive.mid( static_cast<int>(begin), static_cast<int>(end - begin) );
+        else if (f.seek(begin)) chunk = f.read(end - begin);
+
+        const char *data = chunk.constData();
+        const qint64 size = chunk.size();
+        quint32 lastTime = block.minTime;
+        qint64 line = block.firstLine;
+        qint64 pos = 0;
+        while (pos < size) {
+            const char *nl = static_cast<const char*>( memchr(data + pos, '\n', static_cast<size_t>(size - pos)) );
+            qint64 lineEnd = nl ? (nl - data) : size;
+            const qint64 next = lineEnd + 1;
+            while ((lineEnd > pos) && (data[lineEnd - 1] == '\r')) --lineEnd;
+
+            quint32 time = 0;
+            LogType logType = LogOther;
+            const bool prefix = parseLogLine(data + pos, lineEnd - pos, time, logType);
+            if (prefix) lastTime = logLineTime(lastTime, time);
+
+            if ((typeMask & (1 << logType)) && (lastTime >= fromTime) && (lastTime <= toTime)) {
+                const qint64 textStart = prefix ? qMin(pos + 20, lineEnd) : pos;
+                res.append( LogRecord {
+                    QDateTime( QDate::fromJulianDay(idx.dayStart + lastTime / LogMsecsPerDay),
+                               QTime::fromMSecsSinceStartOfDay(static_cast<int>(lastTime % LogMsecsPerDay)) ),
+                    logType,
+                    QString::fromUtf8(data + textStart, static_cast<int>(lineEnd - textStart)),
+                    fileName,
+                    line } );
+            }
+            ++line;
+            pos = next;
+        }
+        i = last;
+    }
+    return res;
+}
+//=======================================================================================================
+QVector<LogRecord> LogIndex::search(const QString &rootLogDir, const QDateTime &from, const QDateTime &to,
+                                    int typeMask, int threadCount)
+{
+    QVector<LogRecord> res;
+    if (!from.isValid() || !to.isValid() || (to < from)) return res;
+
+    // каталоги суток из диапазона и предыдущих суток (файл без ротации по суткам переходит через полночь);
+    // несжатый файл имеет приоритет над своим архивом, пока архив не дописан
+    QStringList files;
+    for (QDate date = from.date().addDays(-1); date <= to.date(); date = date.addDays(1)) {
+        const QString path = logDayPath(rootLogDir, date);
+        const QStringList names = Log::logFiles(path);
+        for (const QString &name: names) {
+            if (name.endsWith(".gz") && names.contains(name.left(name.size() - 3))) continue;
+            files.append(path + name);
+        }
+    }
+
+    QVector< QVector<LogRecord> > found(files.size());
+    QAtomicInt next(0);
+    const std::function<void()> worker = [&]() {
+        for (int i = next.fetchAndAddOrdered(1); i < files.size(); i = next.fetchAndAddOrdered(1))
+            found[i] = searchFile(files.at(i), from, to, typeMask);
+    };
+
+    if (threadCount <= 0) threadCount = parallelThreadCount();
+    parallelFor( qMin(threadCount, files.size()), [&worker](int) { worker(); } );
+
+    int total = 0;
+    for (const QVector<LogRecord> &records: found) total += records.size();
+    res.reserve(total);
+    for (const QVector<LogRecord> &records: found) res += records;
+
+    std::stable_sort(res.begin(), res.end(), [](const LogRecord &a, const LogRecord &b) {
+        if (a.date.date() != b.date.date()) return a.date.date() < b.date.date();
+        return a.date.time() < b.date.time();
+    });
+    return res;
+}
+//=======================================================================================================
+/*  LogBinaryReader =================================================================================== */
+
+LogBinaryReader::LogBinaryReader(const QByteArray &data)
+{
+    if (!data.isEmpty()) setData(data);
+}
+//=======================================================================================================
+LogBinaryReader::~LogBinaryReader()
+{
+    close();
+}
+//=======================================================================================================
+bool LogBinaryReader::open(const QString &fileName)
+{
+    close();
+
+    if (fileName.endsWith(".gz", Qt::CaseInsensitive)) {
+        QFile f(fileName);
+        if (!f.open(QIODevice::ReadOnly)) return false;
+        setData( Log::uncompressLog(f.readAll()) );
+        return _valid;
+    }
+
+    _file.setFileName(fileName);
+    if (!_file.open(QIODevice::ReadOnly)) return false;
+    _size = _file.size();
+    _map = (_size > 0) ? _file.map(0, _size) : nullptr;
+    if (!_map) {
+        close();
+        return false;
+    }
+    _data = reinterpret_cast<const char*>(_map);
+    reset();
+    return _valid;
+}
+//=======================================================================================================
+void LogBinaryReader::setData(const QByteArray &data)
+{
+    close();
+    _buffer = data;
+    _data = _buffer.constData();
+    _size = _buffer.size();
+    reset();
+}
+//=======================================================================================================
+void LogBinaryReader::close()
+{
+    if (_map) _file.unmap(_map);
+    if (_file.isOpen()) _file.close();
+    _map = nullptr;
+    _buffer.clear();
+    _data = nullptr;
+    _size = 0;
+    _pos = 0;
+    _valid = false;
+}
+//=======================================================================================================
+void LogBinaryReader::reset()
+{
+    _valid = isBinaryLog(_data, _size);
+    _localTime = _valid && (_data[5] & 1);
+    _pos = 6;
+    _time = 0;
+    _logType = LogOther;
+    _payloadPos = 0;
+    _payloadSize = 0;
+}
+//=======================================================================================================
+bool LogBinaryReader::next(int typeMask)
+{
+    // приращение времени декодируется у каждой записи, текст - только по запросу
+    while (_valid && (_pos < _size)) {
+        quint64 delta = 0, size = 0;
+        if (!getLogVarint(_data, _size, _pos, delta) || (_pos >= _size)) break;
+        const quint8 logType = static_cast<quint8>(_data[_pos++]);
+        if (!getLogVarint(_data, _size, _pos, size) || (size > static_cast<quint64>(_size - _pos))) break;
+
+        _time += static_cast<qint64>(delta >> 1) ^ -static_cast<qint64>(delta & 1);
+        _logType = (logType < LogOther) ? static_cast<LogType>(logType) : LogOther;
+        _payloadPos = _pos;
+        _payloadSize = static_cast<int>(size);
+        _pos += static_cast<qint64>(size);
+        if (typeMask & (1 << _logType)) return true;
+    }
+    _pos = _size;
+    return false;
+}
+//=======================================================================================================
+QDateTime LogBinaryReader::date() const
+{
+    const qint64 day = (_time >= 0) ? _time / 86400000 : (_time - 86399999) / 86400000;
+    return QDateTime( QDate::fromJulianDay(LogUnixEpochDay + day),
+                      QTime::fromMSecsSinceStartOfDay(static_cast<int>(_time - day * 86400000)),
+                      _localTime ? Qt::LocalTime : Qt::UTC );
+}
+//=======================================================================================================
+QByteArray LogBinaryReader::payload() const
+{
+    return QByteArray(_data + _payloadPos, _payloadSize);
+}
+//=======================================================================================================
+QString LogBinaryReader::text() const
+{
+    return QString::fromUtf8(_data + _payloadPos, _payloadSize);
+}
+//=======================================================================================================
+bool LogBinaryReader::isBinaryLog(const char *data, qint64 size)
+{
+    return (size >= 6) && (memcmp(data, "NLOG", 4) == 0) && (data[4] == LogBinaryVersion);
+}
+//=======================================================================================================
+QByteArray LogBinaryReader::toText(const QByteArray &data)
+{
+    // тот же текст, что записал бы Log в формате PlainLog
+    LogBinaryReader reader(data);
+    QByteArray res;
+    if (!reader.isValid()) return res;
+    res.reserve(data.size() * 2);
+
+    QString lines;
+    QTextStream stream(&lines, QIODevice::WriteOnly);
+    while (reader.next()) {
+        Log::writeLines(stream, reader.logType(), reader.date(), reader.text());
+        if (lines.size() >= 64 * 1024) {
+            stream.flush();
+            res += lines.toUtf8();
+            lines.clear();
+        }
+    }
+    stream.flush();
+    res += lines.toUtf8();
+    return res;
+}
+//=======================================================================================================
+bool LogBinaryReader::convertToText(const QString &fileName, const QString &textFileName)
+{
+    LogBinaryReader reader;
+    if (!reader.open(fileName)) return false;
+
+    QFile f(textFileName);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+    QTextStream stream(&f);     // кодировка - как у QTextStream в Log
+    while (reader.next()) Log::writeLines(stream, reader.logType(), reader.date(), reader.text());
+    stream.flush();
+    return stream.status() == QTextStream::Ok;
+}
+//=======================================================================================================
 } // namespace nayk
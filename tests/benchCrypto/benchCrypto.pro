@@ -0,0 +1,20 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath c++14
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_benchcrypto.cpp
+
+INCLUDEPATH *= $${PWD}/../../inc \
+        $${PWD}/../../src \
+        $${PWD}/..
+
+HEADERS *= $${PWD}/../bench_args.h \
+           $${PWD}/../../inc/crc.h \
+           $${PWD}/../../inc/crypto.h \
+           $${PWD}/../../inc/parallel.h
+
+SOURCES *= $${PWD}/../../src/crypto.cpp
@@ -0,0 +1,287 @@
+#include <QtTest>
+#include <QByteArray>
+#include <random>
+#include "crypto.h"
+#include "bench_args.h"
+
+using namespace nayk;
+
+/*
+  Замеры производительности Crypto: AES (все CryptoAlg) и все варианты CRC
+  на данных 16 Б, 1 КБ, 64 КБ, 16 МБ; короткие сообщения с ключом на вызов и с привязанным ключом,
+  параллельный ECB по числу потоков, MD5 поштучно и пакетом.
+  По умолчанию результат выводится в CSV (одна строка на замер, тег строки - "алгоритм/байт"):
+      ./benchCrypto > bench.csv
+  Любой ключ формата QTest (-txt, -xml, -o файл,формат ...) отменяет CSV по умолчанию.
+*/
+//==================================================================================================
+class benchCrypto : public QObject
+{
+    Q_OBJECT
+
+public:
+    benchCrypto();
+    ~benchCrypto();
+
+private:
+    QByteArray _data;
+    void addCipherRows();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    //
+    void bench_encrypt_data();
+    void bench_encrypt();
+    void bench_decrypt_data();
+    void bench_decrypt();
+    void bench_crc_data();
+    void bench_crc();
+    void bench_smallMessages_data();
+    void bench_smallMessages();
+    void bench_parallel_data();
+    void bench_parallel();
+    void bench_md5_data();
+    void bench_md5();
+};
+//==================================================================================================
+typedef quint32 (*CrcFunc)(const quint8 *data, qint32 size);
+
+struct CrcVariant
+{
+    const char *name;
+    CrcFunc func;
+};
+
+const CrcVariant crcVariants[] = {
+    { "crc8_Dallas",  [](const quint8 *data, qint32 size) -> quint32 { return Crypto::crc8_Dallas(data, size); } },
+    { "crc8",         [](const quint8 *data, qint32 size) -> quint32 { return Crypto::crc8(data, size); } },
+    { "crc16_Ccitt",  [](const quint8 *data, qint32 size) -> quint32 { return Crypto::crc16_Ccitt(data, size); } },
+    { "crc16",        [](const quint8 *data, qint32 size) -> quint32 { return Crypto::crc16(data, size); } },
+    { "crc16_Arc",    [](const quint8 *data, qint32 size) -> quint32 { return Crypto::crc16_Arc(data, size); } },
+    { "crc16_Wmbus",  [](const quint8 *data, qint32 size) -> quint32 { return Crypto::crc16_Wmbus(data, size); } },
+    { "crc16_Modbus", [](const quint8 *data, qint32 size) -> quint32 { return Crypto::crc16_Modbus(data, size); } },
+    { "crc32",        [](const quint8 *data, qint32 size) -> quint32 { return Crypto::crc32(data, size); } },
+    { "crc32C",       [](const quint8 *data, qint32 size) -> quint32 { return Crypto::crc32C(data, size); } }
+};
+
+const QList<int> benchSizes { 16, 1024, 64 * 1024, 16 * 1024 * 1024 };
+//==================================================================================================
+benchCrypto::benchCrypto()
+{
+
+}
+//==================================================================================================
+benchCrypto::~benchCrypto()
+{
+
+}
+//==================================================================================================
+void benchCrypto::addCipherRows()
+{
+    QTest::addColumn<int>("alg");
+    QTest::addColumn<int>("size");
+
+    const QList<QPair<CryptoAlg, QString>> algs {
+        { CryptoAlg_TexasAES128, "TexasAES128" },
+        { CryptoAlg_TexasAES128_Compact, "TexasAES128_Compact" },
+        { CryptoAlg_AES128_CTR, "AES128_CTR" },
+        { CryptoAlg_AES128_CTR_HMAC, "AES128_CTR_HMAC" }
+    };
+    for (const QPair<CryptoAlg, QString> &alg: algs) {
+        for (int size: benchSizes) {
+            QTest::newRow( qPrintable(QString("%1/%2").arg(alg.second).arg(size)) )
+                    << static_cast<int>(alg.first) << size;
+        }
+    }
+}
+//==================================================================================================
+void benchCrypto::initTestCase()
+{
+    std::mt19937 random(1);
+    _data.resize( benchSizes.last() );
+    for (int i=0; i<_data.size(); ++i) _data[i] = static_cast<char>( random() & 0xFF );
+}
+//==================================================================================================
+void benchCrypto::cleanupTestCase()
+{
+
+}
+//==================================================================================================
+void benchCrypto::bench_encrypt_data()
+{
+    addCipherRows();
+}
+//==================================================================================================
+void benchCrypto::bench_encrypt()
+{
+    QFETCH(int, alg);
+    QFETCH(int, size);
+
+    // ключ привязан заранее: замеряется только шифрование
+    Crypto crypto( static_cast<CryptoAlg>(alg) );
+    QVERIFY( crypto.bindKey("benchmark") );
+    QByteArray out( static_cast<int>( Crypto::encryptedSize(size, crypto.algorythm()) ), 0 );
+    const quint8 *in = reinterpret_cast<const quint8*>( _data.constData() );
+    quint8 *outPtr = reinterpret_cast<quint8*>( out.data() );
+
+    QBENCHMARK { crypto.encryptBound(in, size, outPtr); }
+}
+//==================================================================================================
+void benchCrypto::bench_decrypt_data()
+{
+    addCipherRows();
+}
+//==================================================================================================
+void benchCrypto::bench_decrypt()
+{
+    QFETCH(int, alg);
+    QFETCH(int, size);
+
+    Crypto crypto( static_cast<CryptoAlg>(alg) );
+    QVERIFY( crypto.bindKey("benchmark") );
+    QByteArray encrypted( static_cast<int>( Crypto::encryptedSize(size, crypto.algorythm()) ), 0 );
+    QVERIFY( crypto.encryptBound(reinterpret_cast<const quint8*>( _data.constData() ), size,
+                                reinterpret_cast<quint8*>( encrypted.data() )) );
+    QByteArray out( encrypted.size(), 0 );
+    const quint8 *in = reinterpret_cast<const quint8*>( encrypted.constData() );
+    quint8 *outPtr = reinterpret_cast<quint8*>( out.data() );
+    bool ok = false;
+
+    QBENCHMARK { ok = crypto.decryptBound(in, encrypted.size(), outPtr); }
+    QVERIFY( ok );
+    QVERIFY( memcmp(outPtr, _data.constData(), static_cast<size_t>(size)) == 0 );
+}
+//==================================================================================================
+void benchCrypto::bench_crc_data()
+{
+    QTest::addColumn<int>("variant");
+    QTest::addColumn<int>("size");
+
+    const int count = static_cast<int>( sizeof(crcVariants) / sizeof(crcVariants[0]) );
+    for (int i=0; i<count; ++i) {
+        for (int size: benchSizes) {
+            QTest::newRow( qPrintable(QString("%1/%2").arg(crcVariants[i].name).arg(size)) ) << i << size;
+        }
+    }
+}
+//==================================================================================================
+void benchCrypto::bench_crc()
+{
+    QFETCH(int, variant);
+    QFETCH(int, size);
+
+    const CrcFunc func = crcVariants[variant].func;
+    const quint8 *data = reinterpret_cast<const quint8*>( _data.constData() );
+    volatile quint32 res = 0; // результат не должен быть отброшен оптимизатором
+
+    QBENCHMARK { res = func(data, size); }
+    Q_UNUSED(res)
+}
+//==================================================================================================
+void benchCrypto::bench_smallMessages_data()
+{
+    QTest::addColumn<bool>("bound");
+
+    QTest::newRow("keyPerCall/64") << false;
+    QTest::newRow("boundKey/64") << true;
+}
+//==================================================================================================
+void benchCrypto::bench_smallMessages()
+{
+    QFETCH(bool, bound);
+
+    Crypto crypto;
+    const QString key = "benchmark";
+    const QByteArray data = _data.left(64);
+    QByteArray res;
+
+    if (bound) {
+        QVERIFY( crypto.bindKey(key) );
+        QBENCHMARK { crypto.encryptBound(data, res); }
+    }
+    else {
+        QBENCHMARK { crypto.encryptData(data, key, res); }
+    }
+    QCOMPARE( res.size(), data.size() );
+}
+//==================================================================================================
+void benchCrypto::bench_parallel_data()
+{
+    QTest::addColumn<int>("threads");
+
+    const int size = benchSizes.last();
+    const int maxThreads = qMax(QThread::idealThreadCount(), 1);
+    for (int threads = 1; threads <= maxThreads; threads *= 2) {
+        QTest::newRow( qPrintable(QString("threads%1/%2").arg(threads).arg(size)) ) << threads;
+    }
+    if ((maxThreads & (maxThreads - 1)) != 0) {
+        QTest::newRow( qPrintable(QString("threads%1/%2").arg(maxThreads).arg(size)) ) << maxThreads;
+    }
+}
+//==================================================================================================
+void benchCrypto::bench_parallel()
+{
+    QFETCH(int, threads);
+
+    Crypto crypto;
+    crypto.setParallelMode(true);
+    crypto.setParallelThreadCount(threads);
+    QVERIFY( crypto.bindKey("benchmark") );
+    QByteArray res;
+
+    QBENCHMARK { crypto.encryptBound(_data, res); }
+    QCOMPARE( res.size(), _data.size() );
+}
+//==================================================================================================
+void benchCrypto::bench_md5_data()
+{
+    QTest::addColumn<int>("mode");
+
+    QTest::newRow("md5/100000") << 0;
+    QTest::newRow("md5BatchHex/100000") << 1;
+    QTest::newRow("md5BatchBinary/100000") << 2;
+    QTest::newRow("md5BatchHexAllThreads/100000") << 3;
+}
+//==================================================================================================
+void benchCrypto::bench_md5()
+{
+    QFETCH(int, mode);
+
+    // 100 000 коротких ключей
+    QStringList strKeys;
+    QList<QByteArray> keys;
+    for (int i = 0; i < 100000; ++i) {
+        strKeys.append( QString("meter:%1:channel:%2").arg(i * 7919).arg(i % 16) );
+        keys.append( strKeys.last().toUtf8() );
+    }
+    QStringList hashes;
+    QByteArray out;
+
+    switch (mode) {
+    case 0:
+        QBENCHMARK {
+            hashes.clear();
+            for (const QString &key: strKeys) hashes.append( Crypto::md5(key) );
+        }
+        QCOMPARE( hashes.size(), strKeys.size() );
+        break;
+    case 1:
+        QBENCHMARK { Crypto::md5Batch(keys, out, true); }
+        break;
+    case 2:
+        QBENCHMARK { Crypto::md5Batch(keys, out, false); }
+        break;
+    default:
+        QBENCHMARK { Crypto::md5Batch(keys, out, true, 0); }
+        break;
+    }
+}
+//==================================================================================================
+int main(int argc, char *argv[])
+{
+    benchCrypto bench;
+    return QTest::qExec( &bench, benchArguments(argc, argv) );
+}
+
+#include "tst_benchcrypto.moc"
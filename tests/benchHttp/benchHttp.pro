@@ -0,0 +1,23 @@
+QT += testlib network
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath c++14
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_benchhttp.cpp
+
+INCLUDEPATH *= $${PWD}/../../inc \
+        $${PWD}/../../src \
+        $${PWD}/..
+
+HEADERS *= $${PWD}/../bench_args.h \
+           $${PWD}/../../inc/http.h \
+           $${PWD}/../../inc/http_server.h \
+           $${PWD}/../../inc/fastcgi_server.h \
+           $${PWD}/../../inc/http_listener.h
+
+SOURCES *= $${PWD}/../../src/http_server.cpp \
+           $${PWD}/../../src/fastcgi_server.cpp \
+           $${PWD}/../../src/http_listener.cpp
@@ -0,0 +1,525 @@
+#include <QtTest>
+#include <QCoreApplication>
+#include <QProcess>
+#include <QLocalSocket>
+#include <QTcpSocket>
+#include <QThread>
+#include <QElapsedTimer>
+#include <algorithm>
+#ifdef Q_OS_UNIX
+#include <unistd.h>
+#endif
+#include "http_server.h"
+#include "fastcgi_server.h"
+#include "http_listener.h"
+#include "bench_args.h"
+
+using namespace nayk;
+
+/*
+  Нагрузочный тест HttpServer: классический CGI (новый процесс на каждый запрос)
+  против FastCGI (один процесс, Unix-сокет или TCP, с keep-alive и без).
+  CGI-обработчиком служит этот же исполняемый файл, запущенный с ключом --cgi.
+  Встроенный HTTP/1.1-сервер (HttpListener): новое соединение на запрос, keep-alive
+  и конвейер по 8 запросов; для него отдельно замеряется p99 задержки (мс).
+  Чтение содержимого CGI-запроса из stdin (1 КБ - 100 МБ) замеряется в процессе теста:
+  stdin подменяется каналом, в который пишет отдельный поток (только Unix).
+  Разбор multipart/form-data с файловой частью 64 КБ - 64 МБ (время должно расти линейно).
+  Результат замера запросов - запросов в секунду (метрика Events), по умолчанию в CSV:
+      ./benchHttp > bench.csv
+  Любой ключ формата QTest (-txt, -xml, -o файл,формат ...) отменяет CSV по умолчанию.
+*/
+//==================================================================================================
+const QByteArray requestBody     = "a=1&b=2";
+const QString requestQuery       = "q=bench";
+const QByteArray responseBody    = "q=bench;a=1;b=2";
+const int cgiRequestCount        = 200;
+const int fastCgiRequestCount    = 5000;
+const int listenerRequestCount   = 10000;
+
+enum BenchTransport { TransportCgi, TransportUnix, TransportTcp, TransportHttp };
+
+//==================================================================================================
+// Обработчик, общий для CGI и FastCGI
+static void handleRequest(HttpServer *http)
+{
+    bool ok;
+    http->readRequest(&ok);
+    http->setResponseContentType(ContentTypeText);
+    http->setResponseContent( QString("q=%1;a=%2;b=%3")
+                              .arg( http->requestGetParameter("q") )
+                              .arg( http->requestPostParameter("a") )
+                              .arg( http->requestPostParameter("b") ).toUtf8() );
+    http->writeResponse(&ok);
+}
+//==================================================================================================
+static QMap<QString, QString> requestHeaders()
+{
+    QMap<QString, QString> headers;
+    headers.insert(ServerHeaderGatewayInterface, "CGI/1.1");
+    headers.insert(ServerHeaderRequestMethod, MethodPost);
+    headers.insert(ServerHeaderQueryString, requestQuery);
+    headers.insert(ServerHeaderContentType, ContentTypeWWWForm);
+    headers.insert(ServerHeaderContentLength, QString::number(requestBody.size()));
+    return headers;
+}
+//==================================================================================================
+// Клиентская сторона FastCGI (то, что делает веб-сервер):
+static QByteArray fcgiRecord(quint8 type, quint16 id, const QByteArray &content)
+{
+    QByteArray rec;
+    rec.append( static_cast<char>(1) );
+    rec.append( static_cast<char>(type) );
+    rec.append( static_cast<char>(id >> 8) );
+    rec.append( static_cast<char>(id & 0xFF) );
+    rec.append( static_cast<char>(content.size() >> 8) );
+    rec.append( static_cast<char>(content.size() & 0xFF) );
+    rec.append( static_cast<char>(0) );
+    rec.append( static_cast<char>(0) );
+    rec.append( content );
+    return rec;
+}
+//==================================================================================================
+static QByteArray fcgiRequest(quint16 id, bool keepConn)
+{
+    QByteArray begin(8, 0);
+    begin[1] = 1; // Responder
+    begin[2] = keepConn ? 1 : 0;
+
+    QByteArray params;
+    const QMap<QString, QString> headers = requestHeaders();
+    for (auto itr = headers.constBegin(); itr != headers.constEnd(); ++itr) {
+        const QByteArray name = itr.key().toLatin1();
+        const QByteArray value = itr.value().toUtf8();
+        params.append( static_cast<char>(name.size()) );
+        params.append( static_cast<char>(value.size()) );
+        params.append( name );
+        params.append( value );
+    }
+
+    return fcgiRecord(1, id, begin)
+            + fcgiRecord(4, id, params) + fcgiRecord(4, id, QByteArray())
+            + fcgiRecord(5, id, requestBody) + fcgiRecord(5, id, QByteArray());
+}
+//==================================================================================================
+// Читает записи до FCGI_END_REQUEST, возвращает собранный FCGI_STDOUT
+static bool readFcgiResponse(QIODevice *socket, QByteArray &buffer, QByteArray &out)
+{
+    out.clear();
+    forever {
+        while(buffer.size() >= 8) {
+            const uchar *h = reinterpret_cast<const uchar*>( buffer.constData() );
+            const int contentLength = (h[4] << 8) | h[5];
+            const int recordLength = 8 + contentLength + h[6];
+            if(buffer.size() < recordLength) break;
+            const quint8 type = h[1];
+            if(type == 6) out.append( buffer.constData() + 8, contentLength );
+            buffer.remove(0, recordLength);
+            if(type == 3) return true;
+        }
+        if(!socket->waitForReadyRead(5000)) return false;
+        buffer.append( socket->readAll() );
+    }
+}
+//==================================================================================================
+static QByteArray httpRequest(bool keepAlive)
+{
+    return "POST /bench?" + requestQuery.toLatin1() + " HTTP/1.1\r\n"
+            "Host: 127.0.0.1\r\n"
+            "Content-Type: " + ContentTypeWWWForm.toLatin1() + "\r\n"
+            "Content-Length: " + QByteArray::number(requestBody.size()) + "\r\n"
+            + (keepAlive ? "" : "Connection: close\r\n") + "\r\n"
+            + requestBody;
+}
+//==================================================================================================
+// Читает один ответ HTTP (тело по Content-Length), остаток оставляет в буфере
+static bool readHttpResponse(QIODevice *socket, QByteArray &buffer, QByteArray &out)
+{
+    forever {
+        const int end = buffer.indexOf("\r\n\r\n");
+        if(end >= 0) {
+            const QByteArray head = buffer.left(end + 2).toLower();
+            const int n = head.indexOf("\r\ncontent-length:");
+            const int length = (n < 0) ? 0 : head.mid(n + 17, head.indexOf("\r\n", n + 2) - n - 17).trimmed().toInt();
+            if(buffer.size() >= (end + 4 + length)) {
+                out = buffer.left(end + 4 + length);
+                buffer.remove(0, end + 4 + length);
+                return true;
+            }
+        }
+        if(!socket->waitForReadyRead(5000)) return false;
+        buffer.append( socket->readAll() );
+    }
+}
+//==================================================================================================
+static bool checkResponse(const QByteArray &out)
+{
+    const int n = out.indexOf("\r\n\r\n");
+    return (n > 0) && (out.mid(n + 4) == responseBody);
+}
+//==================================================================================================
+// multipart/form-data: текстовое поле и файловая часть
+static QByteArray multipartBody(const QByteArray &boundary, const QByteArray &file)
+{
+    const QByteArray dash = "--" + boundary;
+    return dash + "\r\n"
+            + "Content-Disposition: form-data; name=\"text\"\r\n\r\n"
+            + "hello\r\n"
+            + dash + "\r\n"
+            + "Content-Disposition: form-data; name=\"file\"; filename=\"a.bin\"\r\n"
+            + "Content-Type: application/octet-stream\r\n\r\n"
+            + file + "\r\n"
+            + dash + "--\r\n";
+}
+//==================================================================================================
+class benchHttp : public QObject
+{
+    Q_OBJECT
+
+public:
+    benchHttp();
+    ~benchHttp();
+
+private:
+    QThread _thread;
+    FastCgiServer *_fcgi {nullptr};
+    QString _socketName;
+    quint16 _port {0};
+    quint16 _httpPort {0};
+    QIODevice *connectTo(int transport);
+    void addListenerRows();
+    void runListener(int depth, bool keepAlive, QVector<qint64> &latencies, qint64 &elapsed);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    //
+    void bench_requests_data();
+    void bench_requests();
+    void bench_listener_data();
+    void bench_listener();
+    void bench_listener_p99_data();
+    void bench_listener_p99();
+    void bench_readContent_data();
+    void bench_readContent();
+    void bench_multipart_data();
+    void bench_multipart();
+};
+//==================================================================================================
+benchHttp::benchHttp()
+{
+
+}
+//==================================================================================================
+benchHttp::~benchHttp()
+{
+
+}
+//==================================================================================================
+void benchHttp::initTestCase()
+{
+    _socketName = QDir::temp().absoluteFilePath(
+                QString("benchHttp-%1.sock").arg(QCoreApplication::applicationPid()) );
+
+    // FastCGI-сервер живет в своем потоке со своим циклом событий, клиент - в основном
+    _fcgi = new FastCgiServer();
+    _fcgi->moveToThread(&_thread);
+    connect(&_thread, &QThread::finished, _fcgi, &QObject::deleteLater);
+    connect(_fcgi, &FastCgiServer::newRequest, _fcgi, [](HttpServer *http) { handleRequest(http); });
+    _thread.start();
+
+    bool ok = false;
+    QMetaObject::invokeMethod(_fcgi, [this, &ok]() {
+        // TCP и HTTP слушают отдельные серверы, дочерние к первому (удаляются вместе с ним)
+        FastCgiServer *tcp = new FastCgiServer(_fcgi);
+        connect(tcp, &FastCgiServer::newRequest, tcp, [](HttpServer *http) { handleRequest(http); });
+        HttpListener *listener = new HttpListener(_fcgi);
+        connect(listener, &HttpListener::newRequest, listener, [](HttpServer *http) { handleRequest(http); });
+        ok = _fcgi->listen(_socketName) && tcp->listen(QHostAddress::LocalHost, 0)
+                && listener->listen(QHostAddress::LocalHost, 0);
+        _port = tcp->serverPort();
+        _httpPort = listener->serverPort();
+    }, Qt::BlockingQueuedConnection);
+    QVERIFY( ok );
+}
+//==================================================================================================
+void benchHttp::cleanupTestCase()
+{
+    _thread.quit();
+    _thread.wait();
+    QFile::remove(_socketName);
+}
+//==================================================================================================
+QIODevice *benchHttp::connectTo(int transport)
+{
+    if(transport == TransportUnix) {
+        QLocalSocket *socket = new QLocalSocket();
+        socket->connectToServer(_socketName);
+        if(socket->waitForConnected(5000)) return socket;
+        delete socket;
+    }
+    else {
+        QTcpSocket *socket = new QTcpSocket();
+        socket->connectToHost(QHostAddress::LocalHost, (transport == TransportHttp) ? _httpPort : _port);
+        if(socket->waitForConnected(5000)) {
+            socket->setSocketOption(QAbstractSocket::LowDelayOption, 1);
+            return socket;
+        }
+        delete socket;
+    }
+    return nullptr;
+}
+//==================================================================================================
+void benchHttp::bench_requests_data()
+{
+    QTest::addColumn<int>("transport");
+    QTest::addColumn<bool>("keepConn");
+
+    QTest::newRow("cgi") << static_cast<int>(TransportCgi) << false;
+    QTest::newRow("fastcgi-unix") << static_cast<int>(TransportUnix) << false;
+    QTest::newRow("fastcgi-unix-keepconn") << static_cast<int>(TransportUnix) << true;
+    QTest::newRow("fastcgi-tcp") << static_cast<int>(TransportTcp) << false;
+    QTest::newRow("fastcgi-tcp-keepconn") << static_cast<int>(TransportTcp) << true;
+}
+//==================================================================================================
+void benchHttp::bench_requests()
+{
+    QFETCH(int, transport);
+    QFETCH(bool, keepConn);
+
+    QElapsedTimer timer;
+    int count = 0;
+
+    if(transport == TransportCgi) {
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        const QMap<QString, QString> headers = requestHeaders();
+        for (auto itr = headers.constBegin(); itr != headers.constEnd(); ++itr) env.insert(itr.key(), itr.value());
+
+        timer.start();
+        for (; count < cgiRequestCount; ++count) {
+            QProcess proc;
+            proc.setProcessEnvironment(env);
+            proc.start(QCoreApplication::applicationFilePath(), QStringList() << "--cgi");
+            QVERIFY( proc.waitForStarted() );
+            proc.write(requestBody);
+            proc.closeWriteChannel();
+            QVERIFY( proc.waitForFinished() );
+            QVERIFY( checkResponse(proc.readAllStandardOutput()) );
+        }
+    }
+    else {
+        QIODevice *socket = nullptr;
+        QByteArray buffer, out;
+        timer.start();
+        for (; count < fastCgiRequestCount; ++count) {
+            if(!socket) socket = connectTo(transport);
+            QVERIFY( socket );
+            socket->write( fcgiRequest(1, keepConn) );
+            QVERIFY( readFcgiResponse(socket, buffer, out) );
+            QVERIFY( checkResponse(out) );
+            if(!keepConn) {
+                delete socket;
+                socket = nullptr;
+                buffer.clear();
+            }
+        }
+        delete socket;
+    }
+
+    const qint64 ns = timer.nsecsElapsed();
+    QTest::setBenchmarkResult( count * 1e9 / (ns > 0 ? ns : 1), QTest::Events );
+}
+//==================================================================================================
+void benchHttp::addListenerRows()
+{
+    QTest::addColumn<int>("depth");
+    QTest::addColumn<bool>("keepAlive");
+
+    QTest::newRow("http-close") << 1 << false;
+    QTest::newRow("http-keepalive") << 1 << true;
+    QTest::newRow("http-pipeline8") << 8 << true;
+}
+//==================================================================================================
+// depth запросов отправляются подряд, не дожидаясь ответов; задержка запроса -
+// от отправки его пакета до получения его ответа
+void benchHttp::runListener(int depth, bool keepAlive, QVector<qint64> &latencies, qint64 &elapsed)
+{
+    QByteArray batch;
+    for (int i=0; i<depth; ++i) batch.append( httpRequest(keepAlive) );
+
+    latencies.clear();
+    latencies.reserve(listenerRequestCount);
+    QIODevice *socket = nullptr;
+    QByteArray buffer, out;
+    QElapsedTimer timer;
+    timer.start();
+
+    while (latencies.size() < listenerRequestCount) {
+        if(!socket) socket = connectTo(TransportHttp);
+        QVERIFY( socket );
+        const qint64 sent = timer.nsecsElapsed();
+        socket->write(batch);
+        for (int i=0; i<depth; ++i) {
+            QVERIFY( readHttpResponse(socket, buffer, out) );
+            QVERIFY( checkResponse(out) );
+            latencies.append( timer.nsecsElapsed() - sent );
+        }
+        if(!keepAlive) {
+            delete socket;
+            socket = nullptr;
+            buffer.clear();
+        }
+    }
+    delete socket;
+    elapsed = timer.nsecsElapsed();
+}
+//==================================================================================================
+void benchHttp::bench_listener_data()
+{
+    addListenerRows();
+}
+//==================================================================================================
+void benchHttp::bench_listener()
+{
+    QFETCH(int, depth);
+    QFETCH(bool, keepAlive);
+
+    QVector<qint64> latencies;
+    qint64 ns = 0;
+    runListener(depth, keepAlive, latencies, ns);
+    if(QTest::currentTestFailed()) return;
+
+    QTest::setBenchmarkResult( latencies.size() * 1e9 / (ns > 0 ? ns : 1), QTest::Events );
+}
+//==================================================================================================
+void benchHttp::bench_listener_p99_data()
+{
+    addListenerRows();
+}
+//==================================================================================================
+void benchHttp::bench_listener_p99()
+{
+    QFETCH(int, depth);
+    QFETCH(bool, keepAlive);
+
+    QVector<qint64> latencies;
+    qint64 ns = 0;
+    runListener(depth, keepAlive, latencies, ns);
+    if(QTest::currentTestFailed()) return;
+
+    std::sort(latencies.begin(), latencies.end());
+    const int index = qMax(0, (latencies.size() * 99 + 99) / 100 - 1);
+    QTest::setBenchmarkResult( latencies.at(index) / 1e6, QTest::WalltimeMilliseconds );
+}
+//==================================================================================================
+void benchHttp::bench_readContent_data()
+{
+    QTest::addColumn<int>("size");
+
+    const QList<int> sizes { 1024, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 100 * 1024 * 1024 };
+    for (int size: sizes) {
+        QTest::newRow( qPrintable(QString("cgi-stdin/%1").arg(size)) ) << size;
+    }
+}
+//==================================================================================================
+void benchHttp::bench_readContent()
+{
+#ifndef Q_OS_UNIX
+    QSKIP("Подмена stdin каналом реализована только для Unix.");
+#else
+    QFETCH(int, size);
+
+    const QByteArray body(size, 'x');
+    qputenv("REQUEST_METHOD", MethodPost.toLatin1());
+    qputenv("CONTENT_TYPE", ContentTypeBinary.toLatin1());
+    qputenv("CONTENT_LENGTH", QByteArray::number(size));
+    const int savedStdin = ::dup(STDIN_FILENO);
+    bool ok = true;
+
+    QBENCHMARK {
+        int fds[2];
+        QVERIFY( ::pipe(fds) == 0 );
+        ::dup2(fds[0], STDIN_FILENO);
+        ::close(fds[0]);
+
+        // веб-сервер: пишет тело в канал, пока процесс его читает
+        const int fd = fds[1];
+        QThread *writer = QThread::create([&body, fd]() {
+            const char *data = body.constData();
+            qint64 left = body.size();
+            while (left > 0) {
+                const ssize_t n = ::write(fd, data, static_cast<size_t>(left));
+                if (n <= 0) break;
+                data += n;
+                left -= n;
+            }
+            ::close(fd);
+        });
+        writer->start();
+
+        HttpServer http;
+        bool readOk = false;
+        http.readRequest(&readOk);
+        writer->wait();
+        delete writer;
+        if (!readOk || (http.requestContent().size() != size)) ok = false;
+    }
+
+    ::dup2(savedStdin, STDIN_FILENO);
+    ::close(savedStdin);
+    qunsetenv("REQUEST_METHOD");
+    qunsetenv("CONTENT_TYPE");
+    qunsetenv("CONTENT_LENGTH");
+    QVERIFY( ok );
+#endif
+}
+//==================================================================================================
+void benchHttp::bench_multipart_data()
+{
+    QTest::addColumn<int>("size");
+
+    const QList<int> sizes { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024 };
+    for (int size: sizes) {
+        QTest::newRow( qPrintable(QString("multipart/%1").arg(size)) ) << size;
+    }
+}
+//==================================================================================================
+void benchHttp::bench_multipart()
+{
+    QFETCH(int, size);
+
+    const QByteArray boundary = "----nayk7MA4YWxkTrZu0gW";
+    const QByteArray body = multipartBody(boundary, QByteArray(size, 'x'));
+    QMap<QString, QString> headers;
+    headers.insert(ServerHeaderRequestMethod, MethodPost);
+    headers.insert(ServerHeaderContentType, ContentTypeMultipartForm + "; boundary=" + QString::fromLatin1(boundary));
+    headers.insert(ServerHeaderContentLength, QString::number(body.size()));
+    bool ok = false;
+
+    QBENCHMARK {
+        HttpServer http;
+        http.setRequest(headers, body);
+        http.readRequest(&ok);
+    }
+    QVERIFY( ok );
+}
+//==================================================================================================
+int main(int argc, char *argv[])
+{
+    // режим CGI-обработчика: процесс запускается веб-сервером (здесь - тестом) на каждый запрос
+    for (int i=1; i<argc; ++i) {
+        if (qstrcmp(argv[i], "--cgi") == 0) {
+            QCoreApplication app(argc, argv);
+            HttpServer http;
+            handleRequest(&http);
+            return 0;
+        }
+    }
+
+    QCoreApplication app(argc, argv);
+
+    benchHttp bench;
+    return QTest::qExec( &bench, benchArguments(argc, argv) );
+}
+
+#include "tst_benchhttp.moc"
@@ -0,0 +1,23 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath c++14
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_benchlog.cpp
+
+INCLUDEPATH *= $${PWD}/../../inc \
+        $${PWD}/../../src \
+        $${PWD}/..
+
+HEADERS *= $${PWD}/../bench_args.h \
+           $${PWD}/../log_reference.h \
+           $${PWD}/../../inc/log.h \
+           $${PWD}/../../inc/crc.h \
+           $${PWD}/../../inc/filesys.h \
+           $${PWD}/../../inc/parallel.h
+
+SOURCES *= $${PWD}/../../src/log.cpp \
+           $${PWD}/../../src/filesys.cpp
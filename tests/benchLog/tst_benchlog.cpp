@@ -0,0 +1,349 @@
+#include <QtTest>
+#include <QBuffer>
+#include <QDirIterator>
+#include <QTemporaryDir>
+#include "log.h"
+#include "log_reference.h"
+#include "bench_args.h"
+
+using namespace nayk;
+
+/*
+  Замеры производительности Log: синхронная и асинхронная запись, префикс строки,
+  постраничное чтение LogReader, подсветка 100 000 строк (прежняя реализация против новой),
+  поиск по индексу LogIndex (без индекса и с готовым индексом), двоичный лог (запись и выборка по типу).
+  Данные для чтения - лог из 200 000 строк во временном каталоге.
+  По умолчанию результат выводится в CSV:
+      ./benchLog > bench.csv
+  Любой ключ формата QTest (-txt, -xml, -o файл,формат ...) отменяет CSV по умолчанию.
+*/
+//==================================================================================================
+class benchLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    benchLog();
+    ~benchLog();
+
+private:
+    QTemporaryDir _dir;
+    QString _bigLog;
+    QString bigLog();
+    QString _logTree;
+    QString logTree();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    //
+    void bench_write_data();
+    void bench_write();
+    void bench_prefix_data();
+    void bench_prefix();
+    void bench_readerOpen();
+    void bench_readerPage();
+    void bench_highlight_data();
+    void bench_highlight();
+    void bench_search_data();
+    void bench_search();
+    void bench_binaryWrite_data();
+    void bench_binaryWrite();
+    void bench_binaryFilter_data();
+    void bench_binaryFilter();
+};
+//==================================================================================================
+benchLog::benchLog()
+{
+
+}
+//==================================================================================================
+benchLog::~benchLog()
+{
+
+}
+//==================================================================================================
+QString benchLog::bigLog()
+{
+    // 200 000 строк (~10 МБ) для измерений чтения
+    if (!_bigLog.isEmpty()) return _bigLog;
+    _bigLog = _dir.filePath("big.log");
+    QFile f(_bigLog);
+    if (!f.open(QIODevice::WriteOnly)) return QString();
+    const QDateTime base(QDate(2019, 6, 1), QTime(12, 0));
+    QByteArray data;
+    for (int i = 0; i < 200000; ++i) {
+        const LogType logType = static_cast<LogType>(i % 7);
+        data += (Log::getLogPrefix(logType, base.addMSecs(i)) + QString("request %1 <id=%2> done").arg(i).arg(i * 7) + "\n").toUtf8();
+        if (data.size() > 1024 * 1024) {
+            f.write(data);
+            data.clear();
+        }
+    }
+    f.write(data);
+    return _bigLog;
+}
+//==================================================================================================
+QString benchLog::logTree()
+{
+    // три дня по два файла по 3000 строк в дереве yyyy/MM/dd
+    if (!_logTree.isEmpty()) return _logTree;
+    _logTree = _dir.filePath("tree");
+
+    const QDate firstDay(2019, 6, 10);
+    for (int day = 0; day < 3; ++day) {
+        const QDate date = firstDay.addDays(day);
+        const QString path = _logTree + date.toString("/yyyy/MM/dd/");
+        if (!QDir().mkpath(path)) return QString();
+        for (int n = 0; n < 2; ++n) {
+            QFile f(path + QString("1200000%1.log").arg(n));
+            if (!f.open(QIODevice::WriteOnly)) return QString();
+            QDateTime dt( date, (n == 1) && (day == 2) ? QTime(23, 50) : QTime(n * 12, 0) );
+            QByteArray data;
+            for (int i = 0; i < 3000; ++i) {
+                const LogType logType = static_cast<LogType>( (i * 7 + day) % 8 );
+                const QString text = QString("day %1 file %2 line %3").arg(day).arg(n).arg(i);
+                data += ((logType == LogOther) ? text : Log::getLogPrefix(logType, dt) + text).toUtf8() + "\n";
+                dt = dt.addMSecs(997);
+            }
+            f.write(data);
+        }
+    }
+    return _logTree;
+}
+//==================================================================================================
+void benchLog::initTestCase()
+{
+    QVERIFY( _dir.isValid() );
+}
+//==================================================================================================
+void benchLog::cleanupTestCase()
+{
+
+}
+//==================================================================================================
+void benchLog::bench_write_data()
+{
+    QTest::addColumn<bool>("async");
+
+    QTest::newRow("sync") << false;
+    QTest::newRow("async") << true;
+}
+//==================================================================================================
+void benchLog::bench_write()
+{
+    QFETCH(bool, async);
+
+    const int count = 10000;
+    Log log;
+    log.setAsync(async);
+    QVERIFY( log.startLog(_dir.filePath(async ? "bench_async.log" : "bench_sync.log")) );
+    const QString text = "GET /api/v1/meters?id=12345 200 OK";
+
+    QElapsedTimer timer;
+    qint64 total = 0;
+    qint64 elapsed = 0;
+    QBENCHMARK {
+        timer.start();
+        for (int i = 0; i < count; ++i) log.write(LogDbg, text);
+        elapsed += timer.nsecsElapsed();
+        total += count;
+    }
+    QVERIFY( log.flush() );
+    qInfo( "%s: %.0f messages/sec (caller thread)", async ? "async" : "sync",
+           (elapsed > 0) ? total * 1e9 / elapsed : 0.0 );
+}
+//==================================================================================================
+void benchLog::bench_prefix_data()
+{
+    QTest::addColumn<bool>("cached");
+
+    QTest::newRow("toString") << false;
+    QTest::newRow("cached") << true;
+}
+//==================================================================================================
+void benchLog::bench_prefix()
+{
+    QFETCH(bool, cached);
+
+    // 1000 строк в пределах одной секунды - типичный поток сообщений
+    const QDateTime base = QDateTime::currentDateTime();
+    int size = 0;
+    QBENCHMARK {
+        for (int i = 0; i < 1000; ++i) {
+            const QDateTime date = base.addMSecs(i);
+            size += cached ? Log::getLogPrefix(LogInfo, date).size() : referencePrefix(LogInfo, date).size();
+        }
+    }
+    QVERIFY( size > 0 );
+}
+//==================================================================================================
+void benchLog::bench_readerOpen()
+{
+    const QString fileName = bigLog();
+    QVERIFY( !fileName.isEmpty() );
+
+    QBENCHMARK {
+        LogReader reader(fileName);
+        QCOMPARE( reader.lineCount(), qint64(200000) );
+    }
+}
+//==================================================================================================
+void benchLog::bench_readerPage()
+{
+    // страница из 100 строк в случайном месте файла
+    LogReader reader(bigLog());
+    QCOMPARE( reader.lineCount(), qint64(200000) );
+
+    quint32 seed = 1;
+    int size = 0;
+    QBENCHMARK {
+        seed = seed * 1103515245u + 12345u;
+        size += reader.readLog(HtmlLog, (seed >> 8) % 200000, 100).size();
+    }
+    QVERIFY( size > 0 );
+}
+//==================================================================================================
+void benchLog::bench_highlight_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<bool>("reference");
+
+    QTest::newRow("plain/old") << int(PlainLog) << true;
+    QTest::newRow("plain/new") << int(PlainLog) << false;
+    QTest::newRow("rich/old") << int(RichLog) << true;
+    QTest::newRow("rich/new") << int(RichLog) << false;
+    QTest::newRow("html/old") << int(HtmlLog) << true;
+    QTest::newRow("html/new") << int(HtmlLog) << false;
+}
+//==================================================================================================
+void benchLog::bench_highlight()
+{
+    QFETCH(int, format);
+    QFETCH(bool, reference);
+    const LogFormat logFormat = static_cast<LogFormat>(format);
+
+    // 100 000 строк лог-файла
+    LogReader reader(bigLog());
+    const QString text = reader.text(0, 100000);
+    QCOMPARE( text.count(QChar('\n')), 100000 );
+
+    int size = 0;
+    QBENCHMARK {
+        size += reference ? referenceHighlight(logFormat, text, false).size() : Log::highlightLog(logFormat, text, false).size();
+    }
+    QVERIFY( size > 0 );
+}
+//==================================================================================================
+void benchLog::bench_search_data()
+{
+    QTest::addColumn<bool>("cold");
+
+    QTest::newRow("cold") << true;
+    QTest::newRow("indexed") << false;
+}
+//==================================================================================================
+void benchLog::bench_search()
+{
+    QFETCH(bool, cold);
+
+    // все [err] за час в трех днях логов
+    const QString root = logTree();
+    const QDateTime from(QDate(2019, 6, 11), QTime(12, 0)), to(QDate(2019, 6, 11), QTime(13, 0));
+    QVERIFY( !LogIndex::search(root, from, to, 1 << LogError).isEmpty() );  // индексы строятся при первом поиске
+    QDirIterator it(root, QStringList("*.idx"), QDir::Files, QDirIterator::Subdirectories);
+    QStringList indexFiles;
+    while (it.hasNext()) indexFiles.append( it.next() );
+
+    int count = 0;
+    QBENCHMARK {
+        if (cold) {
+            for (const QString &fileName: indexFiles) QFile::remove(fileName);
+        }
+        count += LogIndex::search(root, from, to, 1 << LogError).size();
+    }
+    QVERIFY( count > 0 );
+}
+//==================================================================================================
+void benchLog::bench_binaryWrite_data()
+{
+    QTest::addColumn<bool>("binary");
+
+    QTest::newRow("text") << false;
+    QTest::newRow("binary") << true;
+}
+//==================================================================================================
+void benchLog::bench_binaryWrite()
+{
+    QFETCH(bool, binary);
+
+    Log log;
+    log.setFileFormat(binary ? BinaryLog : PlainLog);
+    QVERIFY( log.startLog(_dir.filePath(binary ? "bench_write.blog" : "bench_write.log")) );
+    const QString text = "GET /api/v1/meters?id=12345 200 OK";
+
+    QBENCHMARK {
+        for (int i = 0; i < 10000; ++i) log.write(LogDbg, text);
+    }
+    QVERIFY( log.flush() );
+}
+//==================================================================================================
+void benchLog::bench_binaryFilter_data()
+{
+    QTest::addColumn<bool>("binary");
+
+    QTest::newRow("text") << false;
+    QTest::newRow("binary") << true;
+}
+//==================================================================================================
+void benchLog::bench_binaryFilter()
+{
+    QFETCH(bool, binary);
+
+    // выборка [err] из 200 000 строк: текст - разбор префиксов строк, двоичный лог - пропуск записей
+    QFile f(bigLog());
+    QVERIFY( f.open(QIODevice::ReadOnly) );
+    const QByteArray text = f.readAll();
+    QByteArray data("NLOG\x01\x01", 6);
+    {
+        LogReader reader(bigLog());
+        QBuffer buf(&data);
+        buf.open(QIODevice::Append);
+        for (qint64 i = 0; i < reader.lineCount(); ++i) {
+            const QString line = reader.line(i);
+            const QByteArray payload = line.mid(20).toUtf8();
+            const int logType = int(i % 7);
+            buf.write("\x02", 1);
+            buf.putChar(static_cast<char>(logType));
+            buf.putChar(static_cast<char>(payload.size()));
+            buf.write(payload);
+        }
+    }
+
+    int count = 0;
+    QBENCHMARK {
+        if (binary) {
+            LogBinaryReader reader(data);
+            while (reader.next(1 << LogError)) ++count;
+        }
+        else {
+            for (int pos = 0; pos < text.size(); ) {
+                int end = text.indexOf('\n', pos);
+                if (end < 0) end = text.size();
+                if ((end - pos > 18) && (text.at(pos + 14) == '[') && (text.at(pos + 15) == 'e')
+                        && (text.at(pos + 16) == 'r') && (text.at(pos + 17) == 'r')) ++count;
+                pos = end + 1;
+            }
+        }
+    }
+    QVERIFY( count > 0 );
+}
+//==================================================================================================
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    benchLog bench;
+    return QTest::qExec( &bench, benchArguments(argc, argv) );
+}
+
+#include "tst_benchlog.moc"
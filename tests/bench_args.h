@@ -0,0 +1,25 @@
+#ifndef BENCH_ARGS_H
+#define BENCH_ARGS_H
+
+#include <QString>
+#include <QStringList>
+
+/*
+  Аргументы QTest для проектов замеров (bench*): CSV по умолчанию, если формат вывода
+  не задан явно (-o, -txt, -xml ...), иначе аргументы передаются без изменений.
+*/
+inline QStringList benchArguments(int argc, char *argv[])
+{
+    QStringList args;
+    bool hasFormat = false;
+    const QStringList formats { "-o", "-txt", "-csv", "-xml", "-lightxml", "-xunitxml", "-teamcity", "-tap" };
+    for (int i=0; i<argc; ++i) {
+        const QString arg = QString::fromLocal8Bit( argv[i] );
+        if (formats.contains(arg)) hasFormat = true;
+        args.append( arg );
+    }
+    if (!hasFormat) args.append( "-csv" );
+    return args;
+}
+
+#endif // BENCH_ARGS_H
@@ -0,0 +1,145 @@
+#ifndef LOG_REFERENCE_H
+#define LOG_REFERENCE_H
+
+#include <QDateTime>
+#include <QString>
+#include <QStringList>
+#include "log.h"
+
+/*
+  Прежние реализации Log::getLogPrefix и Log::highlightLog: эталон для проверки
+  результата в testLog и для сравнения скорости в benchLog.
+*/
+//==================================================================================================
+// цвета Log::highlightLog для эталонной реализации
+const QString clLogDateDark       = "#929292";
+const QString clLogDateLight      = "#333333";
+
+const QString clLogPrefixDark     = "#c88dee";
+const QString clLogPrefixLight    = "#562873";
+
+const QString clLogInfDark        = "#ffffff";
+const QString clLogInfLight       = "#000000";
+
+const QString clLogWrnDark        = "#ff9c54";
+const QString clLogWrnLight       = "#8d3c00";
+
+const QString clLogErrDark        = "#ff4040";
+const QString clLogErrLight       = "#a50000";
+
+const QString clLogInDark         = "#55d864";
+const QString clLogInLight        = "#003706";
+
+const QString clLogOutDark        = "#dd69bb";
+const QString clLogOutLight       = "#53003b";
+
+const QString clLogTxtDark        = "#d8d8d8";
+const QString clLogTxtLight       = "#1f1f1f";
+
+const QString clLogDbgDark        = "#00ddc6";
+const QString clLogDbgLight       = "#006766";
+
+const QString clLogOtherDark      = "#8f8f8f";
+const QString clLogOtherLight     = "#888888";
+//==================================================================================================
+// прежняя реализация Log::getLogPrefix
+inline QString referencePrefix(nayk::LogType logType, const QDateTime &date)
+{
+    QString prefix = "[" + date.toString("HH:mm:ss.zzz") + "]";
+    switch (logType) {
+    case nayk::LogInfo: prefix += "[inf] "; break;
+    case nayk::LogWarning: prefix += "[wrn] "; break;
+    case nayk::LogError: prefix += "[err] "; break;
+    case nayk::LogIn: prefix += "[<<<] "; break;
+    case nayk::LogOut: prefix += "[>>>] "; break;
+    case nayk::LogText: prefix += "[txt] "; break;
+    case nayk::LogDbg: prefix += "[dbg] "; break;
+    default: prefix = ""; break;
+    }
+    return prefix;
+}
+//==================================================================================================
+// прежняя реализация Log::highlightLog
+inline QString referenceHighlight(nayk::LogFormat logFormat, const QString &logText, bool darkBackground)
+{
+    QString res = "";
+    QStringList strList = logText.split("\n");
+    if(strList.isEmpty()) return res;
+
+    QString preDate = "", prePrefix = "", preInf = "", preWrn = "", preErr = "", preIn = "", preOut = "",
+            preTxt = "", preDbg = "", preOther = "";
+    QString suffix = "", endLine = "\n";
+
+    if(logFormat == nayk::RichLog) {
+        endLine = "<br>";
+        suffix = "</font>";
+        preDate = "<font color=\"" + (darkBackground ? clLogDateDark : clLogDateLight) + "\">";
+        prePrefix = "<font color=\"" + (darkBackground ? clLogPrefixDark : clLogPrefixLight) + "\">";
+        preInf = "<font color=\"" + (darkBackground ? clLogInfDark : clLogInfLight) + "\">";
+        preWrn = "<font color=\"" + (darkBackground ? clLogWrnDark : clLogWrnLight) + "\">";
+        preErr = "<font color=\"" + (darkBackground ? clLogErrDark : clLogErrLight) + "\">";
+        preIn = "<font color=\"" + (darkBackground ? clLogInDark : clLogInLight) + "\">";
+        preOut = "<font color=\"" + (darkBackground ? clLogOutDark : clLogOutLight) + "\">";
+        preTxt = "<font color=\"" + (darkBackground ? clLogTxtDark : clLogTxtLight) + "\">";
+        preDbg = "<font color=\"" + (darkBackground ? clLogDbgDark : clLogDbgLight) + "\">";
+        preOther = "<font color=\"" + (darkBackground ? clLogOtherDark : clLogOtherLight) + "\">";
+    }
+    else if(logFormat == nayk::HtmlLog) {
+        endLine = "<br>";
+        suffix = "</span>";
+        preDate = "<span style=\"color: " + (darkBackground ? clLogDateDark : clLogDateLight) + ";\">";
+        prePrefix = "<span style=\"color: " + (darkBackground ? clLogPrefixDark : clLogPrefixLight) + ";\">";
+        preInf = "<span style=\"color: " + (darkBackground ? clLogInfDark : clLogInfLight) + ";\">";
+        preWrn = "<span style=\"color: " + (darkBackground ? clLogWrnDark : clLogWrnLight) + ";\">";
+        preErr = "<span style=\"color: " + (darkBackground ? clLogErrDark : clLogErrLight) + ";\">";
+        preIn = "<span style=\"color: " + (darkBackground ? clLogInDark : clLogInLight) + ";\">";
+        preOut = "<span style=\"color: " + (darkBackground ? clLogOutDark : clLogOutLight) + ";\">";
+        preTxt = "<span style=\"color: " + (darkBackground ? clLogTxtDark : clLogTxtLight) + ";\">";
+        preDbg = "<span style=\"color: " + (darkBackground ? clLogDbgDark : clLogDbgLight) + ";\">";
+        preOther = "<span style=\"color: " + (darkBackground ? clLogOtherDark : clLogOtherLight) + ";\">";
+    }
+
+    for(int i=0; i<strList.size(); ++i) {
+        QString str = strList.at(i);
+        QString dtStr = "", typeStr = "";
+        while( (str.length()>0) && ( (str.right(1) == "\n") || (str.right(1) == "\r") ) ) str.remove( str.length()-1, 1 );
+
+        if((str.length() > 20) && (str[0] == QChar('[')) && (str[13] == QChar(']')) &&
+                (str[14] == QChar('[')) && (str[18] == QChar(']')) ) {
+            dtStr = str.left(14);
+            typeStr = str.mid(14, 5);
+            str.remove(0,19);
+        }
+
+        QString line = "";
+        if(!dtStr.isEmpty())
+            line += preDate + ((logFormat == nayk::HtmlLog) ? dtStr.toHtmlEscaped() : dtStr) + suffix;
+        if(!typeStr.isEmpty())
+            line += prePrefix + ((logFormat != nayk::PlainLog) ? typeStr.toHtmlEscaped() : typeStr) + suffix;
+
+        if(logFormat == nayk::HtmlLog) str = str.toHtmlEscaped();
+        if(str.isEmpty()) str = (logFormat == nayk::PlainLog) ? " " : "&nbsp;";
+
+        if(typeStr == "[inf]")
+            line += preInf + str + suffix;
+        else if(typeStr == "[wrn]")
+            line += preWrn + ((logFormat == nayk::PlainLog) ? "" : "<i>") + str + ((logFormat == nayk::PlainLog) ? "" : "</i>") + suffix;
+        else if(typeStr == "[err]")
+            line += preErr + ((logFormat == nayk::PlainLog) ? "" : "<b><i>") + str + ((logFormat == nayk::PlainLog) ? "" : "</i></b>") + suffix;
+        else if(typeStr == "[<<<]")
+            line += preIn + str + suffix;
+        else if(typeStr == "[>>>]")
+            line += preOut + str + suffix;
+        else if(typeStr == "[txt]")
+            line += preTxt + str + suffix;
+        else if(typeStr == "[dbg]")
+            line += preDbg + str + suffix;
+        else
+            line += preOther + str + suffix;
+
+        res += line + endLine;
+    }
+    return res;
+}
+
+#endif // LOG_REFERENCE_H
@@ -0,0 +1,18 @@
+QT += testlib
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase c++14
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_testcrypto.cpp
+
+INCLUDEPATH *= $${PWD}/../../inc \
+        $${PWD}/../../src
+
+HEADERS *= $${PWD}/../../inc/crc.h \
+           $${PWD}/../../inc/crypto.h \
+           $${PWD}/../../inc/parallel.h
+
+SOURCES *= $${PWD}/../../src/crypto.cpp
@@ -0,0 +1,754 @@
+#include <QtTest>
+#include <QByteArray>
+#include <random>
+#include "crypto.h"
+#include "parallel.h"
+
+using namespace nayk;
+
+// подсчет выделений памяти (glibc): malloc/realloc/calloc перехватываются в тестовом приложении
+#if defined(__GLIBC__)
+#include <atomic>
+static std::atomic<qint64> allocCount {0};
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *malloc(size_t size) noexcept { ++allocCount; return __libc_malloc(size); }
+void *realloc(void *ptr, size_t size) noexcept { ++allocCount; return __libc_realloc(ptr, size); }
+void *calloc(size_t count, size_t size) noexcept { ++allocCount; return __libc_calloc(count, size); }
+}
+#define COUNT_ALLOCS
+#endif
+
+// add necessary includes here
+//==================================================================================================
+class testCrypto : public QObject
+{
+    Q_OBJECT
+
+public:
+    testCrypto();
+    ~testCrypto();
+
+private:
+    std::mt19937 _random;   // фиксированные seed: данные тестов одинаковы при каждом запуске
+
+    QByteArray randomData(int size, uint seed);
+    int randomInt();
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    // aes128:
+    void test_encryptData_data();
+    void test_encryptData();
+    void test_encryptData_Identical();
+    void test_encryptData_InPlace();
+    void test_allocations_data();
+    void test_allocations();
+    void test_encryptData_Parallel();
+    void test_bindKey();
+    void test_encryptDevice();
+    // aes128 ctr:
+    void test_ctr_data();
+    void test_ctr();
+    void test_ctr_InPlace();
+    void test_ctr_Tamper();
+    void test_ctr_Range();
+    void test_ctr_Device();
+    // md5:
+    void test_md5();
+    void test_md5Batch();
+    void test_md5BatchNested();
+    // crc:
+    void test_crc_Check();
+    void test_crc_Random();
+    void test_crc32_Large();
+    void test_crcModels();
+    void test_crcIncremental();
+    void test_crc32_Combine();
+};
+//==================================================================================================
+testCrypto::testCrypto()
+{
+
+}
+//==================================================================================================
+testCrypto::~testCrypto()
+{
+
+}
+//==================================================================================================
+QByteArray testCrypto::randomData(int size, uint seed)
+{
+    _random.seed(seed);
+    QByteArray res(size, 0);
+    for (int i=0; i<size; ++i) res[i] = static_cast<char>( _random() & 0xFF );
+    return res;
+}
+//==================================================================================================
+int testCrypto::randomInt()
+{
+    return static_cast<int>( _random() >> 1 );
+}
+//==================================================================================================
+void testCrypto::initTestCase()
+{
+
+}
+//==================================================================================================
+void testCrypto::cleanupTestCase()
+{
+
+}
+//==================================================================================================
+void testCrypto::test_encryptData_data()
+{
+    QTest::addColumn<int>("alg");
+    QTest::addColumn<QString>("data");
+    QTest::addColumn<QString>("key");
+    QTest::addColumn<QString>("result");
+
+    const QString str1 = "Hello, World!";
+    const QString res1 = "05e6dee031025dcc0e4f8425e48c804e";
+    const QString str2 = "The quick brown fox jumps over the lazy dog";
+    const QString res2 = "c30a75097c627bc77ce64c283dfffee4723e30b8fb779e06520e6b932874338d"
+                         "42de41c487eaa85e79d9e3aa077f5860";
+
+    QTest::newRow("compact short") << static_cast<int>(CryptoAlg_TexasAES128_Compact) << str1 << "secret" << res1;
+    QTest::newRow("compact long") << static_cast<int>(CryptoAlg_TexasAES128_Compact) << str2 << "secret" << res2;
+    QTest::newRow("table short") << static_cast<int>(CryptoAlg_TexasAES128) << str1 << "secret" << res1;
+    QTest::newRow("table long") << static_cast<int>(CryptoAlg_TexasAES128) << str2 << "secret" << res2;
+}
+//==================================================================================================
+void testCrypto::test_encryptData()
+{
+    QFETCH(int, alg);
+    QFETCH(QString, data);
+    QFETCH(QString, key);
+    QFETCH(QString, result);
+
+    Crypto crypto( static_cast<CryptoAlg>(alg) );
+    QString encrypted, decrypted;
+    QVERIFY( crypto.encryptData(data, key, encrypted) );
+    QCOMPARE( encrypted, result );
+    QVERIFY( crypto.decryptData(encrypted, key, decrypted) );
+    QCOMPARE( decrypted, data );
+}
+//==================================================================================================
+void testCrypto::test_encryptData_Identical()
+{
+    Crypto compact( CryptoAlg_TexasAES128_Compact );
+    Crypto table( CryptoAlg_TexasAES128 );
+
+    for (int size = 1; size < 600; size += 7) {
+        const QByteArray data = randomData(size, static_cast<uint>(size));
+        const QString key = QString("key %1").arg(size);
+        QByteArray res1, res2, dec1, dec2;
+
+        QVERIFY( compact.encryptData(data, key, res1) );
+        QVERIFY( table.encryptData(data, key, res2) );
+        QCOMPARE( res2, res1 );
+
+        QVERIFY( compact.decryptData(res1, key, dec1) );
+        QVERIFY( table.decryptData(res1, key, dec2) );
+        QCOMPARE( dec2, dec1 );
+        QCOMPARE( dec2.left(size), data );
+    }
+}
+//==================================================================================================
+void testCrypto::test_encryptData_InPlace()
+{
+    Crypto crypto;
+    const QByteArray data = randomData(1000, 7);
+    QByteArray res;
+    QVERIFY( crypto.encryptData(data, "secret", res) );
+    QCOMPARE( Crypto::encryptedSize(data.size()), static_cast<qint64>(1008) );
+
+    // сырой буфер, in-place
+    QByteArray buf = data;
+    buf.resize( static_cast<int>( Crypto::encryptedSize(data.size()) ) );
+    quint8 *ptr = reinterpret_cast<quint8*>( buf.data() );
+    QVERIFY( crypto.encryptRaw(ptr, data.size(), "secret", ptr) );
+    QCOMPARE( buf, res );
+    QVERIFY( crypto.decryptRaw(ptr, buf.size(), "secret", ptr) );
+    QCOMPARE( buf.left(data.size()), data );
+
+    // QByteArray in-place
+    buf = data;
+    QVERIFY( crypto.encryptInPlace(buf, "secret") );
+    QCOMPARE( buf, res );
+    QVERIFY( crypto.decryptInPlace(buf, "secret") );
+    QCOMPARE( buf.left(data.size()), data );
+
+    QVERIFY( !crypto.decryptRaw(ptr, 15, "secret", ptr) );
+    QVERIFY( !crypto.encryptRaw(ptr, 16, "", ptr) );
+}
+//==================================================================================================
+void testCrypto::test_allocations_data()
+{
+    QTest::addColumn<int>("mode");
+
+    QTest::newRow("QByteArray") << 0;
+    QTest::newRow("QByteArray preallocated") << 1;
+    QTest::newRow("quint8* in-place") << 2;
+}
+//==================================================================================================
+void testCrypto::test_allocations()
+{
+#ifndef COUNT_ALLOCS
+    QSKIP("Allocation counting requires glibc");
+#else
+    QFETCH(int, mode);
+
+    const int size = 1024 * 1024;
+    Crypto crypto;
+    const QByteArray data = randomData(size, 3);
+    QByteArray res;
+    QByteArray buf(data);
+    if (mode == 1) res.resize(size);
+    quint8 *ptr = reinterpret_cast<quint8*>( buf.data() );
+
+    const qint64 startCount = allocCount;
+    switch (mode) {
+    case 0:
+    case 1:
+        QVERIFY( crypto.encryptData(data, "secret", res) );
+        break;
+    default:
+        QVERIFY( crypto.encryptRaw(ptr, size, "secret", ptr) );
+        break;
+    }
+    const qint64 count = allocCount - startCount;
+
+    qInfo( "allocations per MB: %lld", count );
+    // ключ MD5 + (при необходимости) буфер результата, независимо от размера данных
+    QVERIFY( count < 16 );
+#endif
+}
+//==================================================================================================
+void testCrypto::test_encryptData_Parallel()
+{
+    Crypto single;
+    const QByteArray data = randomData(100003, 11);
+    QByteArray res, dec;
+    QVERIFY( single.encryptData(data, "secret", res) );
+
+    for (int threads = 1; threads <= 8; ++threads) {
+        Crypto crypto;
+        crypto.setParallelMode(true);
+        crypto.setParallelThreshold(1024);
+        crypto.setParallelThreadCount(threads);
+        QByteArray parallelRes;
+        QVERIFY( crypto.encryptData(data, "secret", parallelRes) );
+        QCOMPARE( parallelRes, res );
+        QVERIFY( crypto.decryptData(parallelRes, "secret", dec) );
+        QCOMPARE( dec.left(data.size()), data );
+    }
+}
+//==================================================================================================
+void testCrypto::test_bindKey()
+{
+    Crypto crypto;
+    QByteArray res, res2, dec;
+    const QByteArray data = randomData(100, 13);
+
+    QVERIFY( !crypto.isKeyBound() );
+    QVERIFY( !crypto.encryptBound(data, res) );
+    QVERIFY( !crypto.bindKey("") );
+
+    QVERIFY( crypto.encryptData(data, "secret", res) );
+    QVERIFY( crypto.bindKey("secret") );
+    QVERIFY( crypto.isKeyBound() );
+    QVERIFY( crypto.encryptBound(data, res2) );
+    QCOMPARE( res2, res );
+    QVERIFY( crypto.decryptBound(res2, dec) );
+    QCOMPARE( dec.left(data.size()), data );
+
+    // явный ключ, отличный от привязанного, не меняет привязку
+    QVERIFY( crypto.encryptData(data, "other", res) );
+    QVERIFY( res != res2 );
+    QVERIFY( crypto.encryptBound(data, res) );
+    QCOMPARE( res, res2 );
+
+    crypto.unbindKey();
+    QVERIFY( !crypto.isKeyBound() );
+    QVERIFY( !crypto.decryptBound(res2, dec) );
+}
+//==================================================================================================
+void testCrypto::test_encryptDevice()
+{
+    Crypto crypto;
+    const QByteArray data = randomData(100005, 19);
+    QByteArray res, dec;
+    QVERIFY( crypto.encryptData(data, "secret", res) );
+
+    QBuffer inBuf, outBuf;
+    inBuf.setData(data);
+    QVERIFY( inBuf.open(QIODevice::ReadOnly) );
+    QVERIFY( outBuf.open(QIODevice::WriteOnly) );
+    QVERIFY( crypto.encryptDevice(&inBuf, &outBuf, "secret", 4096) );
+    inBuf.close();
+    outBuf.close();
+    QCOMPARE( outBuf.data(), res );
+
+    // размер порции не кратен блоку - округляется вверх
+    inBuf.setData(res);
+    outBuf.setData(QByteArray());
+    QVERIFY( inBuf.open(QIODevice::ReadOnly) );
+    QVERIFY( outBuf.open(QIODevice::WriteOnly) );
+    QVERIFY( crypto.decryptDevice(&inBuf, &outBuf, "secret", 1000) );
+    inBuf.close();
+    outBuf.close();
+    QCOMPARE( outBuf.data().left(data.size()), data );
+
+    // неверная длина шифротекста
+    inBuf.setData(res.left(res.size() - 1));
+    outBuf.setData(QByteArray());
+    QVERIFY( inBuf.open(QIODevice::ReadOnly) );
+    QVERIFY( outBuf.open(QIODevice::WriteOnly) );
+    QVERIFY( !crypto.decryptDevice(&inBuf, &outBuf, "secret") );
+    inBuf.close();
+    outBuf.close();
+
+    // устройство не открыто
+    QVERIFY( !crypto.encryptDevice(&inBuf, &outBuf, "secret") );
+}
+//==================================================================================================
+void testCrypto::test_ctr_data()
+{
+    QTest::addColumn<int>("alg");
+
+    QTest::newRow("CTR") << static_cast<int>(CryptoAlg_AES128_CTR);
+    QTest::newRow("CTR_HMAC") << static_cast<int>(CryptoAlg_AES128_CTR_HMAC);
+}
+//==================================================================================================
+void testCrypto::test_ctr()
+{
+    QFETCH(int, alg);
+
+    Crypto crypto( static_cast<CryptoAlg>(alg) );
+    const qint64 overhead = Crypto::encryptedSize(0, crypto.algorythm());
+    QCOMPARE( overhead, static_cast<qint64>(alg == CryptoAlg_AES128_CTR ? 16 : 48) );
+
+    for (int size = 1; size < 600; size += 7) {
+        const QByteArray data = randomData(size, static_cast<uint>(size));
+        QByteArray res, res2, dec;
+
+        // без дополнения: размер = IV + данные (+ тег)
+        QVERIFY( crypto.encryptData(data, "secret", res) );
+        QCOMPARE( static_cast<qint64>(res.size()), size + overhead );
+        QVERIFY( crypto.decryptData(res, "secret", dec) );
+        QCOMPARE( dec, data );
+
+        // случайный IV: повторное шифрование дает другой результат
+        QVERIFY( crypto.encryptData(data, "secret", res2) );
+        QVERIFY( res2 != res );
+    }
+
+    // пробелы на концах строки сохраняются (trimmed() не нужен)
+    const QString str = "  The quick brown fox  ";
+    QString encrypted, decrypted;
+    QVERIFY( crypto.encryptData(str, "secret", encrypted) );
+    QVERIFY( crypto.decryptData(encrypted, "secret", decrypted) );
+    QCOMPARE( decrypted, str );
+
+    // параллельная генерация ключевого потока совместима с последовательной
+    const QByteArray data = randomData(100003, 11);
+    QByteArray res, dec;
+    Crypto parallel( static_cast<CryptoAlg>(alg) );
+    parallel.setParallelMode(true);
+    parallel.setParallelThreshold(1024);
+    parallel.setParallelThreadCount(4);
+    QVERIFY( parallel.encryptData(data, "secret", res) );
+    QVERIFY( crypto.decryptData(res, "secret", dec) );
+    QCOMPARE( dec, data );
+    QVERIFY( crypto.encryptData(data, "secret", res) );
+    QVERIFY( parallel.decryptData(res, "secret", dec) );
+    QCOMPARE( dec, data );
+
+    QVERIFY( !crypto.decryptData(res.left(static_cast<int>(overhead)), "secret", dec) );
+}
+//==================================================================================================
+void testCrypto::test_ctr_InPlace()
+{
+    Crypto crypto( CryptoAlg_AES128_CTR_HMAC );
+    const QByteArray data = randomData(1000, 7);
+    const int encSize = static_cast<int>( Crypto::encryptedSize(data.size(), crypto.algorythm()) );
+
+    // сырой буфер, in-place
+    QByteArray buf = data;
+    buf.resize( encSize );
+    quint8 *ptr = reinterpret_cast<quint8*>( buf.data() );
+    QVERIFY( crypto.encryptRaw(ptr, data.size(), "secret", ptr) );
+    QVERIFY( buf.left(data.size()) != data );
+    QVERIFY( crypto.decryptRaw(ptr, encSize, "secret", ptr) );
+    QCOMPARE( Crypto::decryptedSize(encSize, crypto.algorythm()), static_cast<qint64>(data.size()) );
+    QCOMPARE( buf.left(data.size()), data );
+
+    // QByteArray in-place
+    buf = data;
+    QVERIFY( crypto.encryptInPlace(buf, "secret") );
+    QCOMPARE( buf.size(), encSize );
+    QVERIFY( crypto.decryptInPlace(buf, "secret") );
+    QCOMPARE( buf, data );
+}
+//==================================================================================================
+void testCrypto::test_ctr_Tamper()
+{
+    Crypto crypto( CryptoAlg_AES128_CTR_HMAC );
+    const QByteArray data = randomData(300, 17);
+    QByteArray res, dec;
+    QVERIFY( crypto.encryptData(data, "secret", res) );
+
+    // любой измененный бит IV, шифротекста или тега отвергается до расшифровки
+    for (int i = 0; i < res.size(); i += 5) {
+        QByteArray damaged = res;
+        damaged[i] = static_cast<char>( damaged.at(i) ^ (1 << (i % 8)) );
+        dec = "unchanged";
+        QVERIFY( !crypto.decryptData(damaged, "secret", dec) );
+        QCOMPARE( dec, QByteArray("unchanged") );
+        QVERIFY( !crypto.lastError().isEmpty() );
+    }
+    QVERIFY( !crypto.decryptData(res, "wrong key", dec) );
+    QVERIFY( !crypto.decryptData(res.left(res.size() - 1), "secret", dec) );
+    QVERIFY( crypto.decryptData(res, "secret", dec) );
+    QCOMPARE( dec, data );
+
+    // без HMAC подмена не обнаруживается, но меняет ровно измененный байт
+    Crypto plain( CryptoAlg_AES128_CTR );
+    QVERIFY( plain.encryptData(data, "secret", res) );
+    res[20] = static_cast<char>( res.at(20) ^ 0x01 );
+    QVERIFY( plain.decryptData(res, "secret", dec) );
+    QCOMPARE( static_cast<quint8>(dec.at(4) ^ data.at(4)), static_cast<quint8>(0x01) );
+    QCOMPARE( dec.mid(5), data.mid(5) );
+}
+//==================================================================================================
+void testCrypto::test_ctr_Range()
+{
+    const QByteArray data = randomData(100000, 23);
+    Crypto ecb;
+    QByteArray res, part;
+    QVERIFY( ecb.encryptData(data, "secret", res) );
+    QVERIFY( !ecb.decryptRange(res, 0, 16, "secret", part) );
+
+    const QVector<CryptoAlg> algs { CryptoAlg_AES128_CTR, CryptoAlg_AES128_CTR_HMAC };
+    for (CryptoAlg alg: algs) {
+        Crypto crypto( alg );
+        QVERIFY( crypto.encryptData(data, "secret", res) );
+        QVERIFY( crypto.bindKey("secret") );
+
+        _random.seed(29);
+        for (int i = 0; i < 200; ++i) {
+            const int offset = randomInt() % data.size();
+            const int length = randomInt() % (data.size() - offset + 1);
+            QVERIFY( crypto.decryptRange(res, offset, length, part) );
+            QCOMPARE( part, data.mid(offset, length) );
+        }
+        QVERIFY( crypto.decryptRange(res, data.size(), 0, part) );
+        QVERIFY( part.isEmpty() );
+        QVERIFY( !crypto.decryptRange(res, data.size() - 10, 11, part) );
+        QVERIFY( !crypto.decryptRange(res, -1, 10, part) );
+    }
+}
+//==================================================================================================
+void testCrypto::test_ctr_Device()
+{
+    const QVector<CryptoAlg> algs { CryptoAlg_AES128_CTR, CryptoAlg_AES128_CTR_HMAC };
+    const QByteArray data = randomData(100005, 19);
+
+    for (CryptoAlg alg: algs) {
+        Crypto crypto( alg );
+        QBuffer inBuf, outBuf;
+        inBuf.setData(data);
+        QVERIFY( inBuf.open(QIODevice::ReadOnly) );
+        QVERIFY( outBuf.open(QIODevice::WriteOnly) );
+        QVERIFY( crypto.encryptDevice(&inBuf, &outBuf, "secret", 4096) );
+        inBuf.close();
+        outBuf.close();
+        const QByteArray res = outBuf.data();
+        QCOMPARE( static_cast<qint64>(res.size()), Crypto::encryptedSize(data.size(), alg) );
+
+        // результат потокового шифрования читается обычной расшифровкой и наоборот
+        QByteArray dec;
+        QVERIFY( crypto.decryptData(res, "secret", dec) );
+        QCOMPARE( dec, data );
+
+        inBuf.setData(res);
+        outBuf.setData(QByteArray());
+        QVERIFY( inBuf.open(QIODevice::ReadOnly) );
+        QVERIFY( outBuf.open(QIODevice::WriteOnly) );
+        QVERIFY( crypto.decryptDevice(&inBuf, &outBuf, "secret", 1000) );
+        inBuf.close();
+        outBuf.close();
+        QCOMPARE( outBuf.data(), data );
+
+        if (alg != CryptoAlg_AES128_CTR_HMAC) continue;
+
+        // поврежденный поток: тег проверяется до записи результата
+        QByteArray damaged = res;
+        damaged[50000] = static_cast<char>( damaged.at(50000) ^ 0x80 );
+        inBuf.setData(damaged);
+        outBuf.setData(QByteArray());
+        QVERIFY( inBuf.open(QIODevice::ReadOnly) );
+        QVERIFY( outBuf.open(QIODevice::WriteOnly) );
+        QVERIFY( !crypto.decryptDevice(&inBuf, &outBuf, "secret", 1000) );
+        inBuf.close();
+        outBuf.close();
+        QVERIFY( outBuf.data().isEmpty() );
+    }
+}
+//==================================================================================================
+void testCrypto::test_md5()
+{
+    QCOMPARE( Crypto::md5(""), QString("d41d8cd98f00b204e9800998ecf8427e") );
+    QCOMPARE( Crypto::md5("abc"), QString("900150983cd24fb0d6963f7d28e17f72") );
+    QCOMPARE( Crypto::md5("The quick brown fox jumps over the lazy dog"), QString("9e107d9d372bb6826bd81d3542a419d6") );
+    QCOMPARE( Crypto::md5(QString::fromUtf8("Привет")), QString::fromLatin1(
+                  QCryptographicHash::hash( QString::fromUtf8("Привет").toUtf8(), QCryptographicHash::Md5 ).toHex() ) );
+
+    // все варианты хвоста (один или два завершающих блока)
+    for (int size = 0; size < 300; ++size) {
+        const QString str = QString::fromLatin1( randomData(size, static_cast<uint>(size)).toHex() ).left(size);
+        const QByteArray expected = QCryptographicHash::hash( str.toUtf8(), QCryptographicHash::Md5 );
+        QCOMPARE( Crypto::md5Bytes(str), expected );
+        QCOMPARE( Crypto::md5(str), QString::fromLatin1(expected.toHex()) );
+    }
+}
+//==================================================================================================
+void testCrypto::test_md5Batch()
+{
+    QList<QByteArray> keys;
+    QStringList strKeys;
+    for (int i = 0; i < 5000; ++i) {
+        keys.append( QByteArray("key-") + QByteArray::number(i) + randomData(i % 100, static_cast<uint>(i)).toHex() );
+        strKeys.append( QString::fromLatin1(keys.last()) );
+    }
+
+    QByteArray bin, hex;
+    for (int threads = 0; threads <= 4; ++threads) {
+        Crypto::md5Batch(keys, bin, false, threads);
+        Crypto::md5Batch(keys, hex, true, threads);
+        QCOMPARE( bin.size(), keys.size() * 16 );
+        QCOMPARE( hex.size(), keys.size() * 32 );
+        for (int i = 0; i < keys.size(); ++i) {
+            QCOMPARE( bin.mid(i * 16, 16), QCryptographicHash::hash( keys.at(i), QCryptographicHash::Md5 ) );
+            QCOMPARE( QString::fromLatin1(hex.mid(i * 32, 32)), Crypto::md5(strKeys.at(i)) );
+        }
+    }
+
+    QByteArray fromStrings;
+    Crypto::md5Batch(strKeys, fromStrings, true, 0);
+    QCOMPARE( fromStrings, hex );
+
+    Crypto::md5Batch(QList<QByteArray>(), bin);
+    QVERIFY( bin.isEmpty() );
+}
+//==================================================================================================
+void testCrypto::test_md5BatchNested()
+{
+    QList<QByteArray> keys;
+    for (int i = 0; i < 4096; ++i) keys.append( QByteArray("nested-") + QByteArray::number(i) );
+    QByteArray expected;
+    Crypto::md5Batch(keys, expected, false, 1);
+
+    class BatchTask : public QRunnable
+    {
+    public:
+        BatchTask(const QList<QByteArray> &keys, QByteArray *out, QSemaphore *done)
+            : _keys(keys), _out(out), _done(done) {}
+        void run() override
+        {
+            Crypto::md5Batch(_keys, *_out, false, 4);
+            _done->release();
+        }
+    private:
+        const QList<QByteArray> &_keys;
+        QByteArray *_out;
+        QSemaphore *_done;
+    };
+
+    // все потоки пула заняты задачами, которые сами запускают параллельный подсчет
+    QList<QThreadPool*> pools { QThreadPool::globalInstance(), parallelPool() };
+    for (QThreadPool *pool: pools) {
+        const int count = pool->maxThreadCount() * 2;
+        QVector<QByteArray> results(count);
+        QSemaphore done;
+        for (int i = 0; i < count; ++i) pool->start( new BatchTask(keys, &results[i], &done) );
+        QVERIFY( done.tryAcquire(count, 60000) );
+        for (const QByteArray &result: results) QCOMPARE( result, expected );
+    }
+}
+//==================================================================================================
+void testCrypto::test_crc_Check()
+{
+    const QByteArray check = "123456789";
+    const QVector<quint8> vec { '1', '2', '3', '4', '5', '6', '7', '8', '9' };
+    const quint8 *ptr = reinterpret_cast<const quint8*>( check.constData() );
+
+    QCOMPARE( Crypto::crc8_Dallas(check), static_cast<quint8>(0xA1) );
+    QCOMPARE( Crypto::crc8_Dallas(vec), static_cast<quint8>(0xA1) );
+    QCOMPARE( Crypto::crc8_Dallas(ptr, 9), static_cast<quint8>(0xA1) );
+    QCOMPARE( Crypto::crc8(check), static_cast<quint8>(0xF7) );
+    QCOMPARE( Crypto::crc8(vec), static_cast<quint8>(0xF7) );
+    QCOMPARE( Crypto::crc8(ptr, 9), static_cast<quint8>(0xF7) );
+    QCOMPARE( Crypto::crc16_Ccitt(check), static_cast<quint16>(0x29B1) );
+    QCOMPARE( Crypto::crc16_Ccitt(vec), static_cast<quint16>(0x29B1) );
+    QCOMPARE( Crypto::crc16_Ccitt(ptr, 9), static_cast<quint16>(0x29B1) );
+    QCOMPARE( Crypto::crc16(check), static_cast<quint16>(0xBB3D) );
+    QCOMPARE( Crypto::crc16(vec), static_cast<quint16>(0xBB3D) );
+    QCOMPARE( Crypto::crc16(ptr, 9), static_cast<quint16>(0x4B37) ); // начальное значение 0xFFFF
+    QCOMPARE( Crypto::crc16_Arc(check), static_cast<quint16>(0x4B37) );
+    QCOMPARE( Crypto::crc16_Arc(vec), static_cast<quint16>(0x4B37) );
+    QCOMPARE( Crypto::crc16_Arc(ptr, 9), static_cast<quint16>(0x4B37) );
+    QCOMPARE( Crypto::crc16_Wmbus(check), static_cast<quint16>(0xC2B7) );
+    QCOMPARE( Crypto::crc16_Wmbus(vec), static_cast<quint16>(0xC2B7) );
+    QCOMPARE( Crypto::crc16_Wmbus(ptr, 9), static_cast<quint16>(0xC2B7) );
+    QCOMPARE( Crypto::crc32(check), static_cast<quint32>(0xCBF43926) );
+    QCOMPARE( Crypto::crc32(vec), static_cast<quint32>(0xCBF43926) );
+    QCOMPARE( Crypto::crc32(ptr, 9), static_cast<quint32>(0xCBF43926) );
+    QCOMPARE( Crypto::crc16_Modbus(check), static_cast<quint16>(0x4B37) );
+    QCOMPARE( Crypto::crc16_Modbus(vec), static_cast<quint16>(0x4B37) );
+    QCOMPARE( Crypto::crc16_Modbus(ptr, 9), static_cast<quint16>(0x4B37) );
+    QCOMPARE( Crypto::crc32C(check), static_cast<quint32>(0xE3069283) );
+    QCOMPARE( Crypto::crc32C(vec), static_cast<quint32>(0xE3069283) );
+    QCOMPARE( Crypto::crc32C(ptr, 9), static_cast<quint32>(0xE3069283) );
+}
+//==================================================================================================
+void testCrypto::test_crcModels()
+{
+    // контрольные значения по каталогу CRC (reveng), в т.ч. ширина не кратная 8 и RefIn != RefOut
+    const QByteArray check = "123456789";
+
+    QCOMPARE( Crc8_Maxim::calc(check), static_cast<quint8>(0xA1) );
+    QCOMPARE( Crc8_Nrsc5::calc(check), static_cast<quint8>(0xF7) );
+    QCOMPARE( Crc8_Smbus::calc(check), static_cast<quint8>(0xF4) );
+    QCOMPARE( Crc16_Ibm3740::calc(check), static_cast<quint16>(0x29B1) );
+    QCOMPARE( Crc16_Xmodem::calc(check), static_cast<quint16>(0x31C3) );
+    QCOMPARE( Crc16_Kermit::calc(check), static_cast<quint16>(0x2189) );
+    QCOMPARE( Crc16_IbmSdlc::calc(check), static_cast<quint16>(0x906E) );
+    QCOMPARE( Crc16_Arc::calc(check), static_cast<quint16>(0xBB3D) );
+    QCOMPARE( Crc16_Modbus::calc(check), static_cast<quint16>(0x4B37) );
+    QCOMPARE( Crc16_En13757::calc(check), static_cast<quint16>(0xC2B7) );
+    QCOMPARE( Crc16_Dnp::calc(check), static_cast<quint16>(0xEA82) );
+    QCOMPARE( Crc32_IsoHdlc::calc(check), static_cast<quint32>(0xCBF43926) );
+    QCOMPARE( Crc32_Mpeg2::calc(check), static_cast<quint32>(0x0376E6E7) );
+    QCOMPARE( Crc32C::calc(check), static_cast<quint32>(0xE3069283) );
+
+    QCOMPARE( (CrcModel<5, 0x05, 0x1F, true, true, 0x1F>::calc(check)), static_cast<quint8>(0x19) );           // CRC-5/USB
+    QCOMPARE( (CrcModel<7, 0x09, 0x00, false, false, 0x00>::calc(check)), static_cast<quint8>(0x75) );         // CRC-7/MMC
+    QCOMPARE( (CrcModel<12, 0x80F, 0x000, false, true, 0x000>::calc(check)), static_cast<quint16>(0xDAF) );    // CRC-12/UMTS
+    QCOMPARE( (CrcModel<15, 0x4599, 0x0000, false, false, 0x0000>::calc(check)), static_cast<quint16>(0x059E) ); // CRC-15/CAN
+    QCOMPARE( (CrcModel<24, 0x864CFB, 0xB704CE, false, false, 0x000000>::calc(check)), static_cast<quint32>(0x21CF02) ); // CRC-24/OPENPGP
+    QCOMPARE( (CrcModel<64, Q_UINT64_C(0x42F0E1EBA9EA3693), ~Q_UINT64_C(0), true, true, ~Q_UINT64_C(0)>::calc(check)),
+              Q_UINT64_C(0x995DC9BBDF1939FA) ); // CRC-64/XZ
+
+    // накопительный подсчет через init/update/finalize
+    const QByteArray data = randomData(1000, 53);
+    const quint8 *ptr = reinterpret_cast<const quint8*>( data.constData() );
+    quint16 reg = Crc16_Dnp::init();
+    reg = Crc16_Dnp::update( reg, ptr, 333 );
+    reg = Crc16_Dnp::update( reg, ptr + 333, data.size() - 333 );
+    QCOMPARE( Crc16_Dnp::finalize(reg), Crc16_Dnp::calc(data) );
+}
+//==================================================================================================
+void testCrypto::test_crc_Random()
+{
+    // побитовые эталоны для сравнения с табличными реализациями
+    auto bitsReflected = [](const QByteArray &data, quint32 poly, quint32 crc) {
+        for (char c: data) {
+            crc ^= static_cast<quint8>(c);
+            for (int i=0; i<8; ++i) crc = (crc & 1) ? (crc >> 1) ^ poly : crc >> 1;
+        }
+        return crc;
+    };
+    auto bitsNormal = [](const QByteArray &data, int width, quint32 poly, quint32 crc) {
+        const quint32 top = 1u << (width - 1);
+        const quint32 mask = (width == 32) ? 0xFFFFFFFF : (1u << width) - 1;
+        for (char c: data) {
+            crc ^= static_cast<quint32>(static_cast<quint8>(c)) << (width - 8);
+            for (int i=0; i<8; ++i) crc = ((crc & top) ? (crc << 1) ^ poly : crc << 1) & mask;
+        }
+        return crc;
+    };
+
+    for (int size = 0; size < 300; ++size) {
+        const QByteArray full = randomData(size + 7, static_cast<uint>(size));
+        for (int offset = 0; offset < 8; offset += 3) {
+            const QByteArray data = full.mid(offset, size);
+            QCOMPARE( static_cast<quint32>(Crypto::crc8_Dallas(data)), bitsReflected(data, 0x8C, 0x00) );
+            QCOMPARE( static_cast<quint32>(Crypto::crc8(data)), bitsNormal(data, 8, 0x31, 0xFF) );
+            QCOMPARE( static_cast<quint32>(Crypto::crc16_Ccitt(data)), bitsNormal(data, 16, 0x1021, 0xFFFF) );
+            QCOMPARE( static_cast<quint32>(Crypto::crc16(data)), bitsReflected(data, 0xA001, 0x0000) );
+            QCOMPARE( static_cast<quint32>(Crypto::crc16_Arc(data)), bitsReflected(data, 0xA001, 0xFFFF) );
+            QCOMPARE( static_cast<quint32>(Crypto::crc16_Wmbus(data)), bitsNormal(data, 16, 0x3D65, 0x0000) ^ 0xFFFF );
+            QCOMPARE( Crypto::crc32(data), bitsReflected(data, 0xEDB88320, 0xFFFFFFFF) ^ 0xFFFFFFFF );
+        }
+    }
+}
+//==================================================================================================
+void testCrypto::test_crc32_Large()
+{
+    // длины и выравнивания, проходящие через аппаратную свертку (>= 64 байт) и табличный хвост
+    const QByteArray full = randomData(20000 + 16, 29);
+    _random.seed(31);
+    for (int i = 0; i < 500; ++i) {
+        const int offset = i % 16;
+        const int size = (i < 100) ? i : randomInt() % 20000;
+        const quint8 *data = reinterpret_cast<const quint8*>( full.constData() ) + offset;
+
+        quint32 crc = 0xFFFFFFFF;
+        for (int n = 0; n < size; ++n) {
+            crc ^= data[n];
+            for (int bit = 0; bit < 8; ++bit) crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : crc >> 1;
+        }
+        QCOMPARE( Crypto::crc32(data, size), crc ^ 0xFFFFFFFF );
+    }
+}
+//==================================================================================================
+void testCrypto::test_crcIncremental()
+{
+    const QByteArray data = randomData(5000, 37);
+    const QVector<CrcAlg> algs { CrcAlg_8_Dallas, CrcAlg_8, CrcAlg_16_Ccitt, CrcAlg_16,
+                                 CrcAlg_16_Arc, CrcAlg_16_Wmbus, CrcAlg_32, CrcAlg_32C };
+    const QVector<quint32> whole {
+        Crypto::crc8_Dallas(data), Crypto::crc8(data), Crypto::crc16_Ccitt(data), Crypto::crc16(data),
+        Crypto::crc16_Arc(data), Crypto::crc16_Wmbus(data), Crypto::crc32(data), Crypto::crc32C(data)
+    };
+
+    _random.seed(41);
+    for (int i = 0; i < algs.size(); ++i) {
+        Crc crc(algs.at(i));
+        for (int pass = 0; pass < 20; ++pass) {
+            // случайное разбиение на части, в т.ч. пустые и меньше 16 байт
+            int pos = 0;
+            while (pos < data.size()) {
+                const int len = qMin( data.size() - pos, (randomInt() % 2) ? randomInt() % 16 : randomInt() % 1000 );
+                crc.update( data.mid(pos, len) );
+                pos += len;
+            }
+            QCOMPARE( crc.value(), whole.at(i) );
+            crc.reset();
+        }
+        QCOMPARE( crc.value(), Crc(algs.at(i)).value() );
+    }
+}
+//==================================================================================================
+void testCrypto::test_crc32_Combine()
+{
+    const QByteArray data = randomData(20000, 43);
+    _random.seed(47);
+    for (int i = 0; i < 200; ++i) {
+        const int size = randomInt() % data.size();
+        const int split = (size > 0) ? randomInt() % (size + 1) : 0;
+        const QByteArray a = data.left(split);
+        const QByteArray b = data.mid(split, size - split);
+        QCOMPARE( Crc::combine(Crypto::crc32(a), Crypto::crc32(b), b.size()), Crypto::crc32(data.left(size)) );
+    }
+}
+//==================================================================================================
+
+QTEST_APPLESS_MAIN(testCrypto)
+
+#include "tst_testcrypto.moc"
@@ -0,0 +1,21 @@
+QT += testlib network
+QT -= gui
+
+CONFIG += qt console warn_on depend_includepath testcase c++14
+CONFIG -= app_bundle
+
+TEMPLATE = app
+
+SOURCES +=  tst_testhttp.cpp
+
+INCLUDEPATH *= $${PWD}/../../inc \
+        $${PWD}/../../src
+
+HEADERS *= $${PWD}/../../inc/http.h \
+           $${PWD}/../../inc/http_server.h \
+           $${PWD}/../../inc/http_listener.h \
+           $${PWD}/../../inc/fastcgi_server.h
+
+SOURCES *= $${PWD}/../../src/http_server.cpp \
+           $${PWD}/../../src/http_listener.cpp \
+           $${PWD}/../../src/fastcgi_server.cpp
@@ -0,0 +1,858 @@
+#include <QtTest>
+#include <QByteArray>
+#include <QFile>
+#include <QDir>
+#include <QTemporaryDir>
+#include <QThread>
+#include <QFileInfo>
+#include <QTcpSocket>
+#ifdef Q_OS_UNIX
+#include <csignal>
+#include <unistd.h>
+#endif
+#include "http_server.h"
+#include "http_listener.h"
+#include "fastcgi_server.h"
+
+using namespace nayk;
+
+//==================================================================================================
+const QByteArray boundary = "----nayk7MA4YWxkTrZu0gW";
+
+//==================================================================================================
+// Запрос multipart/form-data с заданным переводом строки; file - содержимое файловой части
+static QByteArray multipartBody(const QByteArray &endl, const QByteArray &file)
+{
+    const QByteArray dash = "--" + boundary;
+    return "preamble" + endl
+            + dash + endl
+            + "Content-Disposition: form-data; name=\"text\"" + endl + endl
+            + "  hello  " + endl
+            + dash + endl
+            + "content-disposition: form-data; name=\"flag\"" + endl + endl
+            + " " + endl
+            + dash + endl
+            + "Content-Disposition: form-data; name=\"file\"; filename=\"a;b.bin\"" + endl
+            + "Content-Type: image/png" + endl + endl
+            + file + endl
+            + dash + endl
+            + "Content-Disposition: form-data; name=bin" + endl
+            + "Content-Transfer-Encoding: binary" + endl + endl
+            + QByteArray("\x00\x01\x02", 3) + endl
+            + dash + endl
+            + "Content-Disposition: form-data; name=\"json\"" + endl
+            + "Content-Type: application/json" + endl + endl
+            + "{\"a\":1}" + endl
+            + dash + endl
+            + "Content-Disposition: form-data" + endl + endl
+            + "unnamed" + endl
+            + dash + "--" + endl;
+}
+//==================================================================================================
+static QMap<QString, QString> multipartHeaders(int length, const QString &contentType)
+{
+    QMap<QString, QString> headers;
+    headers.insert(ServerHeaderRequestMethod, MethodPost);
+    headers.insert(ServerHeaderContentType, contentType);
+    headers.insert(ServerHeaderContentLength, QString::number(length));
+    return headers;
+}
+//==================================================================================================
+#ifdef Q_OS_UNIX
+// CGI-запрос: stdin подменяется каналом, в который отдельный поток (веб-сервер) пишет
+// содержимое кусками по step байт, так что чтения делят его в произвольных местах
+static bool readCgiRequest(HttpServer &http, const QByteArray &body, int step, const QString &contentType)
+{
+    ::signal(SIGPIPE, SIG_IGN);
+    qputenv("REQUEST_METHOD", MethodPost.toLatin1());
+    qputenv("CONTENT_TYPE", contentType.toLatin1());
+    qputenv("CONTENT_LENGTH", QByteArray::number(body.size()));
+    const int savedStdin = ::dup(STDIN_FILENO);
+    int fds[2];
+    if (::pipe(fds) != 0) return false;
+    ::dup2(fds[0], STDIN_FILENO);
+    ::close(fds[0]);
+
+    const int fd = fds[1];
+    QThread *writer = QThread::create([&body, fd, step]() {
+        for (int pos = 0; pos < body.size(); ) {
+            const ssize_t n = ::write(fd, body.constData() + pos, static_cast<size_t>(qMin(step, body.size() - pos)));
+            if (n <= 0) break;
+            pos += static_cast<int>(n);
+        }
+        ::close(fd);
+    });
+    writer->start();
+
+    bool ok = false;
+    http.readRequest(&ok);
+
+    // закрытие канала со стороны чтения не дает писателю зависнуть после ошибки разбора
+    // (write() вернет EPIPE)
+    ::dup2(savedStdin, STDIN_FILENO);
+    ::close(savedStdin);
+    writer->wait();
+    delete writer;
+    qunsetenv("REQUEST_METHOD");
+    qunsetenv("CONTENT_TYPE");
+    qunsetenv("CONTENT_LENGTH");
+    return ok;
+}
+#endif
+//==================================================================================================
+// Обработчик встроенного HTTP-сервера: в ответе "метод|QUERY_STRING|HTTP_COOKIE|содержимое"
+static void echoRequest(HttpServer *http)
+{
+    bool ok;
+    http->readRequest(&ok);
+    http->setResponseContentType(ContentTypeText);
+    http->setResponseContent( (http->requestHeader(ServerHeaderRequestMethod) + "|"
+                               + http->requestHeader(ServerHeaderQueryString) + "|"
+                               + http->requestHeader(ServerHeaderHttpCookie) + "|").toUtf8()
+                              + http->requestContent() );
+    http->writeResponse(&ok);
+}
+//==================================================================================================
+// Читает один ответ HTTP: заголовок и тело по Content-Length (у ответа на HEAD тела нет),
+// остаток оставляет в буфере
+static bool readHttpResponse(QTcpSocket *socket, QByteArray &buffer, QByteArray &head, QByteArray &body,
+                             bool headRequest = false)
+{
+    forever {
+        const int end = buffer.indexOf("\r\n\r\n");
+        if (end >= 0) {
+            const QByteArray lower = buffer.left(end + 2).toLower();
+            const int n = lower.indexOf("\r\ncontent-length:");
+            const int length = (headRequest || (n < 0)) ? 0
+                             : lower.mid(n + 17, lower.indexOf("\r\n", n + 2) - n - 17).trimmed().toInt();
+            if (buffer.size() >= (end + 4 + length)) {
+                head = buffer.left(end + 4);
+                body = buffer.mid(end + 4, length);
+                buffer.remove(0, end + 4 + length);
+                return true;
+            }
+        }
+        if (!socket->waitForReadyRead(5000)) return false;
+        buffer.append( socket->readAll() );
+    }
+}
+//==================================================================================================
+// Клиентская сторона FastCGI (то, что делает веб-сервер):
+struct FcgiRecord
+{
+    quint8 type;
+    quint16 id;
+    QByteArray content;
+};
+
+static QByteArray fcgiRecord(quint8 type, quint16 id, const QByteArray &content)
+{
+    QByteArray rec;
+    rec.append( static_cast<char>(1) );
+    rec.append( static_cast<char>(type) );
+    rec.append( static_cast<char>(id >> 8) );
+    rec.append( static_cast<char>(id & 0xFF) );
+    rec.append( static_cast<char>(content.size() >> 8) );
+    rec.append( static_cast<char>(content.size() & 0xFF) );
+    rec.append( static_cast<char>(0) );
+    rec.append( static_cast<char>(0) );
+    rec.append( content );
+    return rec;
+}
+//==================================================================================================
+static QByteArray fcgiBegin(quint16 id, quint16 role, bool keepConn)
+{
+    QByteArray body(8, 0);
+    body[0] = static_cast<char>(role >> 8);
+    body[1] = static_cast<char>(role & 0xFF);
+    body[2] = keepConn ? 1 : 0;
+    return fcgiRecord(1, id, body);
+}
+//==================================================================================================
+// пары имя-значение (имена и значения короче 128 байт) одной записью FCGI_PARAMS
+static QByteArray fcgiParams(const QMap<QString, QString> &params)
+{
+    QByteArray data;
+    for (auto itr = params.constBegin(); itr != params.constEnd(); ++itr) {
+        const QByteArray name = itr.key().toLatin1();
+        const QByteArray value = itr.value().toUtf8();
+        data.append( static_cast<char>(name.size()) );
+        data.append( static_cast<char>(value.size()) );
+        data.append( name );
+        data.append( value );
+    }
+    return data;
+}
+//==================================================================================================
+// запрос целиком: FCGI_BEGIN_REQUEST, FCGI_PARAMS и FCGI_STDIN с пустыми записями окончания
+static QByteArray fcgiRequest(quint16 id, bool keepConn, const QString &query, const QByteArray &content = QByteArray())
+{
+    QMap<QString, QString> params;
+    params.insert(ServerHeaderRequestMethod, content.isEmpty() ? MethodGet : MethodPost);
+    params.insert(ServerHeaderQueryString, query);
+    if (!content.isEmpty()) {
+        params.insert(ServerHeaderContentType, ContentTypeText);
+        params.insert(ServerHeaderContentLength, QString::number(content.size()));
+    }
+    return fcgiBegin(id, 1, keepConn)
+            + fcgiRecord(4, id, fcgiParams(params)) + fcgiRecord(4, id, QByteArray())
+            + (content.isEmpty() ? QByteArray() : fcgiRecord(5, id, content)) + fcgiRecord(5, id, QByteArray());
+}
+//==================================================================================================
+static bool readFcgiRecord(QTcpSocket *socket, QByteArray &buffer, FcgiRecord &rec)
+{
+    forever {
+        if (buffer.size() >= 8) {
+            const uchar *h = reinterpret_cast<const uchar*>( buffer.constData() );
+            const int contentLength = (h[4] << 8) | h[5];
+            const int recordLength = 8 + contentLength + h[6];
+            if (buffer.size() >= recordLength) {
+                rec.type = h[1];
+                rec.id = static_cast<quint16>( (h[2] << 8) | h[3] );
+                rec.content = buffer.mid(8, contentLength);
+                buffer.remove(0, recordLength);
+                return true;
+            }
+        }
+        if (!socket->waitForReadyRead(5000)) return false;
+        buffer.append( socket->readAll() );
+    }
+}
+//==================================================================================================
+// Читает записи до FCGI_END_REQUEST запроса id: FCGI_STDOUT и protocolStatus;
+// записи других запросов - ошибка
+static bool readFcgiResponse(QTcpSocket *socket, QByteArray &buffer, quint16 id, QByteArray &out, int &status)
+{
+    out.clear();
+    FcgiRecord rec;
+    while (readFcgiRecord(socket, buffer, rec)) {
+        if (rec.id != id) return false;
+        if (rec.type == 6) out.append( rec.content );
+        else if (rec.type == 3) {
+            status = (rec.content.size() == 8) ? static_cast<uchar>(rec.content.at(4)) : -1;
+            return true;
+        }
+        else return false;
+    }
+    return false;
+}
+//==================================================================================================
+class testHttp : public QObject
+{
+    Q_OBJECT
+
+public:
+    testHttp();
+    ~testHttp();
+
+private:
+    QThread _thread;
+    HttpListener *_listener {nullptr};
+    quint16 _httpPort {0};
+    quint16 _fcgiPort {0};
+    bool connectListener(QTcpSocket &socket);
+    bool connectFastCgi(QTcpSocket &socket);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    //
+    void test_multipart_data();
+    void test_multipart();
+    void test_multipartShared();
+    void test_multipartBadJson();
+    void test_multipartToFiles();
+    void test_multipartFieldLimit();
+    void test_multipartStdin_data();
+    void test_multipartStdin();
+    void test_multipartStdinError();
+    // listener:
+    void test_listenerChunked();
+    void test_listenerPipeline();
+    void test_listenerHttp10();
+    void test_listenerHead();
+    void test_listenerContinue();
+    void test_listenerErrors_data();
+    void test_listenerErrors();
+    void test_listenerCookies();
+    void test_listenerMaxContent();
+    // fastcgi:
+    void test_fastCgiMultiplexed();
+    void test_fastCgiAbort();
+    void test_fastCgiManagement();
+    void test_fastCgiUnknownRole();
+    void test_fastCgiLimits();
+    void test_fastCgiClose();
+};
+//==================================================================================================
+testHttp::testHttp()
+{
+
+}
+//==================================================================================================
+testHttp::~testHttp()
+{
+
+}
+//==================================================================================================
+void testHttp::initTestCase()
+{
+    // встроенный HTTP-сервер живет в своем потоке со своим циклом событий, клиент - в основном
+    _listener = new HttpListener();
+    _listener->moveToThread(&_thread);
+    connect(&_thread, &QThread::finished, _listener, &QObject::deleteLater);
+    connect(_listener, &HttpListener::newRequest, _listener, [](HttpServer *http) { echoRequest(http); });
+    _thread.start();
+
+    bool ok = false;
+    QMetaObject::invokeMethod(_listener, [this, &ok]() {
+        _listener->setHeaderTimeout(300);
+        _listener->setMaxContentLength(1024);
+        // FastCGI-сервер - дочерний к HttpListener (удаляется вместе с ним)
+        FastCgiServer *fcgi = new FastCgiServer(_listener);
+        connect(fcgi, &FastCgiServer::newRequest, fcgi, [](HttpServer *http) { echoRequest(http); });
+        fcgi->setMaxContentLength(1024);
+        ok = _listener->listen(QHostAddress::LocalHost, 0) && fcgi->listen(QHostAddress::LocalHost, 0);
+        _httpPort = _listener->serverPort();
+        _fcgiPort = fcgi->serverPort();
+    }, Qt::BlockingQueuedConnection);
+    QVERIFY( ok );
+}
+//==================================================================================================
+void testHttp::cleanupTestCase()
+{
+    _thread.quit();
+    _thread.wait();
+}
+//==================================================================================================
+bool testHttp::connectListener(QTcpSocket &socket)
+{
+    socket.connectToHost(QHostAddress::LocalHost, _httpPort);
+    return socket.waitForConnected(5000);
+}
+//==================================================================================================
+bool testHttp::connectFastCgi(QTcpSocket &socket)
+{
+    socket.connectToHost(QHostAddress::LocalHost, _fcgiPort);
+    return socket.waitForConnected(5000);
+}
+//==================================================================================================
+void testHttp::test_multipart_data()
+{
+    QTest::addColumn<QByteArray>("endl");
+    QTest::addColumn<QString>("contentType");
+    QTest::addColumn<bool>("single");
+
+    const QString type = ContentTypeMultipartForm + "; boundary=" + QString::fromLatin1(boundary);
+    const QString quoted = ContentTypeMultipartForm + "; charset=utf-8; boundary=\"" + QString::fromLatin1(boundary) + "\"";
+    QTest::newRow("crlf") << QByteArray("\r\n") << type << false;
+    QTest::newRow("lf") << QByteArray("\n") << type << false;
+    QTest::newRow("cr") << QByteArray("\r") << type << false;
+    QTest::newRow("quoted boundary") << QByteArray("\r\n") << quoted << false;
+    // единственный разделитель с переводом строки после него - первый, без преамбулы
+    QTest::newRow("lf single part") << QByteArray("\n") << type << true;
+    QTest::newRow("cr single part") << QByteArray("\r") << type << true;
+}
+//==================================================================================================
+void testHttp::test_multipart()
+{
+    QFETCH(QByteArray, endl);
+    QFETCH(QString, contentType);
+    QFETCH(bool, single);
+
+    const QByteArray file = "PNG\r\n--not-a-boundary\r\n" + QByteArray(1000, 'x');
+    const QByteArray body = single ? "--" + boundary + endl
+                                     + "Content-Disposition: form-data; name=\"text\"" + endl + endl
+                                     + "hello" + endl
+                                     + "--" + boundary + "--" + endl
+                                   : multipartBody(endl, file);
+
+    HttpServer http;
+    http.setRequest(multipartHeaders(body.size(), contentType), body);
+    bool ok = false;
+    http.readRequest(&ok);
+    QVERIFY2( ok, qPrintable(http.lastError()) );
+
+    if (single) {
+        QCOMPARE( http.requestPostParameter("text"), QString("hello") );
+        QCOMPARE( http.requestPostParameters().size(), 1 );
+        return;
+    }
+    QCOMPARE( http.requestPostParameter("text"), QString("hello") );
+    QCOMPARE( http.requestPostParameter("flag"), QString("1") );
+    QCOMPARE( http.requestBinParameter("file"), file );
+    QCOMPARE( http.requestBinParameter("bin"), QByteArray("\x00\x01\x02", 3) );
+    QCOMPARE( http.requestJsonParameter("json").toObject().value("a").toInt(), 1 );
+    QCOMPARE( http.requestPostParameters().size(), 2 );
+    QCOMPARE( http.requestBinParameters().size(), 2 );
+}
+//==================================================================================================
+void testHttp::test_multipartShared()
+{
+    const QByteArray file(64 * 1024, 'f');
+    const QByteArray body = multipartBody("\r\n", file);
+
+    HttpServer http;
+    http.setRequest(multipartHeaders(body.size(), ContentTypeMultipartForm + "; boundary=" + QString::fromLatin1(boundary)), body);
+    bool ok = false;
+    http.readRequest(&ok);
+    QVERIFY( ok );
+
+    // View - ссылка внутрь содержимого запроса, а не копия
+    const QByteArray content = http.requestContent();
+    const QByteArray view = http.requestBinParameterView("file");
+    QCOMPARE( view, file );
+    QVERIFY( view.constData() >= content.constData() );
+    QVERIFY( view.constData() + view.size() <= content.constData() + content.size() );
+
+    // обычные методы отдают собственные данные, которые переживают объект
+    const QByteArray value = http.requestBinParameter("file");
+    const QByteArray mapValue = http.requestBinParameters().value("file");
+    QVERIFY( (value.constData() < content.constData()) || (value.constData() >= content.constData() + content.size()) );
+    QVERIFY( (mapValue.constData() < content.constData()) || (mapValue.constData() >= content.constData() + content.size()) );
+    QCOMPARE( value, file );
+    QCOMPARE( mapValue, file );
+}
+//==================================================================================================
+void testHttp::test_multipartBadJson()
+{
+    const QByteArray body = "--" + boundary + "\r\n"
+            "Content-Disposition: form-data; name=\"json\"\r\n"
+            "Content-Type: application/json\r\n\r\n"
+            "{broken\r\n"
+            "--" + boundary + "--\r\n";
+
+    HttpServer http;
+    http.setRequest(multipartHeaders(body.size(), ContentTypeMultipartForm + "; boundary=" + QString::fromLatin1(boundary)), body);
+    bool ok = true;
+    http.readRequest(&ok);
+    QVERIFY( !ok );
+    QVERIFY( http.requestBinParameters().isEmpty() );
+    QVERIFY( http.requestContent().isEmpty() );
+}
+//==================================================================================================
+void testHttp::test_multipartToFiles()
+{
+    const QByteArray file = "PNG\r\n--not-a-boundary\r\n" + QByteArray(4 * 1024 * 1024, 'x');
+    const QByteArray body = multipartBody("\r\n", file);
+    QString fileName;
+    {
+        HttpServer http;
+        http.setUploadFileThreshold(1024);
+        http.setRequest(multipartHeaders(body.size(), ContentTypeMultipartForm + "; boundary=" + QString::fromLatin1(boundary)), body);
+        bool ok = false;
+        http.readRequest(&ok);
+        QVERIFY2( ok, qPrintable(http.lastError()) );
+
+        // крупная часть - на диске, мелкая двоичная - в памяти, содержимое целиком не сохраняется
+        fileName = http.requestFileParameter("file");
+        QVERIFY( !fileName.isEmpty() );
+        QCOMPARE( http.requestParameter("file").toString(), fileName );
+        QFile f(fileName);
+        QVERIFY( f.open(QIODevice::ReadOnly) );
+        QCOMPARE( f.readAll(), file );
+        f.close();
+
+        QVERIFY( http.requestBinParameter("file").isEmpty() );
+        QCOMPARE( http.requestBinParameter("bin"), QByteArray("\x00\x01\x02", 3) );
+        QCOMPARE( http.requestPostParameter("text"), QString("hello") );
+        QCOMPARE( http.requestPostParameter("flag"), QString("1") );
+        QCOMPARE( http.requestJsonParameter("json").toObject().value("a").toInt(), 1 );
+        QCOMPARE( http.requestFileParameters().size(), 1 );
+        QVERIFY( http.requestContent().isEmpty() );
+    }
+    // временный файл удаляется вместе с объектом
+    QVERIFY( !QFile::exists(fileName) );
+}
+//==================================================================================================
+void testHttp::test_multipartFieldLimit()
+{
+    // текстовая часть на диск не пишется, и ее размер в памяти ограничен
+    const QByteArray body = "--" + boundary + "\r\n"
+            "Content-Disposition: form-data; name=\"text\"\r\n\r\n"
+            + QByteArray(17 * 1024 * 1024, 't') + "\r\n"
+            "--" + boundary + "--\r\n";
+
+    HttpServer http;
+    http.setUploadFileThreshold(1024);
+    http.setRequest(multipartHeaders(body.size(), ContentTypeMultipartForm + "; boundary=" + QString::fromLatin1(boundary)), body);
+    bool ok = true;
+    http.readRequest(&ok);
+    QVERIFY( !ok );
+    QVERIFY( http.requestPostParameters().isEmpty() );
+}
+//==================================================================================================
+void testHttp::test_multipartStdin_data()
+{
+    QTest::addColumn<int>("step");
+
+    QTest::newRow("step/7") << 7;
+    QTest::newRow("step/4096") << 4096;
+    QTest::newRow("step/65536") << 65536;
+}
+//==================================================================================================
+void testHttp::test_multipartStdin()
+{
+#ifndef Q_OS_UNIX
+    QSKIP("Подмена stdin каналом реализована только для Unix.");
+#else
+    QFETCH(int, step);
+
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+    const QByteArray file = "PNG\r\n--not-a-boundary\r\n" + QByteArray(3 * 1024 * 1024 + 17, 'x');
+    const QByteArray body = multipartBody("\r\n", file);
+
+    HttpServer http;
+    http.setUploadFileThreshold(1024);
+    http.setUploadDir(dir.path());
+    QVERIFY2( readCgiRequest(http, body, step, ContentTypeMultipartForm + "; boundary=" + QString::fromLatin1(boundary)),
+              qPrintable(http.lastError()) );
+
+    const QString fileName = http.requestFileParameter("file");
+    QCOMPARE( QFileInfo(fileName).absolutePath(), QDir(dir.path()).absolutePath() );
+    QFile f(fileName);
+    QVERIFY( f.open(QIODevice::ReadOnly) );
+    QCOMPARE( f.readAll(), file );
+    f.close();
+
+    QCOMPARE( http.requestBinParameter("bin"), QByteArray("\x00\x01\x02", 3) );
+    QCOMPARE( http.requestPostParameter("text"), QString("hello") );
+    QCOMPARE( http.requestPostParameter("flag"), QString("1") );
+    QCOMPARE( http.requestJsonParameter("json").toObject().value("a").toInt(), 1 );
+    QVERIFY( http.requestContent().isEmpty() );
+#endif
+}
+//==================================================================================================
+void testHttp::test_multipartStdinError()
+{
+#ifndef Q_OS_UNIX
+    QSKIP("Подмена stdin каналом реализована только для Unix.");
+#else
+    // ошибка после записанной на диск части: уже созданные файлы удаляются
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+    const QByteArray body = "--" + boundary + "\r\n"
+            "Content-Disposition: form-data; name=\"file\"; filename=\"big.bin\"\r\n\r\n"
+            + QByteArray(2 * 1024 * 1024, 'x') + "\r\n"
+            "--" + boundary + "\r\n"
+            "Content-Disposition: form-data; name=\"json\"\r\n"
+            "Content-Type: application/json\r\n\r\n"
+            "{broken\r\n"
+            "--" + boundary + "--\r\n";
+
+    HttpServer http;
+    http.setUploadFileThreshold(1024);
+    http.setUploadDir(dir.path());
+    QVERIFY( !readCgiRequest(http, body, 4096, ContentTypeMultipartForm + "; boundary=" + QString::fromLatin1(boundary)) );
+    QVERIFY( http.requestFileParameters().isEmpty() );
+    QVERIFY( QDir(dir.path()).entryList(QDir::Files | QDir::NoDotAndDotDot).isEmpty() );
+#endif
+}
+//==================================================================================================
+void testHttp::test_listenerChunked()
+{
+    QTcpSocket socket;
+    QVERIFY( connectListener(socket) );
+    QByteArray buffer, head, body;
+
+    // блоки с расширением и трейлер; второй блок приходит отдельным пакетом
+    socket.write("POST /echo?c HTTP/1.1\r\nHost: test\r\nContent-Type: text/plain\r\n"
+                 "Transfer-Encoding: chunked\r\n\r\n5;ext=1\r\nhello\r\n");
+    QVERIFY( socket.waitForBytesWritten(5000) );
+    QTest::qWait(50);
+    socket.write("6\r\n world\r\n0\r\nX-Trailer: 1\r\n\r\n");
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QVERIFY( head.startsWith("HTTP/1.1 200 OK\r\n") );
+    QCOMPARE( body, QByteArray("POST|c||hello world") );
+
+    // соединение остается открытым: следующий запрос без блоков
+    socket.write("GET /?next HTTP/1.1\r\nHost: test\r\n\r\n");
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QCOMPARE( body, QByteArray("GET|next||") );
+}
+//==================================================================================================
+void testHttp::test_listenerPipeline()
+{
+    QTcpSocket socket;
+    QVERIFY( connectListener(socket) );
+    QByteArray buffer, head, body;
+
+    // три запроса одним пакетом: ответы в порядке запросов
+    socket.write("GET /?1 HTTP/1.1\r\nHost: test\r\n\r\n"
+                 "POST /?2 HTTP/1.1\r\nHost: test\r\nContent-Type: text/plain\r\nContent-Length: 3\r\n\r\nabc"
+                 "\r\nGET /?3 HTTP/1.1\r\nHost: test\r\n\r\n");
+    const QList<QByteArray> expected { "GET|1||", "POST|2||abc", "GET|3||" };
+    for (const QByteArray &e: expected) {
+        QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+        QVERIFY( head.contains("\r\nConnection: keep-alive\r\n") );
+        QCOMPARE( body, e );
+    }
+    QVERIFY( buffer.isEmpty() );
+}
+//==================================================================================================
+void testHttp::test_listenerHttp10()
+{
+    QTcpSocket socket;
+    QVERIFY( connectListener(socket) );
+    QByteArray buffer, head, body;
+
+    // HTTP/1.0: соединение сохраняется только по "Connection: keep-alive"
+    socket.write("GET /?a HTTP/1.0\r\nConnection: Keep-Alive\r\n\r\n");
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QVERIFY( head.contains("\r\nConnection: keep-alive\r\n") );
+    QCOMPARE( body, QByteArray("GET|a||") );
+
+    socket.write("GET /?b HTTP/1.0\r\n\r\n");
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QVERIFY( head.contains("\r\nConnection: close\r\n") );
+    QCOMPARE( body, QByteArray("GET|b||") );
+    QVERIFY( (socket.state() == QAbstractSocket::UnconnectedState) || socket.waitForDisconnected(5000) );
+}
+//==================================================================================================
+void testHttp::test_listenerHead()
+{
+    QTcpSocket socket;
+    QVERIFY( connectListener(socket) );
+    QByteArray buffer, head, body;
+
+    // ответ на HEAD - без тела, но с его длиной; следующий ответ не смещается
+    socket.write("HEAD /?h HTTP/1.1\r\nHost: test\r\n\r\nGET /?g HTTP/1.1\r\nHost: test\r\n\r\n");
+    QVERIFY( readHttpResponse(&socket, buffer, head, body, true) );
+    QVERIFY( head.startsWith("HTTP/1.1 200 OK\r\n") );
+    QVERIFY( head.contains("\r\nContent-Length: 8\r\n") );
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QVERIFY( head.startsWith("HTTP/1.1 200 OK\r\n") );
+    QCOMPARE( body, QByteArray("GET|g||") );
+}
+//==================================================================================================
+void testHttp::test_listenerContinue()
+{
+    QTcpSocket socket;
+    QVERIFY( connectListener(socket) );
+    QByteArray buffer, head, body;
+
+    // тело отправляется только после промежуточного ответа
+    socket.write("POST /?e HTTP/1.1\r\nHost: test\r\nContent-Type: text/plain\r\n"
+                 "Content-Length: 5\r\nExpect: 100-continue\r\n\r\n");
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QCOMPARE( head, QByteArray("HTTP/1.1 100 Continue\r\n\r\n") );
+    socket.write("hello");
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QVERIFY( head.startsWith("HTTP/1.1 200 OK\r\n") );
+    QCOMPARE( body, QByteArray("POST|e||hello") );
+
+    // слишком большое тело отклоняется без "100 Continue"
+    socket.write("POST / HTTP/1.1\r\nHost: test\r\nContent-Type: text/plain\r\n"
+                 "Content-Length: 2048\r\nExpect: 100-continue\r\n\r\n");
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QVERIFY( head.startsWith("HTTP/1.1 413 ") );
+}
+//==================================================================================================
+void testHttp::test_listenerErrors_data()
+{
+    QTest::addColumn<QByteArray>("request");
+    QTest::addColumn<QByteArray>("status");
+
+    // предел содержимого - 1024 байта, срок на заголовок - 300 мсек (initTestCase)
+    QTest::newRow("413 content-length") << QByteArray("POST / HTTP/1.1\r\nContent-Type: text/plain\r\n"
+                                                      "Content-Length: 1025\r\n\r\n") << QByteArray("413");
+    QTest::newRow("413 chunked") << "POST / HTTP/1.1\r\nContent-Type: text/plain\r\nTransfer-Encoding: chunked\r\n\r\n"
+                                    "400\r\n" + QByteArray(1024, 'x') + "\r\n1\r\nx\r\n0\r\n\r\n" << QByteArray("413");
+    QTest::newRow("431") << "GET / HTTP/1.1\r\nX-Big: " + QByteArray(70 * 1024, 'a') << QByteArray("431");
+    QTest::newRow("408") << QByteArray("GET / HTTP/1.1\r\nHost: te") << QByteArray("408");
+    QTest::newRow("400") << QByteArray("GET /\r\n\r\n") << QByteArray("400");
+    QTest::newRow("505") << QByteArray("GET / HTTP/2.0\r\n\r\n") << QByteArray("505");
+}
+//==================================================================================================
+void testHttp::test_listenerErrors()
+{
+    QFETCH(QByteArray, request);
+    QFETCH(QByteArray, status);
+
+    QTcpSocket socket;
+    QVERIFY( connectListener(socket) );
+    QByteArray buffer, head, body;
+
+    socket.write(request);
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QVERIFY2( head.startsWith("HTTP/1.1 " + status + " "), head.constData() );
+    QVERIFY( head.contains("\r\nConnection: close\r\n") );
+    QVERIFY( (socket.state() == QAbstractSocket::UnconnectedState) || socket.waitForDisconnected(5000) );
+}
+//==================================================================================================
+void testHttp::test_listenerCookies()
+{
+    QTcpSocket socket;
+    QVERIFY( connectListener(socket) );
+    QByteArray buffer, head, body;
+
+    // повторные Cookie объединяются через "; " (RFC 6265, 5.4), а не через запятую
+    socket.write("GET /?k HTTP/1.1\r\nHost: test\r\nCookie: a=1\r\ncookie: b=2; c=3\r\n\r\n");
+    QVERIFY( readHttpResponse(&socket, buffer, head, body) );
+    QCOMPARE( body, QByteArray("GET|k|a=1; b=2; c=3|") );
+}
+//==================================================================================================
+void testHttp::test_listenerMaxContent()
+{
+    // предел содержимого ограничен снизу нулем, сверху - размером QByteArray за вычетом заголовка
+    HttpListener listener;
+    listener.setMaxContentLength(-1);
+    QCOMPARE( listener.maxContentLength(), qint64(0) );
+    listener.setMaxContentLength(1000);
+    QCOMPARE( listener.maxContentLength(), qint64(1000) );
+    listener.setMaxContentLength(Q_INT64_C(1) << 40);
+    QVERIFY( listener.maxContentLength() > 1024 * 1024 );
+    QVERIFY( listener.maxContentLength() < 0x7FFFFFFF );
+}
+//==================================================================================================
+void testHttp::test_fastCgiMultiplexed()
+{
+    QTcpSocket socket;
+    QVERIFY( connectFastCgi(socket) );
+    QByteArray buffer, out;
+    int status = -1;
+
+    // записи двух запросов вперемешку: второй завершается раньше и отвечает первым
+    const QByteArray first = fcgiRequest(1, true, "q=1", "one");
+    const QByteArray second = fcgiRequest(2, true, "q=2", "two");
+    QMap<QString, QString> params;
+    params.insert(ServerHeaderRequestMethod, MethodPost);
+    params.insert(ServerHeaderQueryString, "q=1");
+    params.insert(ServerHeaderContentType, ContentTypeText);
+    params.insert(ServerHeaderContentLength, "3");
+    socket.write( fcgiBegin(1, 1, true) + fcgiRecord(4, 1, fcgiParams(params)) + second );
+    QVERIFY( readFcgiResponse(&socket, buffer, 2, out, status) );
+    QCOMPARE( status, 0 );
+    QVERIFY( out.endsWith("\r\n\r\nPOST|q=2||two") );
+
+    socket.write( fcgiRecord(4, 1, QByteArray()) + fcgiRecord(5, 1, "one") + fcgiRecord(5, 1, QByteArray()) );
+    QVERIFY( readFcgiResponse(&socket, buffer, 1, out, status) );
+    QCOMPARE( status, 0 );
+    QVERIFY( out.endsWith("\r\n\r\nPOST|q=1||one") );
+
+    // тот же id после завершения - новый запрос
+    socket.write(first);
+    QVERIFY( readFcgiResponse(&socket, buffer, 1, out, status) );
+    QVERIFY( out.endsWith("\r\n\r\nPOST|q=1||one") );
+    QVERIFY( buffer.isEmpty() );
+}
+//==================================================================================================
+void testHttp::test_fastCgiAbort()
+{
+    QTcpSocket socket;
+    QVERIFY( connectFastCgi(socket) );
+    QByteArray buffer, out;
+    int status = -1;
+
+    // FCGI_ABORT_REQUEST до окончания FCGI_STDIN: только FCGI_END_REQUEST, обработчик не вызывается
+    QMap<QString, QString> params;
+    params.insert(ServerHeaderRequestMethod, MethodGet);
+    params.insert(ServerHeaderQueryString, "q=abort");
+    socket.write( fcgiBegin(3, 1, true) + fcgiRecord(4, 3, fcgiParams(params)) + fcgiRecord(4, 3, QByteArray())
+                  + fcgiRecord(2, 3, QByteArray()) );
+    QVERIFY( readFcgiResponse(&socket, buffer, 3, out, status) );
+    QCOMPARE( status, 0 );
+    QVERIFY( out.isEmpty() );
+
+    // оставшиеся записи прерванного запроса отбрасываются, соединение работает дальше
+    socket.write( fcgiRecord(5, 3, QByteArray()) + fcgiRequest(4, true, "q=next") );
+    QVERIFY( readFcgiResponse(&socket, buffer, 4, out, status) );
+    QVERIFY( out.endsWith("\r\n\r\nGET|q=next||") );
+}
+//==================================================================================================
+void testHttp::test_fastCgiManagement()
+{
+    QTcpSocket socket;
+    QVERIFY( connectFastCgi(socket) );
+    QByteArray buffer;
+    FcgiRecord rec;
+
+    // FCGI_GET_VALUES: известна только FCGI_MPXS_CONNS
+    QMap<QString, QString> names;
+    names.insert("FCGI_MPXS_CONNS", "");
+    names.insert("FCGI_MAX_CONNS", "");
+    socket.write( fcgiRecord(9, 0, fcgiParams(names)) );
+    QVERIFY( readFcgiRecord(&socket, buffer, rec) );
+    QCOMPARE( int(rec.type), 10 );
+    QCOMPARE( int(rec.id), 0 );
+    QCOMPARE( rec.content, QByteArray("\x0f\x01" "FCGI_MPXS_CONNS1") );
+
+    // неизвестная управляющая запись: FCGI_UNKNOWN_TYPE с ее типом
+    socket.write( fcgiRecord(12, 0, "x") );
+    QVERIFY( readFcgiRecord(&socket, buffer, rec) );
+    QCOMPARE( int(rec.type), 11 );
+    QCOMPARE( rec.content, QByteArray("\x0c\0\0\0\0\0\0\0", 8) );
+}
+//==================================================================================================
+void testHttp::test_fastCgiUnknownRole()
+{
+    QTcpSocket socket;
+    QVERIFY( connectFastCgi(socket) );
+    QByteArray buffer, out;
+    int status = -1;
+
+    // роль Authorizer не поддерживается: FCGI_UNKNOWN_ROLE, записи запроса отбрасываются
+    socket.write( fcgiBegin(5, 2, true) + fcgiRecord(4, 5, QByteArray()) + fcgiRecord(5, 5, QByteArray()) );
+    QVERIFY( readFcgiResponse(&socket, buffer, 5, out, status) );
+    QCOMPARE( status, 3 );
+    QVERIFY( out.isEmpty() );
+
+    socket.write( fcgiRequest(6, true, "q=responder") );
+    QVERIFY( readFcgiResponse(&socket, buffer, 6, out, status) );
+    QCOMPARE( status, 0 );
+    QVERIFY( out.endsWith("\r\n\r\nGET|q=responder||") );
+}
+//==================================================================================================
+void testHttp::test_fastCgiLimits()
+{
+    QTcpSocket socket;
+    QVERIFY( connectFastCgi(socket) );
+    QByteArray buffer, out;
+    int status = -1;
+
+    // FCGI_PARAMS больше MaxParamsSize (1 МБ): 431 без вызова обработчика
+    QByteArray request = fcgiBegin(7, 1, true);
+    for (int i = 0; i < 17; ++i) request += fcgiRecord(4, 7, QByteArray(65535, 'p'));
+    socket.write(request + fcgiRecord(4, 7, QByteArray()) + fcgiRecord(5, 7, QByteArray()));
+    QVERIFY( readFcgiResponse(&socket, buffer, 7, out, status) );
+    QCOMPARE( status, 0 );
+    QVERIFY( out.startsWith("Status: 431 ") );
+
+    // FCGI_STDIN больше maxContentLength (1024 байта): 413
+    QMap<QString, QString> params;
+    params.insert(ServerHeaderRequestMethod, MethodPost);
+    params.insert(ServerHeaderContentType, ContentTypeText);
+    params.insert(ServerHeaderContentLength, "1025");
+    socket.write( fcgiBegin(8, 1, true) + fcgiRecord(4, 8, fcgiParams(params)) + fcgiRecord(4, 8, QByteArray())
+                  + fcgiRecord(5, 8, QByteArray(1000, 'c')) + fcgiRecord(5, 8, QByteArray(25, 'c'))
+                  + fcgiRecord(5, 8, QByteArray()) );
+    QVERIFY( readFcgiResponse(&socket, buffer, 8, out, status) );
+    QVERIFY( out.startsWith("Status: 413 ") );
+
+    // соединение после отказов продолжает работать
+    socket.write( fcgiRequest(9, true, "q=ok", QByteArray(1024, 'c')) );
+    QVERIFY( readFcgiResponse(&socket, buffer, 9, out, status) );
+    QVERIFY( out.endsWith("\r\n\r\nPOST|q=ok||" + QByteArray(1024, 'c')) );
+}
+//==================================================================================================
+void testHttp::test_fastCgiClose()
+{
+    QTcpSocket socket;
+    QVERIFY( connectFastCgi(socket) );
+    QByteArray buffer, out;
+    int status = -1;
+
+    // последний запрос без FCGI_KEEP_CONN закрывает соединение: следующий в том же пакете не обрабатывается
+    socket.write( fcgiRequest(10, false, "q=last") + fcgiRequest(11, true, "q=after") );
+    QVERIFY( readFcgiResponse(&socket, buffer, 10, out, status) );
+    QVERIFY( out.endsWith("\r\n\r\nGET|q=last||") );
+    QVERIFY( (socket.state() == QAbstractSocket::UnconnectedState) || socket.waitForDisconnected(5000) );
+    buffer.append( socket.readAll() );
+    QVERIFY( buffer.isEmpty() );
+}
+//==================================================================================================
+
+QTEST_GUILESS_MAIN(testHttp)
+
+#include "tst_testhttp.moc"
@@ -0,0 +1,673 @@
+#include <QtTest>
+#include <QDirIterator>
+#include <QTemporaryDir>
+#include "log.h"
+#include "log_reference.h"
+
+using namespace nayk;
+
+// add necessary includes here
+//==================================================================================================
+class testLog : public QObject
+{
+    Q_OBJECT
+
+public:
+    testLog();
+    ~testLog();
+
+private:
+    QTemporaryDir _dir;
+    QString _indexRoot;
+    QVector<LogRecord> _indexRecords;
+    QString indexTree();
+    static QString dayPath(const QString &root, const QDate &date);
+    QStringList readLines(const QString &fileName);
+    static QStringList readLogLines(const QString &fileName);
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    // async:
+    void test_asyncIdentical();
+    void test_asyncFlush();
+    void test_asyncThreads();
+    // prefix:
+    void test_logPrefix();
+    // rotation:
+    void test_compressLog();
+    void test_rotationSize_data();
+    void test_rotationSize();
+    void test_rotationThreads();
+    void test_retention();
+    void test_retentionForeign();
+    // reader:
+    void test_logReader();
+    void test_logReaderRefresh();
+    // highlight:
+    void test_highlightLog_data();
+    void test_highlightLog();
+    // index:
+    void test_logIndex();
+    void test_logIndexIncremental();
+    // binary:
+    void test_binaryLog();
+};
+//==================================================================================================
+testLog::testLog()
+{
+
+}
+//==================================================================================================
+testLog::~testLog()
+{
+
+}
+//==================================================================================================
+QStringList testLog::readLines(const QString &fileName)
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) return QStringList();
+    QStringList res = QString::fromUtf8( f.readAll() ).split("\n");
+    if (!res.isEmpty() && res.last().isEmpty()) res.removeLast();
+    return res;
+}
+//==================================================================================================
+QStringList testLog::readLogLines(const QString &fileName)
+{
+    QFile f(fileName);
+    if (!f.open(QIODevice::ReadOnly)) return QStringList();
+    QByteArray data = f.readAll();
+    if (fileName.endsWith(".gz")) data = Log::uncompressLog(data);
+    QStringList res = QString::fromUtf8(data).remove('\r').split("\n");
+    if (!res.isEmpty() && res.last().isEmpty()) res.removeLast();
+    return res;
+}
+//==================================================================================================
+QString testLog::dayPath(const QString &root, const QDate &date)
+{
+    return root + date.toString("/yyyy/MM/dd/");
+}
+//==================================================================================================
+QString testLog::indexTree()
+{
+    // три дня по два файла, второй файл последнего дня переходит через полночь; все строки - в _indexRecords
+    if (!_indexRoot.isEmpty()) return _indexRoot;
+    _indexRoot = _dir.filePath("tree");
+
+    const QDate firstDay(2019, 6, 10);
+    for (int day = 0; day < 3; ++day) {
+        const QDate date = firstDay.addDays(day);
+        if (!QDir().mkpath(dayPath(_indexRoot, date))) return QString();
+        for (int n = 0; n < 2; ++n) {
+            const QString fileName = dayPath(_indexRoot, date) + QString("1200000%1.log").arg(n);
+            QFile f(fileName);
+            if (!f.open(QIODevice::WriteOnly)) return QString();
+            // второй файл: с 12:00 (или с 23:50 в последний день) шагом 997 мсек
+            QDateTime dt( date, (n == 1) && (day == 2) ? QTime(23, 50) : QTime(n * 12, 0) );
+            QDateTime lastTimed = dt;
+            QByteArray data;
+            for (int i = 0; i < 3000; ++i) {
+                const LogType logType = static_cast<LogType>( (i * 7 + day) % 8 );
+                const QString text = QString("day %1 file %2 line %3").arg(day).arg(n).arg(i);
+                const QString line = (logType == LogOther) ? text : Log::getLogPrefix(logType, dt) + text;
+                data += line.toUtf8() + "\n";
+                // строка без префикса получает время предыдущей
+                if (logType != LogOther) lastTimed = dt;
+                _indexRecords.append( LogRecord { lastTimed, logType, text, fileName, i } );
+                dt = dt.addMSecs(997);
+            }
+            f.write(data);
+        }
+    }
+    return _indexRoot;
+}
+//==================================================================================================
+void testLog::initTestCase()
+{
+    QVERIFY( _dir.isValid() );
+}
+//==================================================================================================
+void testLog::cleanupTestCase()
+{
+
+}
+//==================================================================================================
+void testLog::test_asyncIdentical()
+{
+    const QString syncName = _dir.filePath("sync.log");
+    const QString asyncName = _dir.filePath("async.log");
+    {
+        Log syncLog, asyncLog;
+        asyncLog.setAsync(true);
+        QVERIFY( syncLog.startLog(syncName) );
+        QVERIFY( asyncLog.startLog(asyncName) );
+        for (int i = 0; i < 1000; ++i) {
+            const LogType logType = static_cast<LogType>(i % 8);
+            const QString text = QString("message %1\nсо второй строкой").arg(i);
+            QVERIFY( syncLog.write(logType, text) );
+            QVERIFY( asyncLog.write(logType, text) );
+        }
+    }
+
+    // без отметок времени содержимое совпадает построчно
+    const QStringList syncLines = readLines(syncName);
+    const QStringList asyncLines = readLines(asyncName);
+    QCOMPARE( asyncLines.size(), syncLines.size() );
+    QCOMPARE( syncLines.size(), 1 + 2 * 1000 + 1 ); // первая, сообщения, последняя
+    for (int i = 0; i < syncLines.size(); ++i) {
+        const QString &s = syncLines.at(i);
+        const QString &a = asyncLines.at(i);
+        if (s.startsWith("[") && (s.size() > 14) && (s.at(13) == QChar(']'))) QCOMPARE( a.mid(14), s.mid(14) );
+        else QCOMPARE( a, s );
+    }
+}
+//==================================================================================================
+void testLog::test_asyncFlush()
+{
+    const QString fileName = _dir.filePath("flush.log");
+    Log log;
+    log.setAsync(true);
+    log.setFlushThreshold(1024 * 1024, 60000); // без flush() данные остались бы в очереди
+    QVERIFY( log.startLog(fileName) );
+    QVERIFY( log.isAsync() );
+
+    for (int i = 0; i < 500; ++i) QVERIFY( log.write(LogInfo, QString("line %1").arg(i)) );
+    QVERIFY( log.flush() );
+
+    const QStringList lines = readLines(fileName);
+    QCOMPARE( lines.size(), 501 );
+    QVERIFY( lines.last().endsWith("line 499") );
+
+    // переключение обратно в синхронный режим дописывает очередь
+    QVERIFY( log.write(LogWarning, "before sync") );
+    log.setAsync(false);
+    QVERIFY( !log.isAsync() );
+    QVERIFY( readLines(fileName).last().endsWith("[wrn] before sync") );
+}
+//==================================================================================================
+class LogProducer : public QThread
+{
+public:
+    LogProducer(Log *log, int id) : _log(log), _id(id) {}
+    int failed() const { return _failed; }
+
+protected:
+    void run() override
+    {
+        for (int i = 0; i < 2000; ++i) {
+            if (!_log->write(LogDbg, QString("thread %1 message %2").arg(_id).arg(i))) ++_failed;
+        }
+    }
+
+private:
+    Log *_log;
+    int _id;
+    int _failed {0};
+};
+
+void testLog::test_asyncThreads()
+{
+    const QString fileName = _dir.filePath("threads.log");
+    Log log;
+    log.setAsync(true);
+    QVERIFY( log.startLog(fileName) );
+
+    QList<LogProducer*> producers;
+    for (int i = 0; i < 4; ++i) producers.append( new LogProducer(&log, i) );
+    for (LogProducer *producer: producers) producer->start();
+    for (LogProducer *producer: producers) producer->wait();
+    qDeleteAll(producers);
+    QVERIFY( log.flush() );
+
+    // строки не теряются и не перемешиваются
+    const QStringList lines = readLines(fileName);
+    QCOMPARE( lines.size(), 1 + 4 * 2000 );
+    for (int i = 1; i < lines.size(); ++i) QVERIFY( lines.at(i).mid(14).startsWith("[dbg] thread ") );
+}
+//==================================================================================================
+void testLog::test_logPrefix()
+{
+    // повторы в пределах секунды, смена секунды, границы миллисекунд и суток
+    const QDateTime base(QDate(2019, 12, 31), QTime(23, 59, 58));
+    const qint64 steps[] = { 0, 1, 9, 10, 99, 100, 999, 1000, 1001, 1999, 2000, 2345, 86400000, -1 };
+    for (qint64 step: steps) {
+        for (int t = LogInfo; t <= LogOther; ++t) {
+            const LogType logType = static_cast<LogType>(t);
+            const QDateTime local = base.addMSecs(step);
+            const QDateTime utc = local.toUTC();
+            QCOMPARE( Log::getLogPrefix(logType, local), referencePrefix(logType, local) );
+            QCOMPARE( Log::getLogPrefix(logType, utc), referencePrefix(logType, utc) );
+        }
+    }
+    QCOMPARE( Log::getLogPrefix(LogError, QDateTime()), referencePrefix(LogError, QDateTime()) );
+
+    const QDateTime now = QDateTime::currentDateTime();
+    QCOMPARE( Log::getLogPrefix(LogDbg, now), referencePrefix(LogDbg, now) );
+}
+//==================================================================================================
+void testLog::test_compressLog()
+{
+    QByteArray data;
+    for (int i = 0; i < 5000; ++i) data += QString("[12:00:00.%1][inf] строка %2\n").arg(i % 1000, 3, 10, QChar('0')).arg(i).toUtf8();
+
+    const QList<QByteArray> samples = QList<QByteArray>() << QByteArray() << QByteArray("x") << data;
+    for (const QByteArray &sample: samples) {
+        const QByteArray gz = Log::compressLog(sample);
+        QVERIFY( gz.startsWith("\x1f\x8b") );
+        QCOMPARE( Log::uncompressLog(gz), sample );
+    }
+    QVERIFY( Log::compressLog(data).size() < data.size() / 4 );
+
+    // члены gzip подряд (сжатие при ротации кусками) распаковываются целиком
+    const QByteArray head = data.left(data.size() / 3);
+    QCOMPARE( Log::uncompressLog(Log::compressLog(head) + Log::compressLog(data.mid(head.size()))), data );
+
+    // поврежденный архив не распаковывается
+    QByteArray gz = Log::compressLog(data);
+    gz[gz.size() / 2] = static_cast<char>(gz.at(gz.size() / 2) ^ 0x55);
+    QVERIFY( Log::uncompressLog(gz).isEmpty() );
+    QVERIFY( Log::uncompressLog("not a gzip").isEmpty() );
+}
+//==================================================================================================
+void testLog::test_rotationSize_data()
+{
+    QTest::addColumn<bool>("async");
+
+    QTest::newRow("sync") << false;
+    QTest::newRow("async") << true;
+}
+//==================================================================================================
+void testLog::test_rotationSize()
+{
+    QFETCH(bool, async);
+
+    const QString root = _dir.filePath(async ? "rotation_async" : "rotation_sync");
+    const int count = 2000;
+    QString lastFile;
+    {
+        Log log(nullptr, QDateTime(), root);
+        log.setRotation(16 * 1024, false);
+        log.setAsync(async);
+        QVERIFY( log.startLog() );
+        for (int i = 0; i < count; ++i) QVERIFY( log.write(LogInfo, QString("message %1").arg(i)) );
+        QVERIFY( log.flush() );
+        lastFile = QDir::fromNativeSeparators( log.logFileName() );
+    }
+
+    QStringList files;
+    QDirIterator it(root, QStringList() << "*.log" << "*.log.gz", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) files.append( it.next() );
+    std::sort(files.begin(), files.end());
+    QVERIFY( files.size() > 2 );
+    QVERIFY( files.contains(lastFile) );
+
+    // все строки на месте, закрытые файлы сжаты и не превышают порог больше чем на строку
+    int lines = 0;
+    for (const QString &fileName: files) {
+        QVERIFY( (fileName == lastFile) || fileName.endsWith(".log.gz") );
+        if (fileName != lastFile) QVERIFY( readLogLines(fileName).join("\n").toUtf8().size() < 17 * 1024 );
+        lines += readLogLines(fileName).size();
+    }
+    QCOMPARE( lines, 1 + count + 1 );
+}
+//==================================================================================================
+void testLog::test_rotationThreads()
+{
+    // ротация идет в потоке писателя, пока потоки-производители и владелец пишут и сбрасывают лог
+    const QString root = _dir.filePath("rotation_threads");
+    QString lastFile;
+    {
+        Log log(nullptr, QDateTime(), root);
+        log.setRotation(8 * 1024, false);
+        log.setAsync(true);
+        QVERIFY( log.startLog() );
+
+        QList<LogProducer*> producers;
+        for (int i = 0; i < 4; ++i) producers.append( new LogProducer(&log, i) );
+        for (LogProducer *producer: producers) producer->start();
+        for (LogProducer *producer: producers) {
+            while (!producer->wait(1)) QVERIFY( log.flush() );
+            QCOMPARE( producer->failed(), 0 );
+        }
+        qDeleteAll(producers);
+        QVERIFY( log.flush() );
+        lastFile = QDir::fromNativeSeparators( log.logFileName() );
+    }
+
+    QStringList files;
+    QDirIterator it(root, QStringList() << "*.log" << "*.log.gz", QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) files.append( it.next() );
+    QVERIFY( files.size() > 2 );
+    QVERIFY( files.contains(lastFile) );
+
+    int lines = 0;
+    for (const QString &fileName: files) lines += readLogLines(fileName).size();
+    QCOMPARE( lines, 1 + 4 * 2000 + 1 );
+}
+//==================================================================================================
+void testLog::test_retention()
+{
+    const QString root = _dir.filePath("retention");
+    const qint64 maxTotal = 32 * 1024;
+
+    Log log(nullptr, QDateTime(), root);
+    log.setRotation(4 * 1024, false);
+    log.setRetention(maxTotal);
+    log.setCompressRotated(false);
+    QVERIFY( log.startLog() );
+    for (int i = 0; i < 5000; ++i) QVERIFY( log.write(LogDbg, QString("retention message %1").arg(i)) );
+    QVERIFY( log.waitForArchive() );
+
+    qint64 total = 0;
+    int count = 0;
+    QDirIterator it(root, QStringList("*.log"), QDir::Files, QDirIterator::Subdirectories);
+    while (it.hasNext()) {
+        it.next();
+        ++count;
+        if (it.filePath() != QDir::fromNativeSeparators( log.logFileName() )) total += it.fileInfo().size();
+    }
+    QVERIFY( count > 1 );
+    QVERIFY( total <= maxTotal );
+    QVERIFY( total >= maxTotal - 3 * 4 * 1024 );
+}
+//==================================================================================================
+void testLog::test_retentionForeign()
+{
+    // лог в явно заданном файле: чужие логи того же каталога старше, но не удаляются
+    QTemporaryDir dir;
+    QVERIFY( dir.isValid() );
+    const QStringList foreign = QStringList() << "other.log" << "other.log.gz" << "20191231.log";
+    for (const QString &name: foreign) {
+        QFile f(dir.filePath(name));
+        QVERIFY( f.open(QIODevice::WriteOnly) );
+        f.write( QByteArray(64 * 1024, 'x') );
+    }
+
+    const qint64 maxTotal = 16 * 1024;
+    Log log;
+    log.setRotation(4 * 1024, false);
+    log.setRetention(maxTotal);
+    log.setCompressRotated(false);
+    QVERIFY( log.startLog(dir.filePath("app.log")) );
+    for (int i = 0; i < 5000; ++i) QVERIFY( log.write(LogDbg, QString("retention message %1").arg(i)) );
+    QVERIFY( log.waitForArchive() );
+
+    for (const QString &name: foreign) QCOMPARE( QFileInfo(dir.filePath(name)).size(), qint64(64 * 1024) );
+    // свои файлы, включая первый, ограничены по объему
+    QVERIFY( !QFile::exists(dir.filePath("app.log")) );
+    qint64 total = 0;
+    const QFileInfoList files = QDir(dir.path()).entryInfoList(QStringList("*.log"), QDir::Files);
+    for (const QFileInfo &info: files) {
+        if (!foreign.contains(info.fileName()) && (info.filePath() != QDir::fromNativeSeparators( log.logFileName() )))
+            total += info.size();
+    }
+    QVERIFY( total <= maxTotal );
+}
+//==================================================================================================
+void testLog::test_logReader()
+{
+    // строки разной длины, \r\n, кириллица, пустые строки и последняя строка без перевода
+    QStringList expected;
+    QByteArray data;
+    for (int i = 0; i < 1000; ++i) {
+        const QString str = (i % 50 == 0) ? QString() : QString("[12:00:00.000][inf] строка %1 ").arg(i) + QString(i % 13, QChar('x'));
+        expected.append(str);
+        data += str.toUtf8() + ((i % 3 == 0) ? "\r\n" : "\n");
+    }
+    expected.append("хвост");
+    data += QString("хвост").toUtf8();
+
+    const QString fileName = _dir.filePath("reader.log");
+    QFile f(fileName);
+    QVERIFY( f.open(QIODevice::WriteOnly) );
+    f.write(data);
+    f.close();
+
+    LogReader reader(fileName);
+    QVERIFY( reader.isOpen() );
+    QCOMPARE( reader.lineCount(), qint64(expected.size()) );
+    for (int i = 0; i < expected.size(); i += 7) QCOMPARE( reader.line(i), expected.at(i) );
+    QCOMPARE( reader.line(expected.size() - 1), QString("хвост") );
+    QVERIFY( reader.line(expected.size()).isNull() );
+
+    QCOMPARE( reader.lines(60, 100), expected.mid(60, 100) );
+    QCOMPARE( reader.lines(950, 1000), expected.mid(950) );
+    QCOMPARE( reader.lines(-10, 20), expected.mid(0, 10) );
+    QCOMPARE( reader.readLog(HtmlLog, 63, 3, true), Log::highlightLog(HtmlLog, expected.mid(63, 3).join("\n"), true) );
+    QVERIFY( reader.readLog(PlainLog, 5000, 10).isEmpty() );
+
+    // целиком - как прежний readLog
+    QCOMPARE( Log::readLog(RichLog, fileName), Log::highlightLog(RichLog, expected.join("\n") + "\n") );
+
+    // архив ротации
+    const QString gzName = fileName + ".gz";
+    QFile gz(gzName);
+    QVERIFY( gz.open(QIODevice::WriteOnly) );
+    gz.write( Log::compressLog(data) );
+    gz.close();
+    QVERIFY( reader.open(gzName) );
+    QCOMPARE( reader.lines(0, 2000), expected );
+
+    QVERIFY( !reader.open(_dir.filePath("missing.log")) );
+    QVERIFY( !reader.isOpen() );
+}
+//==================================================================================================
+void testLog::test_logReaderRefresh()
+{
+    const QString fileName = _dir.filePath("refresh.log");
+    Log log;
+    QVERIFY( log.startLog(fileName) );
+
+    LogReader reader(fileName);
+    QCOMPARE( reader.lineCount(), qint64(1) );
+
+    for (int i = 0; i < 300; ++i) QVERIFY( log.write(LogInfo, QString("line %1").arg(i)) );
+    QVERIFY( reader.refresh() );
+    QCOMPARE( reader.lineCount(), qint64(301) );
+    QVERIFY( reader.line(300).endsWith("[inf] line 299") );
+    QVERIFY( reader.line(129).endsWith("[inf] line 128") );
+}
+//==================================================================================================
+void testLog::test_highlightLog_data()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<bool>("dark");
+
+    QTest::newRow("plain") << int(PlainLog) << false;
+    QTest::newRow("plain/dark") << int(PlainLog) << true;
+    QTest::newRow("rich") << int(RichLog) << false;
+    QTest::newRow("rich/dark") << int(RichLog) << true;
+    QTest::newRow("html") << int(HtmlLog) << false;
+    QTest::newRow("html/dark") << int(HtmlLog) << true;
+}
+//==================================================================================================
+void testLog::test_highlightLog()
+{
+    QFETCH(int, format);
+    QFETCH(bool, dark);
+    const LogFormat logFormat = static_cast<LogFormat>(format);
+
+    const QDateTime date(QDate(2019, 6, 1), QTime(12, 34, 56, 789));
+    QStringList lines;
+    for (int t = LogInfo; t <= LogOther; ++t) {
+        lines << Log::getLogPrefix(static_cast<LogType>(t), date) + "text <b>&\"quoted\"</b> 'x'";
+        lines << Log::getLogPrefix(static_cast<LogType>(t), date);
+        lines << Log::getLogPrefix(static_cast<LogType>(t), date) + "\r\r";
+        lines << Log::getLogPrefix(static_cast<LogType>(t), date) + "12";
+    }
+    lines << "" << "\r" << "short" << "[12:00:00.000][inf]" << "[12:00:00.000][inf] " << "[12:00:00.000][inf] x"
+          << "[a<b&c\"d>ef][<<<] x" << "[12:00:00.000][xyz] unknown tag" << "[12:00:00.000](inf) broken"
+          << "кириллица & <теги>";
+
+    const QString text = lines.join("\n");
+    QCOMPARE( Log::highlightLog(logFormat, text, dark), referenceHighlight(logFormat, text, dark) );
+    QCOMPARE( Log::highlightLog(logFormat, text + "\n", dark), referenceHighlight(logFormat, text + "\n", dark) );
+    QCOMPARE( Log::highlightLog(logFormat, QString(), dark), referenceHighlight(logFormat, QString(), dark) );
+    QCOMPARE( Log::highlightLog(logFormat, "\n\r\n", dark), referenceHighlight(logFormat, "\n\r\n", dark) );
+    const QString endLine = (logFormat == PlainLog) ? "\n" : "<br>";
+    for (const QString &line: lines) {
+        QString expected = referenceHighlight(logFormat, Log::getLogPrefix(LogError, date) + line, dark).trimmed();
+        if (expected.endsWith(endLine)) expected.chop(endLine.size());
+        QCOMPARE( Log::highlightLogString(logFormat, date, LogError, line, dark), expected.trimmed() );
+    }
+}
+//==================================================================================================
+void testLog::test_logIndex()
+{
+    const QString root = indexTree();
+    QVERIFY( !root.isEmpty() );
+
+    struct Query { QDateTime from; QDateTime to; int mask; };
+    const QDate day(2019, 6, 10);
+    const QList<Query> queries = QList<Query>()
+            << Query { QDateTime(day, QTime(0, 10)), QDateTime(day, QTime(0, 20)), 1 << LogError }
+            << Query { QDateTime(day, QTime(11, 0)), QDateTime(day.addDays(1), QTime(0, 30)), (1 << LogError) | (1 << LogWarning) }
+            << Query { QDateTime(day.addDays(2), QTime(23, 55)), QDateTime(day.addDays(3), QTime(0, 30)), LogIndex::AllTypes }
+            << Query { QDateTime(day.addDays(-5), QTime(0, 0)), QDateTime(day.addDays(5), QTime(0, 0)), 1 << LogOther }
+            << Query { QDateTime(day.addDays(1), QTime(5, 0)), QDateTime(day.addDays(1), QTime(6, 0)), LogIndex::AllTypes };
+
+    for (const Query &q: queries) {
+        QVector<LogRecord> expected;
+        for (const LogRecord &r: _indexRecords) {
+            if ((q.mask & (1 << r.logType)) && (r.date >= q.from) && (r.date <= q.to)) expected.append(r);
+        }
+        std::stable_sort(expected.begin(), expected.end(), [](const LogRecord &a, const LogRecord &b) { return a.date < b.date; });
+
+        for (int threads: { 1, 4 }) {
+            const QVector<LogRecord> found = LogIndex::search(root, q.from, q.to, q.mask, threads);
+            QCOMPARE( found.size(), expected.size() );
+            for (int i = 0; i < found.size(); ++i) {
+                QCOMPARE( found.at(i).date, expected.at(i).date );
+                QCOMPARE( int(found.at(i).logType), int(expected.at(i).logType) );
+                QCOMPARE( found.at(i).text, expected.at(i).text );
+                QCOMPARE( QDir::fromNativeSeparators(found.at(i).fileName), expected.at(i).fileName );
+                QCOMPARE( found.at(i).line, expected.at(i).line );
+            }
+        }
+    }
+    QVERIFY( QFile::exists( LogIndex::indexFileName(dayPath(root, day) + "12000000.log") ) );
+
+    // архив ротации ищется так же
+    const QString fileName = dayPath(root, day) + "12000001.log";
+    const QDateTime from(day, QTime(12, 10)), to(day, QTime(12, 20));
+    const QVector<LogRecord> before = LogIndex::searchFile(fileName, from, to, 1 << LogInfo);
+    QVERIFY( !before.isEmpty() );
+    QFile f(fileName);
+    QVERIFY( f.open(QIODevice::ReadOnly) );
+    QFile gz(fileName + ".gz");
+    QVERIFY( gz.open(QIODevice::WriteOnly) );
+    gz.write( Log::compressLog(f.readAll()) );
+    gz.close();
+    const QVector<LogRecord> after = LogIndex::searchFile(fileName + ".gz", from, to, 1 << LogInfo);
+    QCOMPARE( after.size(), before.size() );
+    QCOMPARE( after.last().text, before.last().text );
+    QFile::remove(fileName + ".gz");
+    QFile::remove(LogIndex::indexFileName(fileName + ".gz"));
+}
+//==================================================================================================
+void testLog::test_logIndexIncremental()
+{
+    const QString fileName = _dir.filePath("incremental.log");
+    Log log;
+    QVERIFY( log.startLog(fileName) );
+    for (int i = 0; i < 1000; ++i) QVERIFY( log.write((i % 10 == 0) ? LogError : LogInfo, QString("first %1").arg(i)) );
+
+    const QDateTime from = QDateTime::currentDateTime().addSecs(-3600);
+    const QDateTime to = QDateTime::currentDateTime().addSecs(3600);
+    QCOMPARE( LogIndex::searchFile(fileName, from, to, 1 << LogError).size(), 100 );
+    const qint64 indexSize = QFileInfo( LogIndex::indexFileName(fileName) ).size();
+
+    // дописанные строки попадают в индекс без перестроения
+    for (int i = 0; i < 1000; ++i) QVERIFY( log.write((i % 10 == 0) ? LogError : LogInfo, QString("second %1").arg(i)) );
+    const QVector<LogRecord> found = LogIndex::searchFile(fileName, from, to, 1 << LogError);
+    QCOMPARE( found.size(), 200 );
+    QCOMPARE( found.last().text, QString("second 990") );
+    QCOMPARE( found.last().line, qint64(1 + 1000 + 990) );
+    QVERIFY( QFileInfo( LogIndex::indexFileName(fileName) ).size() > indexSize );
+
+    // файл начат заново - индекс перестраивается
+    QVERIFY( QFile::resize(fileName, 0) );
+    QVERIFY( LogIndex::searchFile(fileName, from, to).isEmpty() );
+}
+//==================================================================================================
+void testLog::test_binaryLog()
+{
+    const QString root = _dir.filePath("binary");
+    QStringList texts;
+    QList<LogType> types;
+    QString fileName;
+    {
+        Log log(nullptr, QDateTime(), root);
+        log.setFileFormat(BinaryLog);
+        QCOMPARE( int(log.fileFormat()), int(BinaryLog) );
+        QVERIFY( log.startLog() );
+        fileName = log.logFileName();
+        QVERIFY( fileName.endsWith(".blog") );
+        for (int i = 0; i < 1000; ++i) {
+            const LogType logType = static_cast<LogType>(i % 8);
+            const QString text = (i % 100 == 0) ? QString("многострочное\nсообщение %1\n").arg(i)
+                                                : QString("message %1 <tag> & 'quotes'").arg(i);
+            QVERIFY( log.write(logType, text) );
+            types.append(logType);
+            texts.append(text);
+        }
+    }
+
+    // записи читаются без потерь, время не убывает
+    LogBinaryReader reader;
+    QVERIFY( reader.open(fileName) );
+    QVERIFY( reader.next() );
+    QVERIFY( reader.text().contains("-----") );
+    QDateTime last = reader.date();
+    QVERIFY( qAbs(last.secsTo(QDateTime::currentDateTime())) < 3600 );
+    QString expectedText;
+    QTextStream expected(&expectedText);
+    expected << Log::getLogPrefix(LogInfo, last) << reader.text() << "\n";
+    for (int i = 0; i < texts.size(); ++i) {
+        QVERIFY( reader.next() );
+        QCOMPARE( int(reader.logType()), int(types.at(i)) );
+        QCOMPARE( reader.text(), texts.at(i) );
+        QCOMPARE( reader.payload(), texts.at(i).toUtf8() );
+        QVERIFY( reader.date() >= last );
+        last = reader.date();
+        for (const QString &line: texts.at(i).split("\n")) expected << Log::getLogPrefix(types.at(i), last) << line << "\n";
+    }
+    QVERIFY( reader.next() );   // строка окончания
+    expected << Log::getLogPrefix(LogInfo, reader.date()) << reader.text() << "\n";
+    QVERIFY( !reader.next() );
+    expected.flush();
+
+    // преобразование в текстовый формат
+    QFile f(fileName);
+    QVERIFY( f.open(QIODevice::ReadOnly) );
+    const QByteArray data = f.readAll();
+    QCOMPARE( QString::fromUtf8(LogBinaryReader::toText(data)), expectedText );
+    const QString textName = _dir.filePath("binary.log");
+    QVERIFY( LogBinaryReader::convertToText(fileName, textName) );
+    QCOMPARE( readLogLines(textName), expectedText.split("\n").mid(0, expectedText.count("\n")) );
+    LogReader textReader(fileName);
+    QCOMPARE( textReader.text(0, textReader.lineCount()), expectedText );
+    QVERIFY( data.size() < expectedText.toUtf8().size() * 3 / 4 );
+
+    // фильтр по типу
+    int errors = 0;
+    reader.setData(data);
+    while (reader.next(1 << LogError)) {
+        QCOMPARE( int(reader.logType()), int(LogError) );
+        ++errors;
+    }
+    QCOMPARE( errors, 125 );
+
+    // обрезанный файл читается до последней целой записи
+    reader.setData( data.left(data.size() - 3) );
+    int count = 0;
+    while (reader.next()) ++count;
+    QCOMPARE( count, 1 + 1000 );
+    QVERIFY( !LogBinaryReader(QByteArray("text log")).isValid() );
+}
+//==================================================================================================
+
+QTEST_GUILESS_MAIN(testLog)
+
+#include "tst_testlog.moc"